@@ -0,0 +1,212 @@
+#include "backtest_runner.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+void BacktestStats::merge(const BacktestStats& other) {
+    instruments   += other.instruments;
+    messages      += other.messages;
+    adds          += other.adds;
+    cancels       += other.cancels;
+    rejects       += other.rejects;
+    fills         += other.fills;
+    filled_volume += other.filled_volume;
+    acks          += other.acks;
+}
+
+bool map_recording(const std::string& path, Recording& recording) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        perror(path.c_str());
+        return false;
+    }
+
+    struct stat st{};
+    if (fstat(fd, &st) < 0) {
+        perror("fstat");
+        close(fd);
+        return false;
+    }
+
+    recording = Recording{};
+    recording.path = path;
+    recording.count = st.st_size / sizeof(MarketData);
+    if (st.st_size % sizeof(MarketData) != 0) {
+        std::cerr << path << ": ignoring " << st.st_size % sizeof(MarketData) << " trailing bytes" << std::endl;
+    }
+
+    if (recording.count > 0) {
+        void* addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr == MAP_FAILED) {
+            perror("mmap");
+            close(fd);
+            return false;
+        }
+        // Each recording is read once front to back
+        madvise(addr, st.st_size, MADV_SEQUENTIAL);
+        recording.messages = static_cast<const MarketData*>(addr);
+        recording.mapped_bytes = st.st_size;
+    }
+    close(fd);
+    return true;
+}
+
+void unmap_recording(Recording& recording) {
+    if (recording.mapped_bytes > 0) {
+        munmap(const_cast<MarketData*>(recording.messages), recording.mapped_bytes);
+    }
+    recording.messages = nullptr;
+    recording.count = 0;
+    recording.mapped_bytes = 0;
+}
+
+BacktestRunner::BacktestRunner(BacktestConfig config) : _config(config) {}
+
+BacktestRunner::~BacktestRunner() {
+    for (auto& recording : _recordings) {
+        unmap_recording(recording);
+    }
+}
+
+bool BacktestRunner::add_recording(const std::string& path) {
+    Recording recording;
+    if (!map_recording(path, recording)) {
+        return false;
+    }
+    _recordings.push_back(std::move(recording));
+    return true;
+}
+
+bool BacktestRunner::take(WorkQueue& queue, size_t& instrument) {
+    if (queue.next.load(std::memory_order_relaxed) >= queue.end) {
+        return false;
+    }
+    instrument = queue.next.fetch_add(1, std::memory_order_relaxed);
+    return instrument < queue.end;
+}
+
+void BacktestRunner::replay(uint32_t instrument, Worker& worker) {
+    const Recording& recording = _recordings[instrument];
+    BacktestStats& stats = worker.stats;
+
+    // The previous instrument's book is dead, carve a fresh one from the same pages
+    worker.arena->reset();
+    MatchingEngine engine(worker.arena.get());
+    engine.on_fill = [&stats, &worker, instrument, this](const FillReport& report) {
+        stats.fills++;
+        stats.filled_volume += report.traded_volume;
+        if (_config.collect_fills) {
+            worker.fills.push_back({instrument, report});
+        }
+    };
+    engine.on_ack = [&stats](const AckReport&) {
+        stats.acks++;
+    };
+
+    for (size_t i = 0; i < recording.count; ++i) {
+        const MarketData& md = recording.messages[i];
+
+        if (md.type == MsgType::ORDER_ADD && md.price > 0 && md.volume > 0 && md.side <= 1) {
+            Order o = {
+                .id = md.order_id,
+                .timestamp = md.timestamp,
+                .price = md.price,
+                .volume = md.volume,
+                .side = md.side == 1 ? Side::ASK : Side::BID
+            };
+            stats.adds++;
+            stats.rejects += !engine.match(o);
+        } else if (md.type == MsgType::ORDER_CANCEL || md.type == MsgType::ORDER_DELETE) {
+            stats.cancels++;
+            stats.rejects += !engine.cancel_order(md.order_id);
+        } else {
+            stats.rejects++;
+        }
+    }
+
+    stats.messages += recording.count;
+    stats.instruments++;
+}
+
+void BacktestRunner::worker_loop(size_t worker_idx, size_t num_workers, Worker& worker) {
+    if (_config.pin_threads) {
+        cpu_set_t cpuset;
+        CPU_ZERO(&cpuset);
+        CPU_SET(worker_idx % std::max(1u, std::thread::hardware_concurrency()), &cpuset);
+        if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset) != 0) {
+            std::cerr << "Failed to bind worker " << worker_idx << ": " << strerror(errno) << std::endl;
+        }
+    }
+
+    // After pinning, so the pages land on the worker's node
+    worker.arena = std::make_unique<Arena>(OrderBook::arena_bytes());
+
+    size_t instrument;
+
+    // Own partition first, then steal from the others
+    for (size_t k = 0; k < num_workers; ++k) {
+        WorkQueue& queue = _queues[(worker_idx + k) % num_workers];
+        while (take(queue, instrument)) {
+            replay(static_cast<uint32_t>(instrument), worker);
+        }
+    }
+}
+
+BacktestStats BacktestRunner::run() {
+    size_t threads = _config.threads ? _config.threads : std::max(1u, std::thread::hardware_concurrency());
+    threads = std::max<size_t>(1, std::min(threads, _recordings.size()));
+
+    // Contiguous partitions of roughly equal message count
+    size_t total = 0;
+    for (const auto& recording : _recordings) {
+        total += recording.count;
+    }
+
+    _queues = std::make_unique<WorkQueue[]>(threads);
+    size_t begin = 0, assigned = 0;
+    for (size_t w = 0; w < threads; ++w) {
+        size_t target = total * (w + 1) / threads;
+        size_t end = begin;
+        while (end < _recordings.size() && (assigned < target || w == threads - 1)) {
+            assigned += _recordings[end++].count;
+        }
+        _queues[w].next.store(begin, std::memory_order_relaxed);
+        _queues[w].end = end;
+        begin = end;
+    }
+
+    std::vector<Worker> workers(threads);
+    std::vector<std::thread> pool;
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t w = 0; w < threads; ++w) {
+        pool.emplace_back(&BacktestRunner::worker_loop, this, w, threads, std::ref(workers[w]));
+    }
+    for (auto& t : pool) {
+        t.join();
+    }
+    _elapsed_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start
+    ).count();
+
+    // Merge per worker buffers
+    BacktestStats merged;
+    _fills.clear();
+    for (auto& worker : workers) {
+        merged.merge(worker.stats);
+        _fills.insert(_fills.end(), worker.fills.begin(), worker.fills.end());
+    }
+    std::stable_sort(_fills.begin(), _fills.end(), [](const BacktestFill& a, const BacktestFill& b) {
+        return a.instrument < b.instrument;
+    });
+
+    return merged;
+}
@@ -0,0 +1,101 @@
+#pragma once
+#include "../data/market_data.h"
+#include "../order/matching_engine.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Recorded feed of one instrument: a memory-mapped file of back to back MarketData records,
+// exactly as they arrive on the wire.
+struct Recording {
+    std::string path;
+    const MarketData* messages = nullptr;
+    size_t count = 0;
+    size_t mapped_bytes = 0;
+};
+
+// Memory map the recorded file at path into recording. Return false if it can't be mapped.
+bool map_recording(const std::string& path, Recording& recording);
+
+// Unmap a recording mapped by map_recording.
+void unmap_recording(Recording& recording);
+
+// Fill produced while replaying an instrument.
+struct BacktestFill {
+    uint32_t instrument; // Index of the recording
+    FillReport fill;
+};
+
+// Counters of one worker, merged at the end of the run.
+struct alignas(64) BacktestStats {
+    uint64_t instruments = 0;
+    uint64_t messages = 0;
+    uint64_t adds = 0;
+    uint64_t cancels = 0;
+    uint64_t rejects = 0;       // Adds the book couldn't take, cancels of unknown orders, bad messages
+    uint64_t fills = 0;
+    uint64_t filled_volume = 0;
+    uint64_t acks = 0;
+
+    void merge(const BacktestStats& other);
+};
+
+struct BacktestConfig {
+    size_t threads = 0;         // 0: one per hardware thread
+    bool pin_threads = true;    // Pin worker i to core i
+    bool collect_fills = false; // Keep every fill, in per thread buffers
+};
+
+// Offline replay of recorded order flow, one MatchingEngine per instrument.
+// Instruments are partitioned across workers by message count, and idle workers
+// steal the remaining instruments of busy ones.
+class BacktestRunner {
+public:
+    explicit BacktestRunner(BacktestConfig config = {});
+
+    ~BacktestRunner();
+
+    // Memory map a recorded file as one instrument. Return false if it can't be mapped.
+    bool add_recording(const std::string& path);
+
+    // Replay every recording, return merged stats.
+    BacktestStats run();
+
+    // Fills of the last run grouped by instrument, in replay order (if collect_fills).
+    const std::vector<BacktestFill>& fills() const { return _fills; }
+
+    // Wall time of the last run.
+    uint64_t elapsed_ns() const { return _elapsed_ns; }
+
+    const std::vector<Recording>& recordings() const { return _recordings; }
+
+private:
+    // Half open range of instrument indices owned by a worker, consumed from the front
+    // by the owner and by thieves alike.
+    struct alignas(64) WorkQueue {
+        std::atomic<size_t> next{0};
+        size_t end = 0;
+    };
+
+    struct Worker {
+        BacktestStats stats;
+        std::vector<BacktestFill> fills;
+        std::unique_ptr<Arena> arena;  // Book storage, mapped on the worker's node and reused per instrument
+    };
+
+    // Worker worker_idx of num_workers: its own queue first, then the others'.
+    void worker_loop(size_t worker_idx, size_t num_workers, Worker& worker);
+
+    // Take the next instrument of queue, return false if it is drained.
+    bool take(WorkQueue& queue, size_t& instrument);
+
+    void replay(uint32_t instrument, Worker& worker);
+
+    BacktestConfig _config;
+    std::vector<Recording> _recordings;
+    std::unique_ptr<WorkQueue[]> _queues;
+    std::vector<BacktestFill> _fills;
+    uint64_t _elapsed_ns = 0;
+};
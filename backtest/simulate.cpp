@@ -0,0 +1,186 @@
+#include "backtest_runner.h"
+#include "simulator.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <unistd.h>
+
+// Sample strategy: joins the best bid and ask with a fixed size while its position is within limit,
+// and pulls a quote as soon as the touch moves away from it. Each side is a small state machine.
+class JoinQuoter : public Strategy {
+public:
+    JoinQuoter(uint32_t size, int64_t limit) : _size(size), _limit(limit) {}
+
+    void on_top_of_book(Simulator& sim, const TopOfBook& top) override {
+        _top = top;
+        quote(sim, _sides[0], Side::BID, top.bid);
+        quote(sim, _sides[1], Side::ASK, top.ask);
+    }
+
+    void on_ack(Simulator& sim, const AckReport& ack) override {
+        Quote& q = side_of(ack.order_id);
+        q.state = State::LIVE;
+        uint32_t orders_ahead, volume_ahead;
+        if (sim.queue_position(ack.order_id, orders_ahead, volume_ahead)) {
+            _acks++;
+            _volume_ahead += volume_ahead;
+        }
+    }
+
+    void on_fill(Simulator& sim, const SimFill& fill) override {
+        _position += fill.side == Side::BID ? fill.volume : -static_cast<int64_t>(fill.volume);
+        Quote& q = side_of(fill.order_id);
+        q.remaining -= std::min(q.remaining, fill.volume);
+        if (q.remaining == 0) {
+            q.state = State::IDLE;
+            requote(sim);
+        }
+    }
+
+    void on_cancel(Simulator& sim, const CancelReport& report) override {
+        side_of(report.order_id).state = State::IDLE;
+        requote(sim);
+    }
+
+    void on_reject(Simulator&, uint32_t order_id) override {
+        // A refused cancel means the order is gone (filled), a refused order never rested.
+        // Either way, wait for the next top of book before quoting again
+        Quote& q = side_of(order_id);
+        if (q.order_id == order_id) {
+            q.state = State::IDLE;
+        }
+    }
+
+    int64_t position() const { return _position; }
+
+    // Average volume ahead of our quotes when they were acked.
+    double average_volume_ahead() const { return _acks ? static_cast<double>(_volume_ahead) / _acks : 0; }
+
+    const TopOfBook& top() const { return _top; }
+
+private:
+    enum class State { IDLE, PENDING, LIVE, CANCELING };
+
+    struct Quote {
+        State state = State::IDLE;
+        uint32_t order_id = 0;
+        int32_t price = 0;
+        uint32_t remaining = 0;
+    };
+
+    Quote& side_of(uint32_t order_id) { return _sides[0].order_id == order_id ? _sides[0] : _sides[1]; }
+
+    void requote(Simulator& sim) {
+        quote(sim, _sides[0], Side::BID, _top.bid);
+        quote(sim, _sides[1], Side::ASK, _top.ask);
+    }
+
+    void quote(Simulator& sim, Quote& q, Side side, int32_t touch) {
+        bool allowed = touch > 0 && (side == Side::BID ? _position < _limit : _position > -_limit);
+        switch (q.state) {
+            case State::IDLE:
+                if (allowed) {
+                    q = {State::PENDING, sim.send(side, touch, _size), touch, _size};
+                }
+                break;
+            case State::LIVE:
+                if (!allowed || q.price != touch) {
+                    sim.cancel(q.order_id);
+                    q.state = State::CANCELING;
+                }
+                break;
+            default:
+                break;  // Waiting for the venue
+        }
+    }
+
+    uint32_t _size;
+    int64_t _limit;
+    int64_t _position = 0;
+    Quote _sides[2];
+    TopOfBook _top{};
+    uint64_t _acks = 0;
+    uint64_t _volume_ahead = 0;
+};
+
+void usage(const char* prog) {
+    std::cerr << "Usage: " << prog << " [options] recording..." << std::endl
+              << "  -f ns      feed latency, venue to strategy (5000)" << std::endl
+              << "  -o ns      order entry latency, strategy to venue (10000)" << std::endl
+              << "  -r ns      execution report latency, venue to strategy (10000)" << std::endl
+              << "  -u ns      simulated ns per recorded timestamp unit (1)" << std::endl
+              << "  -q size    quote size (5)" << std::endl
+              << "  -l limit   position limit (50)" << std::endl
+              << "Each recording holds one instrument's MarketData records back to back." << std::endl;
+}
+
+int main(int argc, char** argv) {
+    SimConfig config;
+    uint32_t size = 5;
+    int64_t limit = 50;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "f:o:r:u:q:l:h")) != -1) {
+        switch (opt) {
+            case 'f': config.feed_latency_ns = std::strtoull(optarg, nullptr, 10); break;
+            case 'o': config.order_latency_ns = std::strtoull(optarg, nullptr, 10); break;
+            case 'r': config.report_latency_ns = std::strtoull(optarg, nullptr, 10); break;
+            case 'u': config.timestamp_unit_ns = std::strtoull(optarg, nullptr, 10); break;
+            case 'q': size = std::strtoul(optarg, nullptr, 10); break;
+            case 'l': limit = std::strtoll(optarg, nullptr, 10); break;
+            default: usage(argv[0]); return 1;
+        }
+    }
+    if (optind >= argc) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    // One book arena, rewound for every instrument
+    Arena arena(OrderBook::arena_bytes());
+    uint64_t total_events = 0, total_ns = 0;
+
+    for (int i = optind; i < argc; ++i) {
+        Recording recording;
+        if (!map_recording(argv[i], recording)) {
+            return 1;
+        }
+
+        arena.reset();
+        JoinQuoter strategy(size, limit);
+        Simulator sim(recording.messages, recording.count, strategy, config, &arena);
+
+        auto start = std::chrono::steady_clock::now();
+        sim.run();
+        uint64_t elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+        const SimStats& stats = sim.stats();
+        const TopOfBook& top = strategy.top();
+        int64_t mid = top.bid && top.ask ? (static_cast<int64_t>(top.bid) + top.ask) / 2 : (top.bid ? top.bid : top.ask);
+        std::cout << "[Simulate] " << recording.path
+                  << ": Messages: " << stats.market_messages
+                  << ", Events: " << stats.events
+                  << ", Throughput: " << (elapsed ? stats.events * 1e9 / elapsed : 0) << " events/sec"
+                  << std::endl;
+        std::cout << "[Simulate] Orders: " << stats.orders_sent
+                  << ", Cancels: " << stats.cancels_sent
+                  << ", Rejects: " << stats.rejects
+                  << ", Fills: " << stats.fills
+                  << ", Filled volume: " << stats.filled_volume
+                  << ", Position: " << stats.position
+                  << ", PnL at mid: " << stats.cash + stats.position * mid
+                  << ", Avg volume ahead at ack: " << strategy.average_volume_ahead()
+                  << std::endl;
+
+        total_events += stats.events;
+        total_ns += elapsed;
+        unmap_recording(recording);
+    }
+
+    if (argc - optind > 1) {
+        std::cout << "[Simulate] Total events: " << total_events
+                  << ", Throughput: " << (total_ns ? total_events * 1e9 / total_ns : 0) << " events/sec" << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,248 @@
+#include "simulator.h"
+#include <algorithm>
+#include <limits>
+
+Simulator::Simulator(const MarketData* messages, size_t count, Strategy& strategy, SimConfig config, Arena* arena)
+    : _messages(messages), _count(count), _strategy(strategy), _config(config), _engine(arena) {
+    _timers.reserve(1024);
+
+    // The engine reports every order, only ours travel back to the strategy
+    _engine.on_fill = [this](const FillReport& report) {
+        for (bool maker : {true, false}) {
+            uint32_t order_id = maker ? report.maker_order_id : report.taker_order_id;
+            if (!(order_id & OWN_ORDER_BIT)) {
+                continue;
+            }
+            Side side = _own_sides[order_id & ~OWN_ORDER_BIT];
+            int64_t volume = report.traded_volume;
+            _stats.fills++;
+            _stats.filled_volume += volume;
+            _stats.position += side == Side::BID ? volume : -volume;
+            _stats.cash += (side == Side::BID ? -volume : volume) * report.traded_price;
+            if (!maker) {
+                _taker_filled += report.traded_volume;
+            }
+            schedule(_reports, _config.report_latency_ns, {.type = EventType::FILL, .side = side, .maker = maker,
+                      .order_id = order_id, .a = report.traded_price, .b = report.traded_volume});
+        }
+    };
+    _engine.on_ack = [this](const AckReport& report) {
+        if (report.order_id & OWN_ORDER_BIT) {
+            schedule(_reports, _config.report_latency_ns, {.type = EventType::ACK, .side = report.order_side,
+                      .order_id = report.order_id, .a = report.order_price, .b = report.remaining_volume, .tag = _now});
+        }
+    };
+    _engine.on_cancel = [this](const CancelReport& report) {
+        if (report.order_id & OWN_ORDER_BIT) {
+            schedule(_reports, _config.report_latency_ns, {.type = EventType::CANCELED,
+                      .order_id = report.order_id, .b = report.cancelled_volume});
+        }
+    };
+}
+
+void Simulator::Channel::push(const Scheduled& scheduled) {
+    if (_tail - _head == _ring.size()) {
+        // Full: unroll into a ring twice the size
+        std::vector<Scheduled> ring(_ring.size() * 2);
+        for (uint64_t i = _head; i < _tail; ++i) {
+            ring[i - _head] = _ring[i & (_ring.size() - 1)];
+        }
+        _ring.swap(ring);
+        _tail -= _head;
+        _head = 0;
+    }
+    _ring[_tail++ & (_ring.size() - 1)] = scheduled;
+}
+
+void Simulator::schedule(Channel& channel, uint64_t latency, const Event& event) {
+    channel.push({(static_cast<Key>(_now + latency) << 64) | _sequence++, event});
+}
+
+Simulator::Key Simulator::next_key() const {
+    Key key = NO_EVENT;
+    for (const Channel* channel : {&_orders, &_feed, &_reports}) {
+        if (!channel->empty()) {
+            key = std::min(key, channel->front().key);
+        }
+    }
+    if (!_timers.empty()) {
+        key = std::min(key, _timers.front().key);
+    }
+    return key;
+}
+
+Simulator::Event Simulator::pop(Key key) {
+    _now = key_time(key);
+    for (Channel* channel : {&_orders, &_feed, &_reports}) {
+        if (!channel->empty() && channel->front().key == key) {
+            Event event = channel->front().event;
+            channel->pop();
+            return event;
+        }
+    }
+    std::pop_heap(_timers.begin(), _timers.end(), later);
+    Event event = _timers.back().event;
+    _timers.pop_back();
+    return event;
+}
+
+uint64_t Simulator::venue_time(const MarketData& md) {
+    // Timestamps are 32 bits and wrap: a large step back starts a new epoch, a small one is reordering
+    if (md.timestamp < _last_timestamp && _last_timestamp - md.timestamp > (1u << 31)) {
+        _timestamp_epochs++;
+    }
+    _last_timestamp = md.timestamp;
+    return ((_timestamp_epochs << 32) | md.timestamp) * _config.timestamp_unit_ns;
+}
+
+void Simulator::run() {
+    size_t next = 0;
+    uint64_t next_market = _count > 0 ? venue_time(_messages[0]) : std::numeric_limits<uint64_t>::max();
+    _now = _count > 0 ? next_market : 0;
+    _strategy.on_start(*this);
+
+    // Strategies may keep scheduling forever (timers, requotes): stop once the recording has drained
+    uint64_t end = std::numeric_limits<uint64_t>::max();
+    while (true) {
+        Key key = next_key();
+        uint64_t time = key == NO_EVENT ? std::numeric_limits<uint64_t>::max() : key_time(key);
+
+        // At equal times the recorded message goes first: it was already on its way
+        if (next < _count && next_market <= time) {
+            _now = std::max(_now, next_market);
+            apply_market(_messages[next++]);
+            if (next < _count) {
+                next_market = venue_time(_messages[next]);
+            } else {
+                end = _now + _config.drain_ns;
+            }
+        } else if (key != NO_EVENT && time <= end) {
+            Event event = pop(key);
+            switch (event.type) {
+                case EventType::ORDER_ARRIVAL:  arrive_order(event); break;
+                case EventType::CANCEL_ARRIVAL: arrive_cancel(event); break;
+                default:                        deliver(event); break;
+            }
+        } else {
+            break;
+        }
+        _stats.events++;
+    }
+}
+
+void Simulator::apply_market(const MarketData& md) {
+    _stats.market_messages++;
+    if (md.order_id & OWN_ORDER_BIT) {
+        _stats.market_rejects++;  // Would alias one of ours
+        return;
+    }
+
+    if (md.type == MsgType::ORDER_ADD && md.price > 0 && md.volume > 0 && md.side <= 1) {
+        Order o = {
+            .id = md.order_id,
+            .timestamp = _now,
+            .price = md.price,
+            .volume = md.volume,
+            .side = md.side == 1 ? Side::ASK : Side::BID
+        };
+        _stats.market_rejects += !_engine.match(o);
+    } else if (md.type == MsgType::ORDER_CANCEL || md.type == MsgType::ORDER_DELETE) {
+        _stats.market_rejects += !_engine.cancel_order(md.order_id);
+    } else if (md.type != MsgType::ORDER_EXECUTE) {
+        _stats.market_rejects++;  // Executions are implied: recorded adds match here
+        return;
+    }
+    publish_top_of_book();
+}
+
+void Simulator::arrive_order(const Event& event) {
+    _taker_filled = 0;
+    Order o = {
+        .id = event.order_id,
+        .timestamp = _now,
+        .price = event.a,
+        .volume = event.b,
+        .side = event.side,
+        .owner = OWNER
+    };
+    if (!_engine.match(o)) {
+        // Nothing traded: refused. Otherwise the book couldn't take the residual
+        if (_taker_filled == 0) {
+            _stats.rejects++;
+            schedule(_reports, _config.report_latency_ns, {.type = EventType::REJECT, .order_id = event.order_id});
+        } else {
+            schedule(_reports, _config.report_latency_ns, {.type = EventType::CANCELED,
+                      .order_id = event.order_id, .b = event.b - _taker_filled});
+        }
+    }
+    publish_top_of_book();
+}
+
+void Simulator::arrive_cancel(const Event& event) {
+    // Recorded third party orders can't be canceled by the strategy
+    if (!(event.order_id & OWN_ORDER_BIT) || !_engine.cancel_order(event.order_id)) {
+        _stats.rejects++;  // Not ours, already filled or canceled
+        schedule(_reports, _config.report_latency_ns, {.type = EventType::REJECT, .order_id = event.order_id});
+        return;
+    }
+    publish_top_of_book();
+}
+
+void Simulator::publish_top_of_book() {
+    DepthLevel bid{}, ask{};
+    _engine.order_book().get_depth(1, &bid, &ask);
+    if (bid.price == _top.bid && ask.price == _top.ask && bid.volume == _top.bid_volume && ask.volume == _top.ask_volume) {
+        return;
+    }
+    _top = {_now, bid.price, ask.price, bid.volume, ask.volume};
+    schedule(_feed, _config.feed_latency_ns, {.type = EventType::TOP_OF_BOOK,
+              .a = bid.price, .b = static_cast<uint32_t>(ask.price), .c = bid.volume, .d = ask.volume, .tag = _now});
+}
+
+void Simulator::deliver(const Event& event) {
+    switch (event.type) {
+        case EventType::TOP_OF_BOOK:
+            _strategy.on_top_of_book(*this, TopOfBook{event.tag, event.a, static_cast<int32_t>(event.b), event.c, event.d});
+            break;
+        case EventType::ACK:
+            _strategy.on_ack(*this, AckReport{event.order_id, event.tag, event.a, event.b, event.side});
+            break;
+        case EventType::FILL:
+            _strategy.on_fill(*this, SimFill{event.order_id, event.side, event.a, event.b, event.maker});
+            break;
+        case EventType::CANCELED:
+            _strategy.on_cancel(*this, CancelReport{event.order_id, event.b});
+            break;
+        case EventType::REJECT:
+            _strategy.on_reject(*this, event.order_id);
+            break;
+        case EventType::TIMER:
+            _strategy.on_timer(*this, event.tag);
+            break;
+        default:
+            break;
+    }
+}
+
+uint32_t Simulator::send(Side side, int32_t price, uint32_t volume) {
+    uint32_t order_id = OWN_ORDER_BIT | static_cast<uint32_t>(_own_sides.size());
+    _own_sides.push_back(side);
+    _stats.orders_sent++;
+    schedule(_orders, _config.order_latency_ns, {.type = EventType::ORDER_ARRIVAL, .side = side,
+              .order_id = order_id, .a = price, .b = volume});
+    return order_id;
+}
+
+void Simulator::cancel(uint32_t order_id) {
+    _stats.cancels_sent++;
+    schedule(_orders, _config.order_latency_ns, {.type = EventType::CANCEL_ARRIVAL, .order_id = order_id});
+}
+
+void Simulator::set_timer(uint64_t delay_ns, uint64_t tag) {
+    _timers.push_back({(static_cast<Key>(_now + delay_ns) << 64) | _sequence++, {.type = EventType::TIMER, .tag = tag}});
+    std::push_heap(_timers.begin(), _timers.end(), later);
+}
+
+bool Simulator::queue_position(uint32_t order_id, uint32_t& orders_ahead, uint32_t& volume_ahead) {
+    return _engine.order_book().queue_position(order_id, orders_ahead, volume_ahead);
+}
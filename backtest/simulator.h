@@ -0,0 +1,196 @@
+#pragma once
+#include "../data/market_data.h"
+#include "../order/matching_engine.h"
+#include <cstdint>
+#include <vector>
+
+// One way latencies between the strategy and the venue, in simulated nanoseconds.
+struct SimConfig {
+    uint64_t feed_latency_ns = 5000;     // Venue -> strategy market data
+    uint64_t order_latency_ns = 10000;   // Strategy -> venue order entry
+    uint64_t report_latency_ns = 10000;  // Venue -> strategy execution reports
+    uint64_t timestamp_unit_ns = 1;      // Simulated ns per MarketData::timestamp unit
+    uint64_t drain_ns = 1000000;         // Simulated time after the last recorded message
+};
+
+// Best price and aggregate volume of each side as the strategy sees them, 0 for an empty side.
+struct TopOfBook {
+    uint64_t venue_time;  // When the venue's book looked like this
+    int32_t  bid;
+    int32_t  ask;
+    uint32_t bid_volume;
+    uint32_t ask_volume;
+};
+
+// Fill of one of the strategy's orders.
+struct SimFill {
+    uint32_t order_id;
+    Side     side;
+    int32_t  price;
+    uint32_t volume;
+    bool     maker;       // Our order was resting
+};
+
+struct SimStats {
+    uint64_t events = 0;          // Recorded messages plus scheduled events
+    uint64_t market_messages = 0;
+    uint64_t market_rejects = 0;  // Recorded adds the book couldn't take, cancels of orders we traded with
+    uint64_t orders_sent = 0;
+    uint64_t cancels_sent = 0;
+    uint64_t rejects = 0;         // Our orders and cancels the venue rejected
+    uint64_t fills = 0;
+    uint64_t filled_volume = 0;
+    int64_t  position = 0;        // Net volume bought
+    int64_t  cash = 0;            // Price units received minus paid
+};
+
+class Simulator;
+
+// Strategy driven by the simulator, written as a state machine: each callback runs at the simulated
+// time the strategy learns about the event, reacts through the simulator and returns.
+// Orders and cancels reach the venue order_latency_ns later.
+class Strategy {
+public:
+    virtual ~Strategy() = default;
+
+    virtual void on_start(Simulator&) {}
+    virtual void on_top_of_book(Simulator&, const TopOfBook&) {}
+    virtual void on_ack(Simulator&, const AckReport&) {}
+    virtual void on_fill(Simulator&, const SimFill&) {}
+    virtual void on_cancel(Simulator&, const CancelReport&) {}  // Includes residuals the book couldn't take
+    virtual void on_reject(Simulator&, uint32_t /* order_id */) {}  // Order or cancel refused by the venue
+    virtual void on_timer(Simulator&, uint64_t /* tag */) {}
+};
+
+// Discrete event simulation of a strategy trading against recorded order flow of one instrument.
+// Recorded messages and the strategy's orders meet in one MatchingEngine at the venue; a simulated
+// clock advances from event to event. Each latency is fixed, so orders in flight, market data and
+// execution reports each form a time ordered FIFO; the scheduler merges their heads with the next
+// recorded message and a binary heap that only holds the strategy's timers.
+// Top of book changes are published after every venue event that moves it.
+class Simulator {
+public:
+    // Order ids with this bit set belong to the strategy.
+    static constexpr uint32_t OWN_ORDER_BIT = 1u << 31;
+    static constexpr uint32_t OWNER = 1;  // Order::owner of the strategy's orders
+
+    // Book storage is carved from arena (see OrderBook), a private one if null.
+    Simulator(const MarketData* messages, size_t count, Strategy& strategy, SimConfig config = {}, Arena* arena = nullptr);
+
+    // Run until the recording is exhausted and no event is scheduled within drain_ns of its end.
+    void run();
+
+    // Current simulated time.
+    uint64_t now() const { return _now; }
+
+    // Send a limit order, return its id. It reaches the venue order_latency_ns from now.
+    uint32_t send(Side side, int32_t price, uint32_t volume);
+
+    // Request a cancel of order_id, reaching the venue order_latency_ns from now.
+    // The venue rejects it unless order_id is one of ours, still resting.
+    void cancel(uint32_t order_id);
+
+    // Call on_timer(tag) delay_ns from now.
+    void set_timer(uint64_t delay_ns, uint64_t tag);
+
+    // Queue position of our resting order_id at the venue, right now (see OrderBook::queue_position).
+    bool queue_position(uint32_t order_id, uint32_t& orders_ahead, uint32_t& volume_ahead);
+
+    const SimStats& stats() const { return _stats; }
+
+    MatchingEngine& engine() { return _engine; }
+
+private:
+    enum class EventType : uint8_t {
+        ORDER_ARRIVAL,   // Venue: our new order
+        CANCEL_ARRIVAL,  // Venue: our cancel
+        TOP_OF_BOOK,     // Strategy
+        ACK,             // Strategy
+        FILL,            // Strategy
+        CANCELED,        // Strategy
+        REJECT,          // Strategy
+        TIMER,           // Strategy
+    };
+
+    // Payload of a scheduled event.
+    struct Event {
+        EventType type = EventType::TIMER;
+        Side side = Side::BID;
+        bool maker = false;
+        uint32_t order_id = 0;
+        int32_t a = 0;          // Price, or bid
+        uint32_t b = 0;         // Volume, or ask
+        uint32_t c = 0;         // Bid volume
+        uint32_t d = 0;         // Ask volume
+        uint64_t tag = 0;       // Timer tag, or venue time of a top of book or ack
+    };
+
+    // Events are ordered by a single 128 bit key: time, then scheduling sequence (FIFO among ties).
+    using Key = unsigned __int128;
+    static uint64_t key_time(Key key) { return static_cast<uint64_t>(key >> 64); }
+
+    struct Scheduled {
+        Key key;
+        Event event;
+    };
+
+    // Timer heap order: earliest key on top.
+    static bool later(const Scheduled& a, const Scheduled& b) { return a.key > b.key; }
+
+    // Every event of a channel is scheduled a fixed latency after the current time, so the
+    // channel is a FIFO already sorted by key: a ring growing on demand.
+    class Channel {
+    public:
+        bool empty() const { return _head == _tail; }
+        const Scheduled& front() const { return _ring[_head & (_ring.size() - 1)]; }
+        void pop() { _head++; }
+        void push(const Scheduled& scheduled);
+
+    private:
+        std::vector<Scheduled> _ring = std::vector<Scheduled>(1024);
+        uint64_t _head = 0;
+        uint64_t _tail = 0;
+    };
+
+    static constexpr Key NO_EVENT = ~Key(0);
+
+    // Schedule event on channel, latency from now.
+    void schedule(Channel& channel, uint64_t latency, const Event& event);
+
+    // Earliest scheduled key, NO_EVENT if nothing is scheduled.
+    Key next_key() const;
+
+    // Remove the event of key, the earliest one, and advance the clock to it.
+    Event pop(Key key);
+
+    // Venue side
+    void apply_market(const MarketData& md);
+    void arrive_order(const Event& event);
+    void arrive_cancel(const Event& event);
+    void publish_top_of_book();
+
+    // Strategy side
+    void deliver(const Event& event);
+
+    uint64_t venue_time(const MarketData& md);
+
+    const MarketData* _messages;
+    size_t _count;
+    Strategy& _strategy;
+    SimConfig _config;
+    MatchingEngine _engine;
+
+    Channel _orders;                 // Strategy -> venue
+    Channel _feed;                   // Venue -> strategy market data
+    Channel _reports;                // Venue -> strategy execution reports
+    std::vector<Scheduled> _timers;  // Min heap, any delay
+    uint64_t _sequence = 0;
+    uint64_t _now = 0;
+    uint32_t _last_timestamp = 0;    // Of the last recorded message, to unwrap 32 bit timestamps
+    uint64_t _timestamp_epochs = 0;
+
+    std::vector<Side> _own_sides;    // Side of our order id & ~OWN_ORDER_BIT
+    uint32_t _taker_filled = 0;      // Volume our incoming order has filled so far
+    TopOfBook _top{};
+    SimStats _stats;
+};
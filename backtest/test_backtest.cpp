@@ -0,0 +1,279 @@
+#include "backtest_runner.h"
+#include "simulator.h"
+#include <iostream>
+#include <cassert>
+#include <vector>
+#include <string>
+#include <tuple>
+#include <random>
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+
+// 生成合成行情录制文件：随机挂单与撤单，价格围绕中间价，部分订单会穿价成交
+static std::string write_recording(uint32_t seed, size_t messages) {
+    char path[] = "/tmp/backtest_test_XXXXXX";
+    int fd = mkstemp(path);
+    assert(fd >= 0);
+
+    std::mt19937 rng(seed);
+    std::vector<MarketData> records;
+    std::vector<uint32_t> live;
+    uint32_t next_id = 1;
+    for (size_t i = 0; i < messages; ++i) {
+        MarketData md = {};
+        md.timestamp = static_cast<uint32_t>(i);
+        if (!live.empty() && rng() % 4 == 0) {
+            size_t k = rng() % live.size();
+            md.type = MsgType::ORDER_CANCEL;
+            md.order_id = live[k];
+            live[k] = live.back();
+            live.pop_back();
+        } else {
+            md.type = MsgType::ORDER_ADD;
+            md.order_id = next_id++;
+            md.side = rng() & 1;
+            md.price = 1000 + static_cast<int32_t>(rng() % 11) - 5;
+            md.volume = 1 + rng() % 10;
+            live.push_back(md.order_id);
+        }
+        records.push_back(md);
+    }
+    ssize_t bytes = static_cast<ssize_t>(records.size() * sizeof(MarketData));
+    ssize_t written = write(fd, records.data(), bytes);
+    assert(written == bytes);
+    close(fd);
+    return path;
+}
+
+static void assert_same_stats(const BacktestStats& a, const BacktestStats& b) {
+    assert(a.instruments == b.instruments);
+    assert(a.messages == b.messages);
+    assert(a.adds == b.adds);
+    assert(a.cancels == b.cancels);
+    assert(a.rejects == b.rejects);
+    assert(a.fills == b.fills);
+    assert(a.filled_volume == b.filled_volume);
+    assert(a.acks == b.acks);
+}
+
+static void assert_same_fills(const std::vector<BacktestFill>& a, const std::vector<BacktestFill>& b) {
+    assert(a.size() == b.size());
+    for (size_t i = 0; i < a.size(); ++i) {
+        assert(a[i].instrument == b[i].instrument);
+        assert(a[i].fill.taker_order_id == b[i].fill.taker_order_id);
+        assert(a[i].fill.maker_order_id == b[i].fill.maker_order_id);
+        assert(a[i].fill.traded_price == b[i].fill.traded_price);
+        assert(a[i].fill.traded_volume == b[i].fill.traded_volume);
+    }
+}
+
+void run_runner_test() {
+    // 不同长度的合成品种，让分区与窃取都发生
+    std::vector<std::string> paths;
+    for (uint32_t i = 0; i < 7; ++i) {
+        paths.push_back(write_recording(i + 1, 2000 + 1500 * i));
+    }
+
+    BacktestConfig single_config;
+    single_config.threads = 1;
+    single_config.pin_threads = false;
+    single_config.collect_fills = true;
+    BacktestRunner single(single_config);
+
+    BacktestConfig parallel_config = single_config;
+    parallel_config.threads = 4;
+    BacktestRunner parallel(parallel_config);
+
+    for (const auto& path : paths) {
+        assert(single.add_recording(path));
+        assert(parallel.add_recording(path));
+    }
+
+    BacktestStats expected = single.run();
+    assert(expected.instruments == paths.size());
+    assert(expected.fills > 0 && expected.cancels > 0);
+    assert(expected.adds + expected.cancels == expected.messages);
+
+    // 多线程合并后的统计与成交（按品种分组、品种内按回放顺序）与单线程一致
+    BacktestStats merged = parallel.run();
+    assert_same_stats(expected, merged);
+    assert_same_fills(single.fills(), parallel.fills());
+
+    // 再次运行结果不变：run 不修改配置
+    BacktestStats again = parallel.run();
+    assert_same_stats(expected, again);
+    assert_same_fills(single.fills(), parallel.fills());
+
+    for (const auto& path : paths) {
+        unlink(path.c_str());
+    }
+
+    std::cout << "[PASSED] Backtest runner test.\n";
+}
+
+// 策略看到的每个事件：模拟时间、类型、订单号或定时器标签，以及三个数值
+using SimLog = std::vector<std::tuple<uint64_t, char, uint64_t, int64_t, int64_t, int64_t>>;
+
+static MarketData market(MsgType type, uint32_t id, uint32_t timestamp, int32_t price, uint32_t volume, uint8_t side) {
+    MarketData md = {};
+    md.type = type;
+    md.order_id = id;
+    md.timestamp = timestamp;
+    md.price = price;
+    md.volume = volume;
+    md.side = side;
+    return md;
+}
+
+// 记录所有回调的策略，子类在回调中下单
+class LoggingStrategy : public Strategy {
+public:
+    SimLog log;
+
+    void on_top_of_book(Simulator& sim, const TopOfBook& top) override {
+        log.emplace_back(sim.now(), 'T', top.venue_time, top.bid, top.ask, static_cast<int64_t>(top.bid_volume) << 32 | top.ask_volume);
+    }
+    void on_ack(Simulator& sim, const AckReport& ack) override {
+        log.emplace_back(sim.now(), 'A', ack.order_id, ack.order_price, ack.remaining_volume, ack.order_timestamp);
+    }
+    void on_fill(Simulator& sim, const SimFill& fill) override {
+        log.emplace_back(sim.now(), 'F', fill.order_id, fill.price, fill.volume, fill.maker);
+    }
+    void on_cancel(Simulator& sim, const CancelReport& cancel) override {
+        log.emplace_back(sim.now(), 'X', cancel.order_id, cancel.cancelled_volume, 0, 0);
+    }
+    void on_reject(Simulator& sim, uint32_t order_id) override {
+        log.emplace_back(sim.now(), 'R', order_id, 0, 0, 0);
+    }
+    void on_timer(Simulator& sim, uint64_t tag) override {
+        log.emplace_back(sim.now(), 'M', tag, 0, 0, 0);
+    }
+};
+
+void run_simulator_test() {
+    SimConfig config;
+    config.feed_latency_ns = 5000;
+    config.order_latency_ns = 10000;
+    config.report_latency_ns = 7000;
+
+    // 卖单 41 一笔；价格 40 的买单占满该档位的 8 个买方槽位
+    std::vector<MarketData> recording;
+    recording.push_back(market(MsgType::ORDER_ADD, 1, 1000, 41, 2, 1));
+    for (uint32_t i = 0; i < 8; ++i) {
+        recording.push_back(market(MsgType::ORDER_ADD, 10 + i, 2000, 40, 1, 0));
+    }
+    recording.push_back(market(MsgType::ORDER_ADD, 20, 100000, 30, 1, 0));
+
+    struct Scripted : LoggingStrategy {
+        uint32_t a = 0, b = 0;
+        void on_start(Simulator& sim) override {
+            sim.set_timer(500, 1);
+            sim.set_timer(5000, 2);  // 与第一次盘口推送同一时刻，先调度者先到
+            a = sim.send(Side::BID, 41, 5);
+        }
+        void on_timer(Simulator& sim, uint64_t tag) override {
+            LoggingStrategy::on_timer(sim, tag);
+            if (tag == 1) {
+                b = sim.send(Side::BID, 42, 1);
+                sim.cancel(10);  // 第三方订单，交易所拒绝
+            }
+        }
+    } strategy;
+
+    Simulator sim(recording.data(), recording.size(), strategy, config);
+    sim.run();
+
+    SimLog expected = {
+        {1500, 'M', 1, 0, 0, 0},
+        {6000, 'M', 2, 0, 0, 0},
+        {6000, 'T', 1000, 0, 41, 2},
+    };
+    for (int64_t i = 1; i <= 8; ++i) {
+        expected.emplace_back(7000, 'T', 2000, 40, 41, i << 32 | 2);
+    }
+    // 11000 订单 a 到达：吃掉 41 的 2 手，余量 3 无处挂单被撤；11500 订单 b 无成交且无法挂单被拒
+    expected.emplace_back(16000, 'T', 11000, 40, 0, int64_t(8) << 32);
+    expected.emplace_back(18000, 'F', strategy.a, 41, 2, 0);
+    expected.emplace_back(18000, 'X', strategy.a, 3, 0, 0);
+    expected.emplace_back(18500, 'R', strategy.b, 0, 0, 0);
+    expected.emplace_back(18500, 'R', 10, 0, 0, 0);
+    assert(strategy.log == expected);
+
+    const SimStats& stats = sim.stats();
+    assert(stats.market_messages == recording.size() && stats.market_rejects == 0);
+    assert(stats.orders_sent == 2 && stats.cancels_sent == 1 && stats.rejects == 2);
+    assert(stats.fills == 1 && stats.filled_volume == 2);
+    assert(stats.position == 2 && stats.cash == -82);
+
+    // 第三方订单仍在簿上
+    Order resting;
+    assert(sim.engine().order_book().find(10, resting) && resting.volume == 1);
+
+    // 随机策略在随机行情上运行两次，事件顺序与统计完全一致
+    std::mt19937 rng(7);
+    std::vector<MarketData> flow;
+    std::vector<uint32_t> live;
+    for (uint32_t i = 0; i < 20000; ++i) {
+        if (!live.empty() && rng() % 3 == 0) {
+            size_t k = rng() % live.size();
+            flow.push_back(market(MsgType::ORDER_CANCEL, live[k], i * 100, 0, 0, 0));
+            live[k] = live.back();
+            live.pop_back();
+        } else {
+            uint32_t id = i + 1;
+            uint8_t side = rng() & 1;
+            flow.push_back(market(MsgType::ORDER_ADD, id, i * 100, 36 + static_cast<int32_t>(rng() % 9), 1 + rng() % 5, side));
+            live.push_back(id);
+        }
+    }
+
+    struct Random : LoggingStrategy {
+        std::mt19937 rng{11};
+        std::vector<uint32_t> own;
+        void on_start(Simulator& sim) override { sim.set_timer(3000, 0); }
+        void on_top_of_book(Simulator& sim, const TopOfBook& top) override {
+            LoggingStrategy::on_top_of_book(sim, top);
+            if (rng() % 4 == 0) {
+                own.push_back(sim.send(rng() & 1 ? Side::ASK : Side::BID, 36 + static_cast<int32_t>(rng() % 9), 1 + rng() % 3));
+            }
+        }
+        void on_timer(Simulator& sim, uint64_t tag) override {
+            LoggingStrategy::on_timer(sim, tag);
+            if (!own.empty()) {
+                sim.cancel(own[rng() % own.size()]);
+            }
+            sim.set_timer(1000 + rng() % 5000, tag + 1);
+        }
+    };
+
+    SimLog logs[2];
+    SimStats runs[2];
+    for (int run = 0; run < 2; ++run) {
+        Random random;
+        Simulator replay(flow.data(), flow.size(), random, config);
+        replay.run();
+        logs[run] = random.log;
+        runs[run] = replay.stats();
+    }
+    assert(logs[0].size() > 1000 && logs[0] == logs[1]);
+    assert(runs[0].events == runs[1].events && runs[0].fills == runs[1].fills);
+    assert(runs[0].rejects == runs[1].rejects && runs[0].cash == runs[1].cash && runs[0].position == runs[1].position);
+    assert(runs[0].fills > 0 && runs[0].rejects > 0);
+
+    // 时间单调不减
+    for (size_t i = 1; i < logs[0].size(); ++i) {
+        assert(std::get<0>(logs[0][i - 1]) <= std::get<0>(logs[0][i]));
+    }
+
+    std::cout << "[PASSED] Simulator test.\n";
+}
+
+int main() {
+    run_runner_test();
+    run_simulator_test();
+
+    std::cout << "[TEST PASSED]" << std::endl;
+
+    return 0;
+}
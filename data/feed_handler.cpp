@@ -4,6 +4,19 @@
 #include <cstring>
 #include <sched.h>
 #include <arpa/inet.h>
+#include <time.h>
+#include <cstddef>
+#include <algorithm>
+#include <linux/filter.h>
+
+// Receiver of the calling thread in scaled mode
+static thread_local int t_receiver = -1;
+static thread_local MetricsWriter* t_metrics = nullptr;
+
+// Steering hash of an instrument: multiplicative, so consecutive instruments spread over receivers
+// whatever their count.
+static constexpr uint32_t STEERING_MULTIPLIER = 0x9E3779B1u;
+static constexpr uint32_t STEERING_SHIFT = 16;
 
 FeedHandler::FeedHandler(int cpu_core) : _cpu_core(cpu_core) {
     _stats.packets_received = 0;
@@ -25,15 +38,33 @@ void FeedHandler::stop() {
 
     _running.store(false, std::memory_order_release);
 
-    // Close socket
-    if (_fd >= 0) {
-        close(_fd);
-        _fd = -1;
-    }
-
     if (_thread.joinable()) {
         _thread.join();
     }
+    for (int i = 0; i < _receiver_count; ++i) {
+        Receiver& receiver = _receivers[i];
+        if (receiver.thread.joinable()) {
+            receiver.thread.join();
+        }
+        if (receiver.fd >= 0) {
+            close(receiver.fd);
+            receiver.fd = -1;
+        }
+    }
+
+    // Close sockets once the receive thread stopped polling them
+    for (int* fd : {&_fd, &_fd_b}) {
+        if (*fd >= 0) {
+            close(*fd);
+            *fd = -1;
+        }
+    }
+
+    // Flush the capture once nothing is received anymore
+    if (_capture) {
+        _capture->close();
+        std::cout << "Captured " << _capture->recorded() << " datagrams, dropped " << _capture->dropped() << std::endl;
+    }
 }
 
 void FeedHandler::bind_cpu_core() {
@@ -54,123 +85,393 @@ void FeedHandler::register_callback(MarketDataCallback cb) {
     _callback = std::move(cb);
 }
 
-void FeedHandler::start(const char* addr, int port) {
-    _fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
-    if (_fd < 0) {
+void FeedHandler::set_capture(const char* path) {
+    _capture_path = path;
+}
+
+void FeedHandler::set_line_b(const char* addr, int port) {
+    _line_b_addr = addr;
+    _line_b_port = port;
+    _window = std::make_unique<SequenceWindow<>>();
+    _arrivals = std::make_unique<Arrival[]>(SequenceWindow<>::SPAN);
+}
+
+void FeedHandler::set_receivers(int receivers, int first_cpu) {
+    _receiver_count = std::max(receivers, 0);
+    _first_cpu = first_cpu;
+    _receivers = _receiver_count ? std::make_unique<Receiver[]>(_receiver_count) : nullptr;
+}
+
+int FeedHandler::receiver_of(uint16_t instrument, int receivers) {
+    return static_cast<int>(((instrument * STEERING_MULTIPLIER) >> STEERING_SHIFT) % static_cast<uint32_t>(receivers));
+}
+
+int FeedHandler::current_receiver() {
+    return t_receiver;
+}
+
+MetricsWriter& FeedHandler::metrics() {
+    return t_metrics ? *t_metrics : _metrics;
+}
+
+const FeedStats& FeedHandler::stats() const {
+    if (_receiver_count > 0) {
+        uint64_t packets = 0, updates = 0;
+        for (int i = 0; i < _receiver_count; ++i) {
+            packets += _receivers[i].stats.packets_received.load(std::memory_order_relaxed);
+            updates += _receivers[i].stats.updates_processed.load(std::memory_order_relaxed);
+        }
+        _stats.packets_received.store(packets, std::memory_order_relaxed);
+        _stats.updates_processed.store(updates, std::memory_order_relaxed);
+    }
+    return _stats;
+}
+
+// Classic BPF program choosing the socket of a SO_REUSEPORT group for each datagram, see receiver_of.
+// It runs on the UDP payload: the instrument of the first entry, little endian like the host that
+// wrote it, is read a byte at a time (absolute loads are big endian). A datagram too short to hold
+// it aborts the program, which returns 0: the first socket.
+static bool attach_steering(int fd, int receivers) {
+    constexpr uint32_t offset = offsetof(MarketData, instrument);
+    sock_filter code[] = {
+        BPF_STMT(BPF_LD | BPF_B | BPF_ABS, offset + 1),               // A = high byte
+        BPF_STMT(BPF_ALU | BPF_LSH | BPF_K, 8),
+        BPF_STMT(BPF_MISC | BPF_TAX, 0),                              // X = A
+        BPF_STMT(BPF_LD | BPF_B | BPF_ABS, offset),                   // A = low byte | X
+        BPF_STMT(BPF_ALU | BPF_OR | BPF_X, 0),
+        BPF_STMT(BPF_ALU | BPF_MUL | BPF_K, STEERING_MULTIPLIER),
+        BPF_STMT(BPF_ALU | BPF_RSH | BPF_K, STEERING_SHIFT),
+        BPF_STMT(BPF_ALU | BPF_MOD | BPF_K, static_cast<uint32_t>(receivers)),
+        BPF_STMT(BPF_RET | BPF_A, 0),                                 // Index of the socket in the group
+    };
+    sock_fprog program = {static_cast<unsigned short>(sizeof(code) / sizeof(code[0])), code};
+    if (setsockopt(fd, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &program, sizeof(program)) < 0) {
+        perror("setsockopt SO_ATTACH_REUSEPORT_CBPF");
+        return false;
+    }
+    return true;
+}
+
+int FeedHandler::open_socket(const char* addr, int port, sockaddr_in& saddr, bool reuse_port) {
+    int fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+    if (fd < 0) {
         perror("socket");
-        return;
+        return -1;
     }
 
     // Enables reuse of local addresses; useful for restarting server quickly
     int opt = 1;
-    if (setsockopt(_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0) {
+    if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0) {
         std::cerr << "Setsockopt SO_REUSEADDR failed" << std::endl;
-        close(_fd);
-        return;
+        close(fd);
+        return -1;
+    }
+    if (reuse_port && setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) < 0) {
+        perror("setsockopt SO_REUSEPORT");
+        close(fd);
+        return -1;
     }
 
-    sockaddr_in saddr{};
     memset(&saddr, 0, sizeof(saddr));
     saddr.sin_family = AF_INET;
     saddr.sin_port = htons(port);
     inet_pton(AF_INET, addr, &saddr.sin_addr);
 
-    if (bind(_fd, (sockaddr*)&saddr, sizeof(saddr)) < 0) {
+    if (bind(fd, (sockaddr*)&saddr, sizeof(saddr)) < 0) {
         perror("bind");
-        close(_fd);
-        _fd = -1;
-        return;
+        close(fd);
+        return -1;
     }
 
     if (strcmp(addr, "127.0.0.1") != 0) {
         ip_mreq mreq;
         inet_pton(AF_INET, addr, &mreq.imr_multiaddr);
         mreq.imr_interface.s_addr = htonl(INADDR_ANY);
-        if (setsockopt(_fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0) {
+        if (setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0) {
             perror("setsockopt");
+            close(fd);
+            return -1;
+        }
+    }
+    return fd;
+}
+
+void FeedHandler::start(const char* addr, int port) {
+    if (_receiver_count > 0) {
+        start_receivers(addr, port);
+        return;
+    }
+
+    sockaddr_in saddr{};
+    _fd = open_socket(addr, port, saddr);
+    if (_fd < 0) {
+        return;
+    }
+
+    if (arbitrated()) {
+        sockaddr_in saddr_b{};
+        _fd_b = open_socket(_line_b_addr.c_str(), _line_b_port, saddr_b);
+        if (_fd_b < 0) {
             close(_fd);
             _fd = -1;
             return;
         }
     }
 
+    if (!_capture_path.empty()) {
+        _capture = std::make_unique<PcapCapture>();
+        if (!_capture->open(_capture_path.c_str(), saddr)) {
+            _capture.reset();
+        }
+    }
+
     _running.store(true, std::memory_order_release);
 
    _thread = std::thread(&FeedHandler::receive_loop, this);
 
 }
 
+void FeedHandler::start_receivers(const char* addr, int port) {
+    in_addr group{};
+    if (inet_pton(AF_INET, addr, &group) != 1 || IN_MULTICAST(ntohl(group.s_addr))) {
+        std::cerr << "Scaled receive needs a unicast address, not " << addr << std::endl;
+        return;
+    }
+    if (arbitrated() || !_capture_path.empty()) {
+        std::cerr << "Scaled receive supports neither arbitration nor capture" << std::endl;
+        return;
+    }
+
+    // Sockets join the group in order, the steering program returns their index
+    for (int i = 0; i < _receiver_count; ++i) {
+        sockaddr_in saddr{};
+        _receivers[i].fd = open_socket(addr, port, saddr, true);
+        if (_receivers[i].fd < 0) {
+            for (int j = 0; j < i; ++j) {
+                close(_receivers[j].fd);
+                _receivers[j].fd = -1;
+            }
+            return;
+        }
+        _receivers[i].cpu = _first_cpu < 0 ? -1 : _first_cpu + i;
+    }
+
+    // Attached to one socket, it applies to the whole group
+    _steered = attach_steering(_receivers[0].fd, _receiver_count);
+    if (!_steered) {
+        std::cerr << "Steering unavailable, datagrams are spread by address hash" << std::endl;
+    }
+
+    _running.store(true, std::memory_order_release);
+    for (int i = 0; i < _receiver_count; ++i) {
+        _receivers[i].thread = std::thread(&FeedHandler::receiver_loop, this, i);
+    }
+}
+
+void FeedHandler::receiver_loop(int i) {
+    Receiver& receiver = _receivers[i];
+    if (receiver.cpu >= 0) {
+        cpu_set_t cpuset;
+        CPU_ZERO(&cpuset);
+        CPU_SET(receiver.cpu, &cpuset);
+        if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset) != 0) {
+            std::cerr << "Failed to bind receiver " << i << " to CPU core " << receiver.cpu << ": " << strerror(errno) << std::endl;
+        }
+    }
+
+    if (_metrics_region) {
+        std::string name = "feed" + std::to_string(i);
+        receiver.metrics = MetricsWriter(_metrics_region->register_thread(name.c_str()));
+    }
+    t_receiver = i;
+    t_metrics = &receiver.metrics;
+
+    alignas(64) char buffer[1024];
+    sockaddr_in src{};
+    socklen_t len = sizeof(src);
+
+    while (_running.load(std::memory_order_acquire)) {
+        ssize_t received = recvfrom(receiver.fd, buffer, sizeof(buffer), 0, (sockaddr*)&src, &len);
+        if (received < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                perror("recvfrom");
+            }
+            _mm_pause();
+            continue;
+        }
+        process(buffer, received, src, -1, receiver.stats, receiver.metrics);
+    }
+}
+
 
 void FeedHandler::receive_loop() {
     if (_cpu_core >= 0) {
         bind_cpu_core();
     }
 
+    // Claimed from the receive thread: the slot has a single writer
+    if (_metrics_region) {
+        _metrics = MetricsWriter(_metrics_region->register_thread("feed"));
+    }
+
     alignas(64) char buffer[1024];
     sockaddr_in src{};
     socklen_t len = sizeof(src);
 
+    // Arbitration polls line A then line B, so neither can starve the other
+    const int fds[2] = {_fd, _fd_b};
+    const int lines = arbitrated() ? 2 : 1;
+
     while (_running.load(std::memory_order_acquire)) {
-        ssize_t received = recvfrom(_fd, buffer, sizeof(buffer), 0, (sockaddr*)&src, &len);
-        
-        // Non-stopping receive
-        if (received < 0) {
-            // Busy polling
-            if (errno == EAGAIN || errno == EWOULDBLOCK) {
-                _mm_pause();
-                continue;
-            } else {
-                perror("recvfrom");
+        bool idle = true;
+        for (int line = 0; line < lines; ++line) {
+            ssize_t received = recvfrom(fds[line], buffer, sizeof(buffer), 0, (sockaddr*)&src, &len);
+
+            // Non-stopping receive
+            if (received < 0) {
+                if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                    perror("recvfrom");
+                }
                 continue;
             }
+            idle = false;
+            process(buffer, received, src, lines == 2 ? line : -1, _stats, _metrics);
         }
 
-        _stats.packets_received++;
+        // Busy polling
+        if (idle) {
+            _mm_pause();
+        }
+    }
+}
+
+void FeedHandler::process(const char* buffer, ssize_t received, const sockaddr_in& src, int line,
+                          FeedStats& stats, MetricsWriter& metrics) {
+    // Callbacks below update the same slot, inside one snapshot
+    metrics.begin();
+    metrics.add(Counter::PACKETS);
+
+    uint64_t arrival_ns = 0;
+    if (_capture || line >= 0) {
+        timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        arrival_ns = ts.tv_sec * 1000000000ull + ts.tv_nsec;
+    }
+
+    if (_capture) {
+        if (!_capture->record(buffer, received, src, arrival_ns)) {
+            metrics.add(Counter::DROPS);
+        }
+        metrics.set(Gauge::QUEUE_DEPTH, static_cast<int64_t>(_capture->depth()));
+    }
+
+    stats.packets_received++;
+    if (line >= 0) {
+        _line_stats[line].packets++;
+    }
+    if (_verbose) {
         std::cout << "Received " << received << " bytes, ";
+    }
+
+    size_t count = received / sizeof(MarketData);
+    // std::cout << count << " MarketData entries" << std::endl;
 
-        size_t count = received / sizeof(MarketData);
-        // std::cout << count << " MarketData entries" << std::endl;
+    size_t valid_entries = 0;
+    size_t dropped = 0;  // Copies lost to arbitration
 
-        size_t valid_entries = 0;
+    for (size_t i = 0; i < count; ++i) {
+        // struct alignas(64) MarketData {
+        //     MsgType  type;       
+        //     uint32_t order_id;    
+        //     uint32_t timestamp;
+        //     int32_t  price;       // $0.01/unit
+        //     uint32_t volume;
+        //     uint8_t  side;        // Bid: 0, Ask: 1;
+        //     uint16_t instrument;
+        //     uint32_t sequence;
+        // };
+        const MarketData* md = reinterpret_cast<const MarketData*>(buffer + i * sizeof(MarketData));
 
-        for (size_t i = 0; i < count; ++i) {
-            // struct alignas(64) MarketData {
-            //     MsgType  type;       
-            //     uint32_t order_id;    
-            //     uint32_t timestamp;
-            //     int32_t  price;       // $0.01/unit
-            //     uint32_t volume;
-            //     uint8_t  side;        // Bid: 0, Ask: 1;
-            // };
-            const MarketData* md = reinterpret_cast<const MarketData*>(buffer + i * sizeof(MarketData));
+        if (line >= 0 && !arbitrate(*md, line, arrival_ns)) {
+            dropped++;
+            continue;
+        }
 
+        if (_verbose) {
             std::cout << "MarketData id" << md->order_id
             << " time stamp " << md->timestamp 
             << ": price=" << md->price
             << ", volume=" << md->volume 
             << ", side=" << (int)md->side
             << ", type=" << (char)md->type << std::endl;
+        }
 
+        
+        if ( // Validate ORDER ADD
+            (md->type == MsgType::ORDER_ADD) && 
+            (md->price > 0) && 
+            (md->volume > 0) && 
+            (md->side == 0 || md->side == 1)
+        ) {
+            _callback(*md);
+            valid_entries++;
             
-            if ( // Validate ORDER ADD
-                (md->type == MsgType::ORDER_ADD) && 
-                (md->price > 0) && 
-                (md->volume > 0) && 
-                (md->side == 0 || md->side == 1)
-            ) {
-                _callback(*md);
-                valid_entries++;
-                
-            } else if ( // Validate ORDER CANCEL
-                md->type == MsgType::ORDER_CANCEL
-            ) {
-                _callback(*md);
-                valid_entries++;
-            } else {
-                std::cout << "Skipping invalid order id" << md->order_id << std::endl;
-            }
+        } else if ( // Validate ORDER CANCEL, ORDER DELETE
+            md->type == MsgType::ORDER_CANCEL || md->type == MsgType::ORDER_DELETE
+        ) {
+            _callback(*md);
+            valid_entries++;
+        } else if ( // Validate ORDER EXECUTE
+            (md->type == MsgType::ORDER_EXECUTE) &&
+            (md->volume > 0)
+        ) {
+            _callback(*md);
+            valid_entries++;
+        } else if (_verbose) {
+            std::cout << "Skipping invalid order id" << md->order_id << std::endl;
         }
+    }
+
+    stats.updates_processed += valid_entries;
+    metrics.add(Counter::MESSAGES, valid_entries);
+    metrics.add(Counter::REJECT_INVALID, count - dropped - valid_entries);
+    metrics.add(Counter::DUPLICATES, dropped);
+    metrics.end();
+}
+
+bool FeedHandler::arbitrate(const MarketData& md, int line, uint64_t arrival_ns) {
+    if (md.sequence == 0) {
+        return line == 0;
+    }
+
+    LineStats& stats = _line_stats[line];
+    stats.messages++;
+    Arrival& arrival = _arrivals[md.sequence & (SequenceWindow<>::SPAN - 1)];
+
+    switch (_window->claim(md.sequence)) {
+        case SequenceWindow<>::Claim::FIRST:
+            stats.wins++;
+            arrival = {md.sequence, static_cast<uint8_t>(line), arrival_ns};
+            return true;
+
+        case SequenceWindow<>::Claim::DUPLICATE:
+            stats.duplicates++;
+            // The other line won: credit it once with its head start. A second copy on the
+            // winning line is only a duplicate
+            if (arrival.sequence == md.sequence && arrival.line != line) {
+                LineStats& winner = _line_stats[arrival.line];
+                uint64_t lead = arrival_ns > arrival.ns ? arrival_ns - arrival.ns : 0;
+                winner.leads++;
+                winner.lead_ns += lead;
+                if (lead > winner.max_lead_ns.load(std::memory_order_relaxed)) {
+                    winner.max_lead_ns.store(lead, std::memory_order_relaxed);
+                }
+                arrival.sequence = 0;  // Credited: 0 matches no sequenced entry
+            }
+            return false;
 
-        _stats.updates_processed += valid_entries;
+        default:
+            stats.stale++;
+            return false;
     }
 }
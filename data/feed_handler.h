@@ -1,8 +1,13 @@
 #pragma once
 #include "market_data.h"
+#include "pcap_capture.h"
+#include "metrics.h"
+#include "sequence_window.h"
 #include <functional>
 #include <thread>
 #include <atomic>
+#include <memory>
+#include <string>
 #include <netinet/in.h>
 
 struct alignas(64) FeedStats {
@@ -10,6 +15,18 @@ struct alignas(64) FeedStats {
     std::atomic<uint64_t> updates_processed{0}; // < Number of valid market data entries processed.
 };
 
+// Per line counters of an arbitrated A/B feed (see FeedHandler::set_line_b).
+struct alignas(64) LineStats {
+    std::atomic<uint64_t> packets{0};
+    std::atomic<uint64_t> messages{0};     // Sequenced entries received
+    std::atomic<uint64_t> wins{0};         // Delivered from this line: its copy arrived first
+    std::atomic<uint64_t> duplicates{0};   // Copies the other line already delivered, dropped
+    std::atomic<uint64_t> stale{0};        // Behind the dedup window, dropped
+    std::atomic<uint64_t> leads{0};        // Wins whose copy on the other line arrived too,
+    std::atomic<uint64_t> lead_ns{0};      // and the sum and maximum of the head start
+    std::atomic<uint64_t> max_lead_ns{0};
+};
+
 class FeedHandler {
 public:
     using MarketDataCallback = std::function<void(const MarketData&)>;
@@ -20,27 +37,136 @@ public:
 
     void start(const char* addr, int port);
 
+    // Arbitration mode: also receive the redundant B line on addr:port, must be called before start.
+    // The receive thread polls both sockets and delivers each sequenced entry once, from whichever
+    // line brought it first. Unsequenced entries (sequence 0) are taken from line A only.
+    void set_line_b(const char* addr, int port);
+
+    bool arbitrated() const { return !_line_b_addr.empty(); }
+
+    // Scaled mode: receive on receivers SO_REUSEPORT sockets bound to the same port, each drained by
+    // its own thread pinned to first_cpu + i (-1: not pinned). Must be called before start.
+    // A steering program attached to the socket group sends each datagram to the socket its first
+    // entry's instrument hashes to, so an instrument whose datagrams carry only its own entries is
+    // always received by the same thread, in order. Callbacks then run concurrently on the receive
+    // threads and may only share per instrument state. Unicast only (every socket of a group gets
+    // its own copy of multicast), without arbitration or capture.
+    void set_receivers(int receivers, int first_cpu = -1);
+
+    // Receive threads of scaled mode, 0 otherwise.
+    int receivers() const { return _receiver_count; }
+
+    // Scaled mode: whether the steering program is attached. If not, the kernel spreads datagrams
+    // by a hash of their addresses and ports, so only each sender's own datagrams stay in order.
+    bool steered() const { return _steered; }
+
+    // Socket of the group the steering program picks for a datagram whose first entry is of instrument.
+    static int receiver_of(uint16_t instrument, int receivers);
+
+    // Scaled mode: index of the calling receive thread, -1 from any other thread.
+    static int current_receiver();
+
     void stop();
 
     bool is_running() const;
 
     void register_callback(MarketDataCallback cb);
 
+    // Record every received datagram to a pcap file at path, must be called before start.
+    void set_capture(const char* path);
+
+    // Print every received packet and entry (default true).
+    void set_verbose(bool verbose) { _verbose = verbose; }
+
+    // Publish feed metrics into a slot of region, claimed by the receive thread. Must be called before start.
+    void set_metrics(MetricsRegion* region) { _metrics_region = region; }
+
+    // Metrics slot of the receive thread, callbacks run on it and may add to it.
+    // In scaled mode each receive thread has its own: call it from the callback.
+    MetricsWriter& metrics();
+
     void bind_cpu_core();
     
     void receive_loop();
 
-    const FeedStats& stats() const { return _stats; }
+    // In scaled mode, the sum of every receive thread's stats.
+    const FeedStats& stats() const;
+
+    // Scaled mode: stats of receive thread i.
+    const FeedStats& receiver_stats(int i) const { return _receivers[i].stats; }
+
+    // Arbitration: whether the entry of line (0: A, 1: B), received at arrival_ns, gets delivered.
+    // Called by the receive thread, after set_line_b.
+    bool arbitrate(const MarketData& md, int line, uint64_t arrival_ns);
+
+    // Line 0: A, 1: B. Only counted in arbitration mode.
+    const LineStats& line_stats(int line) const { return _line_stats[line]; }
+
+    // Capture in progress, nullptr if none.
+    const PcapCapture* capture() const { return _capture.get(); }
 
 private:
+    // Open a non blocking UDP socket bound to addr:port, joining the group if addr is multicast.
+    // With reuse_port the socket joins the SO_REUSEPORT group of the port.
+    int open_socket(const char* addr, int port, sockaddr_in& saddr, bool reuse_port = false);
+
+    // Scaled mode: open the socket group, steer it and start a thread per socket.
+    void start_receivers(const char* addr, int port);
+
+    // Scaled mode: drain the socket of receiver i.
+    void receiver_loop(int i);
+
+    // Handle one datagram of line (0: A, 1: B, -1: not arbitrated), counted in stats and metrics.
+    void process(const char* buffer, ssize_t received, const sockaddr_in& src, int line,
+                 FeedStats& stats, MetricsWriter& metrics);
+
     int _fd = -1;
+    int _fd_b = -1;
     int _cpu_core = -1;
 
     std::atomic<bool> _running{false};
 
     std::thread _thread;
 
-    FeedStats _stats;   
+    mutable FeedStats _stats;  // Scaled mode: sum of the receivers', refreshed by stats()
     
     MarketDataCallback _callback;
+
+    bool _verbose = true;
+
+    std::string _capture_path;
+
+    std::unique_ptr<PcapCapture> _capture;
+
+    MetricsRegion* _metrics_region = nullptr;
+
+    MetricsWriter _metrics;
+
+    std::string _line_b_addr;
+    int _line_b_port = 0;
+
+    LineStats _line_stats[2];
+
+    std::unique_ptr<SequenceWindow<>> _window;
+
+    // Arrival of the winning copy of each sequence in the window, to time the losing line
+    struct Arrival {
+        uint32_t sequence;
+        uint8_t line;
+        uint64_t ns;
+    };
+    std::unique_ptr<Arrival[]> _arrivals;
+
+    // Scaled mode: one socket and thread per receiver, each counting on its own cache lines
+    struct Receiver {
+        int fd = -1;
+        int cpu = -1;
+        std::thread thread;
+        FeedStats stats;
+        MetricsWriter metrics;
+    };
+    std::unique_ptr<Receiver[]> _receivers;
+    int _receiver_count = 0;
+    int _first_cpu = -1;
+    bool _steered = false;
 };
@@ -3,10 +3,12 @@
 #include "../order/orderbook.h"
 #include "../order/order.h"
 #include "../order/match_tier_avx512.h"
+#include "../order/book_builder.h"
 #include <iostream>
 #include <thread>
 #include <chrono>
 #include <csignal>
+#include <unistd.h>
 
 std::atomic<bool> signal_received{false};
 
@@ -18,39 +20,91 @@ void signal_handler(int signal) {
     }
 }
 
-int main() {
+int main(int argc, char** argv) {
+    // -c capture.pcap: record received datagrams, -q: no per message output,
+    // -m name: shared memory metrics object (read with metrics_reader),
+    // -b instruments: build the books of a third party feed instead of matching it,
+    // -B port: arbitrate with the redundant B line of the feed on port
+    const char* capture_path = nullptr;
+    const char* metrics_name = "/hft_metrics";
+    bool verbose = true;
+    size_t instruments = 0;
+    int line_b_port = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "c:qm:b:B:")) != -1) {
+        switch (opt) {
+            case 'c': capture_path = optarg; break;
+            case 'q': verbose = false; break;
+            case 'm': metrics_name = optarg; break;
+            case 'b': instruments = std::strtoul(optarg, nullptr, 10); break;
+            case 'B': line_b_port = atoi(optarg); break;
+            default:
+                std::cerr << "Usage: " << argv[0] << " [-c capture.pcap] [-q] [-m metrics_name] [-b instruments] [-B port]" << std::endl;
+                return 1;
+        }
+    }
+
     // Register signal handler
     std::signal(SIGINT, signal_handler);
     std::signal(SIGTERM, signal_handler);
 
     MatchingEngine engine;
 
+    OrderBook& book = engine.order_book();
+    FeedHandler feed(2);
+    feed.set_verbose(verbose);
+    if (capture_path) {
+        feed.set_capture(capture_path);
+    }
+    if (line_b_port) {
+        feed.set_line_b("127.0.0.1", line_b_port);
+    }
+
+    // Metrics are optional: without a region every update is a no-op
+    MetricsRegion metrics_region;
+    if (metrics_region.create(metrics_name)) {
+        feed.set_metrics(&metrics_region);
+    } else {
+        std::cerr << "Metrics disabled: can't create " << metrics_name << std::endl;
+    }
+
+    // Engine callbacks run on the receive thread and report into its metrics slot
+    MetricsWriter& metrics = feed.metrics();
+
     // Register on_fill, on_ack, on_cancel
-    engine.on_fill = [&](const FillReport& report) {
-        std::cout << "[FILL] taker_order_id=" << report.taker_order_id
-                    << ", maker_order_id=" << report.maker_order_id
-                    << ", price=" << report.traded_price 
-                    << ", volume=" << report.traded_volume << std::endl;
-                    
+    engine.on_fill = [&metrics, verbose](const FillReport& report) {
+        metrics.add(Counter::FILLS);
+        metrics.add(Counter::FILLED_VOLUME, report.traded_volume);
+        if (verbose) {
+            std::cout << "[FILL] taker_order_id=" << report.taker_order_id
+                        << ", maker_order_id=" << report.maker_order_id
+                        << ", price=" << report.traded_price 
+                        << ", volume=" << report.traded_volume << std::endl;
+        }
     };
 
-    engine.on_ack = [&](const AckReport& report) {
-        std::cout << "[ACK] order_id=" << report.order_id
-        << ", time stamp=" << report.order_timestamp
-        << ", price=" << report.order_price
-        << ", remaining volume=" << report.remaining_volume
-        << ", side=" << static_cast<int>(report.order_side) << std::endl;
+    engine.on_ack = [&metrics, verbose](const AckReport& report) {
+        metrics.add(Counter::ACKS);
+        if (verbose) {
+            std::cout << "[ACK] order_id=" << report.order_id
+            << ", time stamp=" << report.order_timestamp
+            << ", price=" << report.order_price
+            << ", remaining volume=" << report.remaining_volume
+            << ", side=" << static_cast<int>(report.order_side) << std::endl;
+        }
     };
 
-    engine.on_cancel = [&](const CancelReport& report) {
-        std::cout << "[CANCEL] order_id=" << report.order_id
-                    << ", volume=" << report.cancelled_volume << std::endl;
+    engine.on_cancel = [&metrics, verbose](const CancelReport& report) {
+        metrics.add(Counter::CANCELS);
+        if (verbose) {
+            std::cout << "[CANCEL] order_id=" << report.order_id
+                        << ", volume=" << report.cancelled_volume << std::endl;
+        }
     };
 
-    OrderBook& book = engine.order_book();
-    FeedHandler feed(2);
+    uint64_t messages = 0;
 
-    feed.register_callback([&engine, &book](const MarketData& market_data) {
+    feed.register_callback([&engine, &book, &metrics, &messages, verbose](const MarketData& market_data) {
         // enum class MsgType : uint8_t {
         //     ORDER_ADD    = 'A',
         //     ORDER_CANCEL = 'X',
@@ -84,22 +138,87 @@ int main() {
         // EXECUTE ADD
         if (market_data.type == MsgType::ORDER_ADD) {
             if (!engine.match(o)) {
-                std::cout << "[ERROR ADD ORDER] Order id " << o.id << std::endl;
+                metrics.add(Counter::REJECT_ADD);
+                if (verbose) {
+                    std::cout << "[ERROR ADD ORDER] Order id " << o.id << std::endl;
+                }
             }
         }
 
-        // EXECUTE CANCEL
-        if (market_data.type == MsgType::ORDER_CANCEL) {
-            if(!engine.cancel_order(o.id)) {
-                std::cout << "[ERROR CANCEL ORDER] Order id " << o.id << std::endl;
+        // EXECUTE CANCEL, executions are the engine's own fills
+        if (market_data.type == MsgType::ORDER_CANCEL || market_data.type == MsgType::ORDER_DELETE) {
+            if (!engine.cancel_order(o.id)) {
+                metrics.add(Counter::REJECT_CANCEL);
+                if (verbose) {
+                    std::cout << "[ERROR CANCEL ORDER] Order id " << o.id << std::endl;
+                }
             }
         }
 
+        // Book gauges are sampled: a full pass touches every tier
+        if ((++messages & 1023) == 0 && metrics.enabled()) {
+            for (size_t t = 0; t < OrderBook::MAX_TIERS; ++t) {
+                OrderBook::Tier& tier = book.get_tier(t);
+                metrics.set_tier(t, tier.count(Side::BID), tier.count(Side::ASK));
+            }
+            metrics.set(Gauge::RESTING_ORDERS, static_cast<int64_t>(book.get_map().size()));
+            metrics.set(Gauge::BID_LEVELS, static_cast<int64_t>(book.get_levels().bids.size));
+            metrics.set(Gauge::ASK_LEVELS, static_cast<int64_t>(book.get_levels().asks.size));
+        }
+
         // Print new best bid and ask
-        auto [bid, ask] = book.get_top_of_book();
-        std::cout << "[TOP OF BOOK] Bid: " << bid << ", Ask: " << ask << std::endl;
+        if (verbose) {
+            auto [bid, ask] = book.get_top_of_book();
+            std::cout << "[TOP OF BOOK] Bid: " << bid << ", Ask: " << ask << std::endl;
+        }
     });
 
+    // Book building: the feed was already matched by its venue, so instead of matching it
+    // apply it to one passive book per instrument
+    std::unique_ptr<BookBuilder> builder;
+    if (instruments > 0) {
+        builder = std::make_unique<BookBuilder>(instruments);
+        feed.register_callback([&books = *builder, &metrics, verbose](const MarketData& market_data) {
+            uint16_t instrument = market_data.instrument;
+            bool applied = false;
+            switch (market_data.type) {
+                case MsgType::ORDER_ADD:
+                    applied = books.add(instrument, Order{
+                        .id = market_data.order_id,
+                        .timestamp = market_data.timestamp,
+                        .price = market_data.price,
+                        .volume = market_data.volume,
+                        .side = market_data.side == 1 ? Side::ASK : Side::BID
+                    });
+                    break;
+                case MsgType::ORDER_EXECUTE:
+                    applied = books.execute(instrument, market_data.order_id, market_data.volume);
+                    if (applied) {
+                        metrics.add(Counter::FILLS);
+                        metrics.add(Counter::FILLED_VOLUME, market_data.volume);
+                    }
+                    break;
+                case MsgType::ORDER_CANCEL:
+                    applied = books.cancel(instrument, market_data.order_id, market_data.volume);
+                    break;
+                case MsgType::ORDER_DELETE:
+                    applied = books.remove(instrument, market_data.order_id);
+                    break;
+            }
+
+            if (!applied) {
+                metrics.add(market_data.type == MsgType::ORDER_ADD ? Counter::REJECT_ADD : Counter::REJECT_CANCEL);
+                if (verbose) {
+                    std::cout << "[ERROR " << static_cast<char>(market_data.type) << "] Instrument " << instrument
+                              << ", order id " << market_data.order_id << std::endl;
+                }
+            } else if (verbose) {
+                auto [bid, ask] = books.top_of_book(instrument);
+                std::cout << "[TOP OF BOOK] Instrument: " << instrument << ", Bid: " << bid << ", Ask: " << ask << std::endl;
+            }
+        });
+    }
+
     feed.start("127.0.0.1", 50000);
 
     std::thread stats_thread([&feed]() {
@@ -107,6 +226,12 @@ int main() {
             const auto& stats = feed.stats();
             std::cout << "RX: " << stats.packets_received
                       << ", Updates: " << stats.updates_processed << std::endl;
+            for (int line = 0; line < 2 && feed.arbitrated(); ++line) {
+                const LineStats& ls = feed.line_stats(line);
+                std::cout << "  Line " << "AB"[line] << ": wins " << ls.wins
+                          << ", duplicates " << ls.duplicates
+                          << ", avg lead " << (ls.leads ? ls.lead_ns / ls.leads : 0) << " ns" << std::endl;
+            }
             std::this_thread::sleep_for(std::chrono::milliseconds(80));
         }
     });
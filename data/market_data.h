@@ -6,8 +6,10 @@
 // Market data type (compatible with ITCH 5.0 and binary protocols)
 
 enum class MsgType : uint8_t {
-    ORDER_ADD    = 'A',
-    ORDER_CANCEL = 'X',
+    ORDER_ADD     = 'A',
+    ORDER_CANCEL  = 'X',  // Book building: partial cancel of volume
+    ORDER_EXECUTE = 'E',  // Book building: volume of a resting order traded at the venue
+    ORDER_DELETE  = 'D',
 };
 
 // 64-byte aligned market data structure
@@ -18,6 +20,8 @@ struct alignas(64) MarketData {
     int32_t  price;       // $0.01/unit
     uint32_t volume;
     uint8_t  side;        // Bid: 0, Ask: 1;
+    uint16_t instrument;  // Book building: index of the instrument's book
+    uint32_t sequence;    // Feed sequence number for A/B arbitration, 0: unsequenced
 };
 
 // Compatible with AVX-512 instructions
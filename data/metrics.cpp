@@ -0,0 +1,122 @@
+#include "metrics.h"
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+const char* const COUNTER_NAMES[METRICS_COUNTERS] = {
+    "packets", "messages", "reject_invalid", "reject_add", "reject_cancel",
+    "acks", "fills", "filled_volume", "cancels", "drops",
+    "duplicates"
+};
+
+const char* const GAUGE_NAMES[METRICS_GAUGES] = {
+    "queue_depth", "resting_orders", "bid_levels", "ask_levels"
+};
+
+MetricsRegion::~MetricsRegion() {
+    if (_layout) {
+        munmap(_layout, sizeof(Layout));
+    }
+    if (_owner) {
+        shm_unlink(_name);
+    }
+}
+
+bool MetricsRegion::create(const char* name) {
+    // A stale region of a previous run is replaced, so readers never see a mix of both
+    shm_unlink(name);
+    int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0) {
+        perror("shm_open");
+        return false;
+    }
+    if (ftruncate(fd, sizeof(Layout)) < 0) {
+        perror("ftruncate");
+        close(fd);
+        shm_unlink(name);
+        return false;
+    }
+
+    void* addr = mmap(nullptr, sizeof(Layout), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        perror("mmap");
+        shm_unlink(name);
+        return false;
+    }
+
+    // The object is zero filled, only the header needs writing. Magic last: readers check it.
+    _layout = static_cast<Layout*>(addr);
+    _layout->header.version = MetricsHeader::VERSION;
+    _layout->header.max_threads = MAX_THREADS;
+    _layout->header.max_tiers = MetricsSlot::MAX_TIERS;
+    std::atomic_thread_fence(std::memory_order_release);
+    _layout->header.magic = MetricsHeader::MAGIC;
+
+    strncpy(_name, name, sizeof(_name) - 1);
+    _owner = true;
+    return true;
+}
+
+bool MetricsRegion::open(const char* name) {
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0) {
+        return false;
+    }
+    void* addr = mmap(nullptr, sizeof(Layout), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        return false;
+    }
+
+    const Layout* layout = static_cast<const Layout*>(addr);
+    if (layout->header.magic != MetricsHeader::MAGIC || layout->header.version != MetricsHeader::VERSION) {
+        munmap(addr, sizeof(Layout));
+        return false;
+    }
+    _layout = static_cast<Layout*>(addr);
+    return true;
+}
+
+MetricsSlot* MetricsRegion::register_thread(const char* thread_name) {
+    if (!_layout || !_owner) {
+        return nullptr;
+    }
+    uint32_t idx = _layout->header.threads.load(std::memory_order_relaxed);
+    do {
+        if (idx >= MAX_THREADS) {
+            return nullptr;
+        }
+    } while (!_layout->header.threads.compare_exchange_weak(idx, idx + 1, std::memory_order_acq_rel));
+
+    MetricsSlot* slot = &_layout->slots[idx];
+    strncpy(slot->name, thread_name, sizeof(slot->name) - 1);
+    return slot;
+}
+
+size_t MetricsRegion::threads() const {
+    return _layout ? _layout->header.threads.load(std::memory_order_acquire) : 0;
+}
+
+void MetricsRegion::snapshot(size_t i, MetricsSnapshot& out) const {
+    const MetricsSlot& slot = _layout->slots[i];
+    uint32_t before, after;
+    do {
+        before = slot.seq.load(std::memory_order_acquire);
+        memcpy(out.name, slot.name, sizeof(out.name));
+        for (size_t c = 0; c < METRICS_COUNTERS; ++c) {
+            out.counters[c] = slot.counters[c].load(std::memory_order_relaxed);
+        }
+        for (size_t g = 0; g < METRICS_GAUGES; ++g) {
+            out.gauges[g] = slot.gauges[g].load(std::memory_order_relaxed);
+        }
+        for (size_t t = 0; t < MetricsSlot::MAX_TIERS; ++t) {
+            out.tier_bids[t] = slot.tier_bids[t].load(std::memory_order_relaxed);
+            out.tier_asks[t] = slot.tier_asks[t].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        after = slot.seq.load(std::memory_order_relaxed);
+    } while ((before & 1) || before != after);
+}
@@ -0,0 +1,148 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Live metrics in POSIX shared memory, readable by other processes (see metrics_reader.cpp)
+// without any call into the trading process.
+// Every thread that reports owns one cache line aligned slot and is its only writer. Fields are
+// relaxed atomics, so an update is a plain load and store; a per slot seqlock around each batch
+// of updates lets readers take consistent snapshots.
+
+enum class Counter : uint32_t {
+    PACKETS,           // Datagrams received
+    MESSAGES,          // Valid MarketData entries
+    REJECT_INVALID,    // Entries failing validation
+    REJECT_ADD,        // Adds refused by the book (bad price, tier full)
+    REJECT_CANCEL,     // Cancels of unknown orders
+    ACKS,
+    FILLS,
+    FILLED_VOLUME,
+    CANCELS,
+    DROPS,             // Datagrams dropped by a full queue
+    DUPLICATES,        // A/B arbitration: entries the other line already delivered, or stale
+    COUNT
+};
+
+enum class Gauge : uint32_t {
+    QUEUE_DEPTH,       // Entries waiting in the thread's outbound queue
+    RESTING_ORDERS,
+    BID_LEVELS,
+    ASK_LEVELS,
+    COUNT
+};
+
+static constexpr size_t METRICS_COUNTERS = static_cast<size_t>(Counter::COUNT);
+static constexpr size_t METRICS_GAUGES = static_cast<size_t>(Gauge::COUNT);
+
+extern const char* const COUNTER_NAMES[METRICS_COUNTERS];
+extern const char* const GAUGE_NAMES[METRICS_GAUGES];
+
+struct MetricsHeader {
+    static constexpr uint32_t MAGIC = 0x4D544648; // "HFTM"
+    static constexpr uint32_t VERSION = 2;
+
+    uint32_t magic;
+    uint32_t version;
+    uint32_t max_threads;
+    uint32_t max_tiers;
+    std::atomic<uint32_t> threads;  // Slots registered so far
+};
+
+struct alignas(64) MetricsSlot {
+    static constexpr size_t MAX_TIERS = 256;
+
+    std::atomic<uint32_t> seq;      // Odd while the owner is updating
+    char name[28];
+    std::atomic<uint64_t> counters[METRICS_COUNTERS];
+    std::atomic<int64_t> gauges[METRICS_GAUGES];
+    std::atomic<uint32_t> tier_bids[MAX_TIERS];  // Resting orders per book tier
+    std::atomic<uint32_t> tier_asks[MAX_TIERS];
+};
+
+// Plain copy of a slot.
+struct MetricsSnapshot {
+    char name[28];
+    uint64_t counters[METRICS_COUNTERS];
+    int64_t gauges[METRICS_GAUGES];
+    uint32_t tier_bids[MetricsSlot::MAX_TIERS];
+    uint32_t tier_asks[MetricsSlot::MAX_TIERS];
+};
+
+// The shared memory object, created by the trading process and opened read only by readers.
+class MetricsRegion {
+public:
+    static constexpr size_t MAX_THREADS = 32;
+
+    MetricsRegion() = default;
+
+    // Unmap, and unlink the object if this process created it.
+    ~MetricsRegion();
+
+    MetricsRegion(const MetricsRegion&) = delete;
+    MetricsRegion& operator=(const MetricsRegion&) = delete;
+
+    // Create (or recreate) shm object name, e.g. "/hft_metrics". Return false on failure.
+    bool create(const char* name);
+
+    // Map an existing object read only. Return false if it doesn't exist or isn't a metrics region.
+    bool open(const char* name);
+
+    // Claim a slot for the calling thread, nullptr if all are taken.
+    MetricsSlot* register_thread(const char* thread_name);
+
+    size_t threads() const;
+
+    // Consistent copy of slot i, retry while its owner is updating.
+    void snapshot(size_t i, MetricsSnapshot& out) const;
+
+private:
+    struct Layout {
+        MetricsHeader header;
+        MetricsSlot slots[MAX_THREADS];
+    };
+
+    Layout* _layout = nullptr;
+    char _name[64] = {};
+    bool _owner = false;
+};
+
+// Writer side of one slot. Metrics are off when the slot is null, every call is then a single branch.
+class MetricsWriter {
+public:
+    explicit MetricsWriter(MetricsSlot* slot = nullptr) : _slot(slot) {}
+
+    bool enabled() const { return _slot != nullptr; }
+
+    // Bracket a batch of updates, readers retry a snapshot taken across it.
+    void begin() {
+        if (!_slot) return;
+        _slot->seq.store(_slot->seq.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    void end() {
+        if (!_slot) return;
+        _slot->seq.store(_slot->seq.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    void add(Counter c, uint64_t n = 1) {
+        if (!_slot) return;
+        std::atomic<uint64_t>& counter = _slot->counters[static_cast<size_t>(c)];
+        counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    void set(Gauge g, int64_t value) {
+        if (!_slot) return;
+        _slot->gauges[static_cast<size_t>(g)].store(value, std::memory_order_relaxed);
+    }
+
+    void set_tier(size_t tier, uint32_t bids, uint32_t asks) {
+        if (!_slot || tier >= MetricsSlot::MAX_TIERS) return;
+        _slot->tier_bids[tier].store(bids, std::memory_order_relaxed);
+        _slot->tier_asks[tier].store(asks, std::memory_order_relaxed);
+    }
+
+private:
+    MetricsSlot* _slot;
+};
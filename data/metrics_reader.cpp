@@ -0,0 +1,83 @@
+// Attach to the shared memory metrics of a running exchange and print totals and rates.
+// Reading never blocks or slows the writers: snapshots retry while a slot is being updated.
+#include "metrics.h"
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+
+int main(int argc, char** argv) {
+    const char* name = "/hft_metrics";
+    int interval_ms = 1000;
+    long iterations = 0;    // 0: until interrupted
+    bool show_tiers = false;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "m:i:n:t")) != -1) {
+        switch (opt) {
+            case 'm': name = optarg; break;
+            case 'i': interval_ms = std::max(1, atoi(optarg)); break;
+            case 'n': iterations = atol(optarg); break;
+            case 't': show_tiers = true; break;
+            default:
+                std::cerr << "Usage: " << argv[0] << " [-m metrics_name] [-i interval_ms] [-n iterations] [-t]\n"
+                          << "  -t: also print resting orders per book tier" << std::endl;
+                return 1;
+        }
+    }
+
+    MetricsRegion region;
+    if (!region.open(name)) {
+        std::cerr << "Can't open metrics " << name << " (is the exchange running?)" << std::endl;
+        return 1;
+    }
+
+    std::vector<MetricsSnapshot> previous(MetricsRegion::MAX_THREADS), current(MetricsRegion::MAX_THREADS);
+    auto last = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < region.threads(); ++i) {
+        region.snapshot(i, previous[i]);
+    }
+
+    for (long n = 0; iterations == 0 || n < iterations; ++n) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(interval_ms));
+        auto now = std::chrono::steady_clock::now();
+        double seconds = std::chrono::duration<double>(now - last).count();
+        last = now;
+
+        size_t threads = region.threads();
+        for (size_t i = 0; i < threads; ++i) {
+            region.snapshot(i, current[i]);
+            const MetricsSnapshot& cur = current[i];
+            const MetricsSnapshot& prev = previous[i];
+
+            std::cout << "[" << std::string(cur.name, strnlen(cur.name, sizeof(cur.name))) << "]\n";
+            for (size_t c = 0; c < METRICS_COUNTERS; ++c) {
+                // Slots registered since the last sample start from zero
+                uint64_t delta = cur.counters[c] >= prev.counters[c] ? cur.counters[c] - prev.counters[c] : cur.counters[c];
+                std::cout << "  " << std::left << std::setw(16) << COUNTER_NAMES[c]
+                          << std::right << std::setw(14) << cur.counters[c]
+                          << std::setw(14) << std::fixed << std::setprecision(0) << delta / seconds << "/s\n";
+            }
+            for (size_t g = 0; g < METRICS_GAUGES; ++g) {
+                std::cout << "  " << std::left << std::setw(16) << GAUGE_NAMES[g]
+                          << std::right << std::setw(14) << cur.gauges[g] << "\n";
+            }
+            if (show_tiers) {
+                std::cout << "  tiers (bids/asks):";
+                for (size_t t = 0; t < MetricsSlot::MAX_TIERS; ++t) {
+                    if (cur.tier_bids[t] || cur.tier_asks[t]) {
+                        std::cout << " " << t << ":" << cur.tier_bids[t] << "/" << cur.tier_asks[t];
+                    }
+                }
+                std::cout << "\n";
+            }
+            previous[i] = cur;
+        }
+        std::cout << std::endl;
+    }
+    return 0;
+}
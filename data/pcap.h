@@ -0,0 +1,51 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+
+// Classic pcap file format, as read by tcpdump / wireshark.
+
+static constexpr uint32_t PCAP_MAGIC_USEC = 0xa1b2c3d4; // Record timestamps in microseconds
+static constexpr uint32_t PCAP_MAGIC_NSEC = 0xa1b23c4d; // Record timestamps in nanoseconds
+
+static constexpr uint32_t LINKTYPE_ETHERNET = 1;
+static constexpr uint32_t LINKTYPE_RAW      = 101; // Packets start at the IPv4 header
+
+struct PcapFileHeader {
+    uint32_t magic;
+    uint16_t version_major;
+    uint16_t version_minor;
+    int32_t  thiszone;
+    uint32_t sigfigs;
+    uint32_t snaplen;
+    uint32_t linktype;
+};
+
+struct PcapRecordHeader {
+    uint32_t ts_sec;
+    uint32_t ts_frac;  // Microseconds or nanoseconds, depending on magic
+    uint32_t incl_len; // Bytes stored in the file
+    uint32_t orig_len; // Bytes on the wire
+};
+
+static_assert(sizeof(PcapFileHeader) == 24, "pcap file header must be 24 bytes");
+static_assert(sizeof(PcapRecordHeader) == 16, "pcap record header must be 16 bytes");
+
+// IPv4 + UDP headers prepended to captured payloads (LINKTYPE_RAW).
+struct __attribute__((packed)) Ipv4UdpHeader {
+    uint8_t  version_ihl;  // 0x45
+    uint8_t  tos;
+    uint16_t total_length; // Network order
+    uint16_t id;
+    uint16_t frag_offset;
+    uint8_t  ttl;
+    uint8_t  protocol;     // 17 = UDP
+    uint16_t checksum;
+    uint32_t src_addr;     // Network order
+    uint32_t dst_addr;
+    uint16_t src_port;
+    uint16_t dst_port;
+    uint16_t udp_length;
+    uint16_t udp_checksum; // 0: not computed
+};
+
+static_assert(sizeof(Ipv4UdpHeader) == 28, "IPv4 + UDP headers must be 28 bytes");
@@ -0,0 +1,144 @@
+#include "pcap_capture.h"
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <arpa/inet.h>
+
+// IPv4 header checksum over the first 20 bytes.
+static uint16_t ipv4_checksum(const void* header) {
+    const uint16_t* words = static_cast<const uint16_t*>(header);
+    uint32_t sum = 0;
+    for (int i = 0; i < 10; ++i) {
+        sum += words[i];
+    }
+    while (sum >> 16) {
+        sum = (sum & 0xFFFF) + (sum >> 16);
+    }
+    return static_cast<uint16_t>(~sum);
+}
+
+PcapCapture::~PcapCapture() {
+    close();
+}
+
+bool PcapCapture::open(const char* path, const sockaddr_in& dst) {
+    _file = fopen(path, "wb");
+    if (!_file) {
+        perror(path);
+        return false;
+    }
+
+    // Large stdio buffer, so the writer issues few big writes
+    constexpr size_t FILE_BUFFER = 4 << 20;
+    _file_buffer = std::make_unique<char[]>(FILE_BUFFER);
+    setvbuf(_file, _file_buffer.get(), _IOFBF, FILE_BUFFER);
+
+    PcapFileHeader header = {
+        .magic = PCAP_MAGIC_NSEC,
+        .version_major = 2,
+        .version_minor = 4,
+        .thiszone = 0,
+        .sigfigs = 0,
+        .snaplen = MAX_DATAGRAM + sizeof(Ipv4UdpHeader),
+        .linktype = LINKTYPE_RAW
+    };
+    fwrite(&header, sizeof(header), 1, _file);
+
+    _dst = dst;
+    if (!_arena) {
+        _arena = std::make_unique<Arena>(sizeof(Slot) * RING_SLOTS);
+        _ring = _arena->create<Slot>(RING_SLOTS);
+    }
+    _head.store(0, std::memory_order_relaxed);
+    _tail.store(0, std::memory_order_relaxed);
+    _running.store(true, std::memory_order_release);
+    _writer = std::thread(&PcapCapture::writer_loop, this);
+    return true;
+}
+
+void PcapCapture::close() {
+    if (!_running.load(std::memory_order_acquire)) {
+        return;
+    }
+    _running.store(false, std::memory_order_release);
+
+    if (_writer.joinable()) {
+        _writer.join();
+    }
+
+    fclose(_file);
+    _file = nullptr;
+}
+
+bool PcapCapture::record(const char* data, size_t len, const sockaddr_in& src, uint64_t timestamp_ns) {
+    uint64_t head = _head.load(std::memory_order_relaxed);
+    if (head - _tail.load(std::memory_order_acquire) >= RING_SLOTS) {
+        _dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    Slot& slot = _ring[head & (RING_SLOTS - 1)];
+    slot.timestamp_ns = timestamp_ns;
+    slot.len = static_cast<uint32_t>(len < MAX_DATAGRAM ? len : MAX_DATAGRAM);
+    slot.src_addr = src.sin_addr.s_addr;
+    slot.src_port = src.sin_port;
+    memcpy(slot.data, data, slot.len);
+
+    _head.store(head + 1, std::memory_order_release);
+    return true;
+}
+
+void PcapCapture::write_slot(const Slot& slot) {
+    PcapRecordHeader record = {
+        .ts_sec = static_cast<uint32_t>(slot.timestamp_ns / 1000000000),
+        .ts_frac = static_cast<uint32_t>(slot.timestamp_ns % 1000000000),
+        .incl_len = static_cast<uint32_t>(sizeof(Ipv4UdpHeader) + slot.len),
+        .orig_len = static_cast<uint32_t>(sizeof(Ipv4UdpHeader) + slot.len)
+    };
+
+    Ipv4UdpHeader ip = {
+        .version_ihl = 0x45,
+        .tos = 0,
+        .total_length = htons(static_cast<uint16_t>(sizeof(Ipv4UdpHeader) + slot.len)),
+        .id = htons(_ip_id++),
+        .frag_offset = 0,
+        .ttl = 64,
+        .protocol = IPPROTO_UDP,
+        .checksum = 0,
+        .src_addr = slot.src_addr,
+        .dst_addr = _dst.sin_addr.s_addr,
+        .src_port = slot.src_port,
+        .dst_port = _dst.sin_port,
+        .udp_length = htons(static_cast<uint16_t>(8 + slot.len)),
+        .udp_checksum = 0
+    };
+    ip.checksum = ipv4_checksum(&ip);
+
+    fwrite(&record, sizeof(record), 1, _file);
+    fwrite(&ip, sizeof(ip), 1, _file);
+    fwrite(slot.data, 1, slot.len, _file);
+}
+
+void PcapCapture::writer_loop() {
+    uint64_t tail = _tail.load(std::memory_order_relaxed);
+
+    while (true) {
+        uint64_t head = _head.load(std::memory_order_acquire);
+        if (tail == head) {
+            // Receive thread is stopped before close(), so nothing arrives after this
+            if (!_running.load(std::memory_order_acquire)) {
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+            continue;
+        }
+
+        for (; tail < head; ++tail) {
+            write_slot(_ring[tail & (RING_SLOTS - 1)]);
+            _tail.store(tail + 1, std::memory_order_release);
+        }
+        _recorded.store(tail, std::memory_order_relaxed);
+    }
+
+    fflush(_file);
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include "pcap.h"
+#include "../order/arena.h"
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <thread>
+#include <netinet/in.h>
+
+// Records received datagrams to a pcap file off the hot path.
+// The receive thread copies each datagram into a preallocated single producer / single consumer
+// ring, a writer thread drains the ring into a large buffered file. A full ring drops the datagram
+// from the capture (never from the feed) and counts it.
+class PcapCapture {
+public:
+    static constexpr size_t MAX_DATAGRAM = 1024;  // FeedHandler receive buffer size
+    static constexpr size_t RING_SLOTS = 8192;    // Power of 2
+
+    PcapCapture() = default;
+
+    ~PcapCapture();
+
+    // Create path and start the writer thread. dst is the address the feed is bound to,
+    // written as destination of every packet. Return false if the file can't be created.
+    bool open(const char* path, const sockaddr_in& dst);
+
+    // Flush everything recorded so far and stop the writer thread.
+    void close();
+
+    // Hot path: copy one datagram with its receive time into the ring.
+    // Return false if the ring is full and the datagram was dropped.
+    bool record(const char* data, size_t len, const sockaddr_in& src, uint64_t timestamp_ns);
+
+    uint64_t recorded() const { return _recorded.load(std::memory_order_relaxed); }
+    uint64_t dropped() const { return _dropped.load(std::memory_order_relaxed); }
+
+    // Datagrams waiting for the writer thread.
+    size_t depth() const {
+        return _head.load(std::memory_order_relaxed) - _tail.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct Slot {
+        uint64_t timestamp_ns;
+        uint32_t len;
+        uint32_t src_addr;
+        uint16_t src_port;
+        char data[MAX_DATAGRAM];
+    };
+
+    void writer_loop();
+
+    // Write one slot as a pcap record.
+    void write_slot(const Slot& slot);
+
+    std::unique_ptr<Arena> _arena; // Huge page backing of the ring
+    Slot* _ring = nullptr;
+    alignas(64) std::atomic<uint64_t> _head{0}; // Next slot to fill, owned by the receive thread
+    alignas(64) std::atomic<uint64_t> _tail{0}; // Next slot to write, owned by the writer thread
+    alignas(64) std::atomic<uint64_t> _recorded{0};
+    std::atomic<uint64_t> _dropped{0};
+
+    std::atomic<bool> _running{false};
+    std::thread _writer;
+    FILE* _file = nullptr;
+    std::unique_ptr<char[]> _file_buffer;
+    sockaddr_in _dst{};
+    uint16_t _ip_id = 0;
+};
@@ -0,0 +1,226 @@
+#include "pcap.h"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <immintrin.h>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+// Replays the UDP payloads of a pcap capture (LINKTYPE_RAW as written by PcapCapture,
+// or LINKTYPE_ETHERNET from tcpdump) to a local port, at recorded pace or as fast as possible.
+
+struct Datagram {
+    const char* payload; // Points into the mapped capture
+    uint32_t len;
+    uint64_t timestamp_ns;
+};
+
+static uint64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()
+    ).count();
+}
+
+// Find the UDP payload of one captured packet, return false if it isn't IPv4 / UDP.
+static bool udp_payload(const char* packet, uint32_t len, uint32_t linktype, Datagram& out) {
+    if (linktype == LINKTYPE_ETHERNET) {
+        if (len < 14) {
+            return false;
+        }
+        uint16_t ethertype = ntohs(*reinterpret_cast<const uint16_t*>(packet + 12));
+        size_t offset = 14;
+        if (ethertype == 0x8100 && len >= 18) { // 802.1Q tag
+            ethertype = ntohs(*reinterpret_cast<const uint16_t*>(packet + 16));
+            offset = 18;
+        }
+        if (ethertype != 0x0800) {
+            return false;
+        }
+        packet += offset;
+        len -= offset;
+    }
+
+    if (len < 20 || (packet[0] >> 4) != 4 || packet[9] != IPPROTO_UDP) {
+        return false;
+    }
+    size_t ip_len = (packet[0] & 0x0F) * 4;
+    if (len < ip_len + 8) {
+        return false;
+    }
+
+    out.payload = packet + ip_len + 8;
+    out.len = len - ip_len - 8;
+    return true;
+}
+
+int main(int argc, char** argv) {
+    const char* addr = "127.0.0.1";
+    int port = 50000;
+    bool fast = false;
+    double speed = 1.0;
+    int loops = 1;
+    size_t batch = 64;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "a:p:fx:l:b:")) != -1) {
+        switch (opt) {
+            case 'a': addr = optarg; break;
+            case 'p': port = atoi(optarg); break;
+            case 'f': fast = true; break;
+            case 'x': speed = atof(optarg); break;
+            case 'l': loops = atoi(optarg); break;
+            case 'b': batch = std::max(1, atoi(optarg)); break;
+            default:
+                std::cerr << "Usage: " << argv[0] << " [-a addr] [-p port] [-f] [-x speed] [-l loops] [-b batch] capture.pcap" << std::endl
+                          << "  -f  as fast as possible, else at recorded pace (scaled by -x)" << std::endl;
+                return 1;
+        }
+    }
+    if (optind >= argc) {
+        std::cerr << "Missing capture file" << std::endl;
+        return 1;
+    }
+
+    // Map the capture
+    int fd = open(argv[optind], O_RDONLY);
+    if (fd < 0) {
+        perror(argv[optind]);
+        return 1;
+    }
+    struct stat st{};
+    fstat(fd, &st);
+    if (static_cast<size_t>(st.st_size) < sizeof(PcapFileHeader)) {
+        std::cerr << "Not a pcap file" << std::endl;
+        return 1;
+    }
+    const char* base = static_cast<const char*>(mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0));
+    close(fd);
+    if (base == MAP_FAILED) {
+        perror("mmap");
+        return 1;
+    }
+
+    const PcapFileHeader* header = reinterpret_cast<const PcapFileHeader*>(base);
+    if (header->magic != PCAP_MAGIC_NSEC && header->magic != PCAP_MAGIC_USEC) {
+        std::cerr << "Unsupported pcap magic (big endian captures are not supported)" << std::endl;
+        return 1;
+    }
+    if (header->linktype != LINKTYPE_RAW && header->linktype != LINKTYPE_ETHERNET) {
+        std::cerr << "Unsupported link type " << header->linktype << std::endl;
+        return 1;
+    }
+    uint64_t frac_ns = header->magic == PCAP_MAGIC_NSEC ? 1 : 1000;
+
+    // Index every UDP datagram, payloads stay in the mapping
+    std::vector<Datagram> datagrams;
+    size_t offset = sizeof(PcapFileHeader);
+    while (offset + sizeof(PcapRecordHeader) <= static_cast<size_t>(st.st_size)) {
+        const PcapRecordHeader* record = reinterpret_cast<const PcapRecordHeader*>(base + offset);
+        offset += sizeof(PcapRecordHeader);
+        if (offset + record->incl_len > static_cast<size_t>(st.st_size)) {
+            break; // Truncated capture
+        }
+
+        Datagram d;
+        if (udp_payload(base + offset, record->incl_len, header->linktype, d)) {
+            d.timestamp_ns = record->ts_sec * 1000000000ull + record->ts_frac * frac_ns;
+            datagrams.push_back(d);
+        }
+        offset += record->incl_len;
+    }
+    if (datagrams.empty()) {
+        std::cerr << "No UDP datagrams in capture" << std::endl;
+        return 1;
+    }
+
+    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in dst{};
+    dst.sin_family = AF_INET;
+    dst.sin_port = htons(port);
+    inet_pton(AF_INET, addr, &dst.sin_addr);
+    if (sock < 0 || connect(sock, reinterpret_cast<sockaddr*>(&dst), sizeof(dst)) < 0) {
+        perror("socket");
+        return 1;
+    }
+
+    std::vector<mmsghdr> msgs(batch);
+    std::vector<iovec> iovs(batch);
+    uint64_t sent = 0, bytes = 0, errors = 0;
+
+    // Send offsets from the first datagram, never decreasing: timestamps that step backwards
+    // (a clock step, merged or foreign captures) are sent right after their predecessor
+    std::vector<uint64_t> offsets(datagrams.size());
+    uint64_t latest_ts = datagrams.front().timestamp_ns;
+    for (size_t i = 0; i < datagrams.size(); ++i) {
+        latest_ts = std::max(latest_ts, datagrams[i].timestamp_ns);
+        offsets[i] = latest_ts - datagrams.front().timestamp_ns;
+    }
+
+    uint64_t start = now_ns();
+    for (int loop = 0; loop < loops; ++loop) {
+        uint64_t loop_start = now_ns();
+
+        for (size_t i = 0; i < datagrams.size(); ) {
+            size_t n = 0;
+
+            if (!fast) {
+                // Wait for the next datagram's time, then take every datagram already due
+                uint64_t due = loop_start + static_cast<uint64_t>(offsets[i] / speed);
+                while (now_ns() < due) {
+                    _mm_pause();
+                }
+                uint64_t t = now_ns();
+                while (n < batch && i + n < datagrams.size()
+                    && loop_start + static_cast<uint64_t>(offsets[i + n] / speed) <= t) {
+                    ++n;
+                }
+            } else {
+                n = std::min(batch, datagrams.size() - i);
+            }
+
+            for (size_t k = 0; k < n; ++k) {
+                iovs[k] = {const_cast<char*>(datagrams[i + k].payload), datagrams[i + k].len};
+                msgs[k] = {};
+                msgs[k].msg_hdr.msg_iov = &iovs[k];
+                msgs[k].msg_hdr.msg_iovlen = 1;
+            }
+
+            // Retry the rest of a partial batch
+            size_t done = 0;
+            while (done < n) {
+                int r = sendmmsg(sock, msgs.data() + done, n - done, 0);
+                if (r < 0) {
+                    errors++; // e.g. ECONNREFUSED when nothing listens yet
+                    done++;
+                    continue;
+                }
+                for (int k = 0; k < r; ++k) {
+                    bytes += iovs[done + k].iov_len;
+                }
+                sent += r;
+                done += r;
+            }
+            i += n;
+        }
+    }
+    uint64_t elapsed = now_ns() - start;
+
+    std::cout << "[Replay] Datagrams: " << sent
+              << ", Bytes: " << bytes
+              << ", Errors: " << errors
+              << ", Total time: " << elapsed << " ns"
+              << ", Throughput: " << (1e9 * sent / elapsed) << " datagrams/sec"
+              << ", " << (8e3 * bytes / elapsed) << " Mbit/s"
+              << std::endl;
+
+    munmap(const_cast<char*>(base), st.st_size);
+    close(sock);
+    return 0;
+}
@@ -0,0 +1,23 @@
+#!/bin/bash
+# Loopback receive throughput of a scaled FeedHandler (SO_REUSEPORT sockets, steered by instrument)
+# as its receive threads double up to max, against the classic single socket receiver.
+#
+# Usage: ./reuseport_scaling.sh [max receivers] [extra udp_sender options, e.g. -r 4e6 -t 4 -C 8]
+set -e
+cd "$(dirname "$0")"
+
+MAX=${1:-4}
+shift || true
+BIN=$(mktemp)
+trap 'rm -f "$BIN"' EXIT
+g++ -O2 -std=c++17 -march=native -pthread udp_sender.cpp feed_handler.cpp pcap_capture.cpp metrics.cpp ../order/arena.cpp -o "$BIN"
+
+# Many senders: 8 source sockets per sender thread, one instrument per datagram
+OPTIONS="-L -r 2e6 -d 3 -I 1024 -S 8"
+
+echo "=== classic receiver ==="
+"$BIN" $OPTIONS "$@" | grep -E "Sent|Throughput"
+for ((receivers = 1; receivers <= MAX; receivers *= 2)); do
+    echo "=== receivers=$receivers ==="
+    "$BIN" $OPTIONS -R $receivers "$@" | grep -E "Sent|Throughput|Steered|Out of order"
+done
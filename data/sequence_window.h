@@ -0,0 +1,61 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// Deduplication window over feed sequence numbers, for arbitrating redundant lines: the first
+// claim of a sequence number wins, later copies are duplicates.
+// Sequences are grouped in blocks of 32. Each slot is one 64 bit word holding the block number in
+// its upper half and the seen mask of the block's sequences in its lower half, so a claim is a
+// single compare and swap: a slot still holding an older block is recycled in the same CAS, with
+// no separate clearing pass, and a slot already holding a newer block makes the claim stale.
+// Claims are lock free and may come from several threads.
+template <size_t BLOCKS = 1024>
+class SequenceWindow {
+    static_assert((BLOCKS & (BLOCKS - 1)) == 0, "BLOCKS must be a power of 2");
+
+public:
+    enum class Claim : uint8_t {
+        FIRST,      // Not seen before: deliver it
+        DUPLICATE,  // Already claimed
+        STALE,      // More than the window behind the newest claims, unknown whether seen
+    };
+
+    // Sequences covered behind the newest claimed block.
+    static constexpr size_t SPAN = BLOCKS * 32;
+
+    SequenceWindow() : _slots(std::make_unique<std::atomic<uint64_t>[]>(BLOCKS)) {
+        for (size_t i = 0; i < BLOCKS; ++i) {
+            _slots[i].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    Claim claim(uint32_t sequence) {
+        uint64_t block = sequence >> 5;
+        uint64_t bit = 1ull << (sequence & 31);
+        std::atomic<uint64_t>& slot = _slots[block & (BLOCKS - 1)];
+
+        uint64_t old = slot.load(std::memory_order_relaxed);
+        while (true) {
+            uint64_t tag = old >> 32;
+            uint64_t word;
+            if (tag == block) {
+                if (old & bit) {
+                    return Claim::DUPLICATE;
+                }
+                word = old | bit;
+            } else if (tag < block) {
+                word = (block << 32) | bit;  // The slot's block slid out of the window
+            } else {
+                return Claim::STALE;
+            }
+            if (slot.compare_exchange_weak(old, word, std::memory_order_acq_rel, std::memory_order_relaxed)) {
+                return Claim::FIRST;
+            }
+        }
+    }
+
+private:
+    std::unique_ptr<std::atomic<uint64_t>[]> _slots;
+};
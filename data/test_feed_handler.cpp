@@ -0,0 +1,122 @@
+#include "feed_handler.h"
+#include "sequence_window.h"
+#include <iostream>
+#include <cassert>
+#include <thread>
+#include <vector>
+
+using Claim = SequenceWindow<4>::Claim;
+
+void run_sequence_window_test() {
+    // 4 个槽位，每块 32 个序号，窗口覆盖 128 个序号
+    SequenceWindow<4> window;
+    static_assert(SequenceWindow<4>::SPAN == 128, "4 blocks of 32");
+
+    // 首个副本交付，之后的副本是重复
+    assert(window.claim(5) == Claim::FIRST);
+    assert(window.claim(5) == Claim::DUPLICATE);
+    assert(window.claim(6) == Claim::FIRST);
+    assert(window.claim(40) == Claim::FIRST);  // 块 1，槽位 1
+
+    // 块 4 与块 0 共用槽位 0：较新的块直接回收该槽位，旧的已见位被清掉
+    assert(window.claim(5 + 128) == Claim::FIRST);
+    assert(window.claim(6 + 128) == Claim::FIRST);
+    assert(window.claim(5 + 128) == Claim::DUPLICATE);
+
+    // 落后窗口超过 SPAN 的序号无法判断是否见过，无论当时是否见过
+    assert(window.claim(5) == Claim::STALE);
+    assert(window.claim(7) == Claim::STALE);
+
+    // 其他槽位不受影响
+    assert(window.claim(40) == Claim::DUPLICATE);
+    assert(window.claim(41) == Claim::FIRST);
+
+    // 多线程争抢同一批序号：每个序号恰好一个线程拿到 FIRST
+    SequenceWindow<> shared;
+    const uint32_t sequences = 20000;
+    std::vector<uint32_t> firsts(4, 0);
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < firsts.size(); ++t) {
+        threads.emplace_back([&, t] {
+            for (uint32_t s = 1; s <= sequences; ++s) {
+                if (shared.claim(s) == SequenceWindow<>::Claim::FIRST) {
+                    firsts[t]++;
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    assert(firsts[0] + firsts[1] + firsts[2] + firsts[3] == sequences);
+
+    std::cout << "[PASSED] Sequence window test.\n";
+}
+
+static MarketData sequenced(uint32_t sequence) {
+    MarketData md = {};
+    md.type = MsgType::ORDER_ADD;
+    md.sequence = sequence;
+    return md;
+}
+
+void run_arbitration_test() {
+    FeedHandler handler;
+    handler.set_verbose(false);
+    handler.set_line_b("127.0.0.1", 50001);  // 不启动，直接驱动仲裁
+    const LineStats& a = handler.line_stats(0);
+    const LineStats& b = handler.line_stats(1);
+
+    // 无序号的条目只取 A 线
+    assert(handler.arbitrate(sequenced(0), 0, 100));
+    assert(!handler.arbitrate(sequenced(0), 1, 100));
+    assert(a.messages == 0 && b.messages == 0);
+
+    // 序号 1：A 先到并交付；A 线上的第二个副本只是重复，B 不记领先
+    assert(handler.arbitrate(sequenced(1), 0, 1000));
+    assert(!handler.arbitrate(sequenced(1), 0, 1300));
+    assert(a.duplicates == 1 && b.leads == 0 && a.leads == 0);
+
+    // B 的副本晚到 500ns：A 领先一次；B 的再一个副本不重复计领先
+    assert(!handler.arbitrate(sequenced(1), 1, 1500));
+    assert(a.leads == 1 && a.lead_ns == 500 && a.max_lead_ns == 500);
+    assert(!handler.arbitrate(sequenced(1), 1, 1600));
+    assert(a.leads == 1 && a.lead_ns == 500 && b.duplicates == 2);
+
+    // 序号 2：B 先到 100ns，B 领先
+    assert(handler.arbitrate(sequenced(2), 1, 2000));
+    assert(!handler.arbitrate(sequenced(2), 0, 2100));
+    assert(b.leads == 1 && b.lead_ns == 100 && b.max_lead_ns == 100);
+
+    // 序号 3：B 副本的时间戳反而更早，领先记 0，不下溢
+    assert(handler.arbitrate(sequenced(3), 0, 3000));
+    assert(!handler.arbitrate(sequenced(3), 1, 2900));
+    assert(a.leads == 2 && a.lead_ns == 500 && a.max_lead_ns == 500);
+
+    assert(a.wins == 2 && b.wins == 1);
+    assert(a.messages == 4 && b.messages == 4);
+
+    // 窗口前移一个 SPAN：B 赢下新序号，A 的副本晚 200ns
+    const uint32_t span = SequenceWindow<>::SPAN;
+    assert(handler.arbitrate(sequenced(4 + span), 1, 4000));
+    assert(!handler.arbitrate(sequenced(4 + span), 0, 4200));
+    assert(b.leads == 2 && b.lead_ns == 300 && b.max_lead_ns == 200);
+
+    // 序号 4 已落后窗口，按过期丢弃，不交付也不计领先
+    assert(!handler.arbitrate(sequenced(4), 0, 4300));
+    assert(!handler.arbitrate(sequenced(4), 1, 4400));
+    assert(a.stale == 1 && b.stale == 1);
+    assert(a.leads == 2 && b.leads == 2);
+    assert(a.duplicates == 3 && b.duplicates == 3);
+
+    std::cout << "[PASSED] Arbitration test.\n";
+}
+
+int main() {
+    run_sequence_window_test();
+    run_arbitration_test();
+
+    std::cout << "[TEST PASSED]" << std::endl;
+
+    return 0;
+}
@@ -3,36 +3,396 @@
 #include <iostream>
 #include <unistd.h>
 #include <cstring>
+#include <cstdlib>
+#include <cmath>
 #include <vector>
-#include <cassert>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <random>
+#include <algorithm>
+#include <pthread.h>
+#include <x86intrin.h>
 #include "market_data.h"
+#include "feed_handler.h"
 
-// enum class MsgType : uint8_t {
-//     ORDER_ADD    = 'A',
-//     ORDER_CANCEL = 'X',
-// };
-
-// struct alignas(64) MarketData {
-//     MsgType  type;       
-//     uint32_t order_id;    
-//     uint32_t timestamp;
-//     int32_t  price;       // $0.01/unit
-//     uint32_t volume;
-//     uint8_t  side;        // Bid: 0, Ask: 1;
-// };
-
-int main() {
-    // Create socket
+// Synthetic ADD / CANCEL load generator for FeedHandler.
+//
+// Several pinned threads each build datagrams of MarketData around a shared moving mid,
+// batch them with sendmmsg and pace them with a TSC based rate controller. In closed loop
+// mode a FeedHandler runs in process on the target port, and loss and one way latency are
+// measured against what it actually received.
+// With a B port every datagram is sent on two redundant lines, each dropping and delaying its
+// copies independently, to exercise A/B arbitration.
+// With instruments every datagram carries a single instrument, each sent by one thread from
+// several source sockets, and the closed loop receiver can run scaled over SO_REUSEPORT sockets:
+// it checks that every instrument stays on one receive thread, in order.
+
+struct GeneratorConfig {
+    const char* addr = "127.0.0.1";
+    int port = 50000;
+    double rate = 1e6;              // Messages per second, all threads together
+    double duration = 5.0;          // Seconds
+    int threads = 1;
+    int first_cpu = -1;             // Pin thread i to first_cpu + i, -1: don't pin
+    int msgs_per_datagram = 16;     // FeedHandler reads up to 1024 bytes per datagram
+    int datagrams_per_send = 32;    // sendmmsg batch
+    double cancel_ratio = 0.3;      // Share of messages cancelling a live order
+    double cross_ratio = 0.05;      // Share of adds priced through the mid
+    int32_t mid = 1000;
+    double width = 5.0;             // Std dev of the distance to mid, in ticks
+    uint32_t walk_every = 1000;     // Move mid by one tick every walk_every messages
+    uint32_t id_span = 0;           // Order ids per thread before they wrap (skipping those still resting), 0: never reuse
+    uint32_t burst_period_us = 0;   // Burst profile: for burst_us of every burst_period_us,
+    uint32_t burst_us = 0;          // send at burst_factor times the rate
+    double burst_factor = 1.0;
+    bool closed_loop = false;
+    int port_b = 0;                 // A/B lines: also send every datagram to port_b, 0: line A only
+    double drop[2] = {0, 0};        // Per line probability of dropping a datagram
+    uint32_t jitter_us[2] = {0, 0}; // Per line maximum random delay of a datagram
+    uint32_t instruments = 0;       // Instrument keys, split over threads, one per datagram; 0: all 0
+    int sources = 1;                // Source sockets per thread, batches rotate over them (line A only)
+    int receivers = 0;              // Closed loop: scaled receive threads, 0: one classic receiver
+    int receiver_cpu = -1;          // Pin receive thread i to receiver_cpu + i
+};
+
+struct alignas(64) GeneratorStats {
+    uint64_t messages = 0;
+    uint64_t adds = 0;
+    uint64_t cancels = 0;
+    uint64_t datagrams = 0;
+    uint64_t send_errors = 0;
+    uint64_t line_datagrams[2] = {0, 0};  // A/B lines: datagrams sent and dropped per line
+    uint64_t line_drops[2] = {0, 0};
+};
+
+static uint64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()
+    ).count();
+}
+
+// TSC ticks per nanosecond, measured against the steady clock.
+static double calibrate_tsc() {
+    uint64_t t0 = now_ns();
+    uint64_t c0 = __rdtsc();
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    uint64_t t1 = now_ns();
+    uint64_t c1 = __rdtsc();
+    return static_cast<double>(c1 - c0) / (t1 - t0);
+}
+
+static void pin_thread(int cpu) {
+    if (cpu < 0) {
+        return;
+    }
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    CPU_SET(cpu, &cpuset);
+    if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset) != 0) {
+        std::cerr << "Failed to bind thread to CPU core " << cpu << ": " << strerror(errno) << std::endl;
+    }
+}
+
+static int connect_socket(const GeneratorConfig& config, int port) {
     int sock = socket(AF_INET, SOCK_DGRAM, 0);
     if (sock < 0) {
-        std::cerr << "Socket creation failed" << std::endl;
-        return 1;
+        perror("socket");
+        return -1;
     }
 
-    sockaddr_in server_addr;
+    // Large send buffer absorbs bursts
+    int sndbuf = 8 << 20;
+    setsockopt(sock, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+
+    sockaddr_in server_addr{};
     server_addr.sin_family = AF_INET;
-    server_addr.sin_port = htons(50000); // Listen on port 50000
-    inet_pton(AF_INET, "127.0.0.1", &server_addr.sin_addr);
+    server_addr.sin_port = htons(port);
+    inet_pton(AF_INET, config.addr, &server_addr.sin_addr);
+    if (connect(sock, (sockaddr*)&server_addr, sizeof(server_addr)) < 0) {
+        perror("connect");
+        close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+// Shared moving mid, walked by thread 0 only.
+std::atomic<int32_t> g_mid{1000};
+
+// Message timestamps: nanoseconds since run start, truncated to 32 bits (wraps every ~4.3 s),
+// so the closed loop receiver can compute one way latency from the message itself.
+uint64_t g_run_start_ns = 0;
+
+// Feed sequence numbers, shared by all threads.
+std::atomic<uint32_t> g_sequence{1};
+
+// Send n prepared datagrams, return how many went out.
+static uint64_t send_all(int sock, mmsghdr* msgs, size_t n, GeneratorStats& stats) {
+    size_t done = 0;
+    uint64_t sent = 0;
+    while (done < n) {
+        int r = sendmmsg(sock, msgs + done, n - done, 0);
+        if (r < 0) {
+            stats.send_errors++;
+            done++;
+            continue;
+        }
+        done += r;
+        sent += r;
+    }
+    return sent;
+}
+
+// One line of a redundant A/B feed: drops and delays its copies independently of the other line.
+struct Line {
+    struct Delayed {
+        uint64_t due_tsc;
+        uint32_t count;
+        MarketData packets[16];
+    };
+
+    int sock = -1;
+    double drop = 0;
+    uint64_t jitter_tsc = 0;
+    std::vector<Delayed> delayed;  // Min heap on due_tsc
+
+    static bool later(const Delayed& a, const Delayed& b) { return a.due_tsc > b.due_tsc; }
+
+    // Send the delayed datagrams due by tsc, all of them if flush.
+    void send_due(uint64_t tsc, bool flush, int line, GeneratorStats& stats) {
+        while (!delayed.empty() && (flush || delayed.front().due_tsc <= tsc)) {
+            std::pop_heap(delayed.begin(), delayed.end(), later);
+            const Delayed& d = delayed.back();
+            if (send(sock, d.packets, d.count * sizeof(MarketData), 0) < 0) {
+                stats.send_errors++;
+            } else {
+                stats.line_datagrams[line]++;
+            }
+            delayed.pop_back();
+        }
+    }
+};
+
+void generator_thread(const GeneratorConfig& config, int thread_idx, double tsc_per_ns,
+                      std::atomic<bool>& stop, GeneratorStats& stats) {
+    pin_thread(config.first_cpu < 0 ? -1 : config.first_cpu + thread_idx);
+
+    int sock = connect_socket(config, config.port);
+    if (sock < 0) {
+        return;
+    }
+
+    // Extra source ports: each is a sender of its own to the receiver's address hash
+    std::vector<int> sources{sock};
+    for (int s = 1; s < (config.port_b ? 1 : config.sources); ++s) {
+        int extra = connect_socket(config, config.port);
+        if (extra < 0) {
+            break;
+        }
+        sources.push_back(extra);
+    }
+    uint64_t batches = 0;
+
+    Line lines[2];
+    const int line_count = config.port_b ? 2 : 0;
+    if (config.port_b) {
+        for (int l = 0; l < 2; ++l) {
+            lines[l].sock = l == 0 ? sock : connect_socket(config, config.port_b);
+            if (lines[l].sock < 0) {
+                close(sock);
+                return;
+            }
+            lines[l].drop = config.drop[l];
+            lines[l].jitter_tsc = static_cast<uint64_t>(config.jitter_us[l] * 1000 * tsc_per_ns);
+            lines[l].delayed.reserve(1024);
+        }
+    }
+
+    std::mt19937_64 rng(0x9E3779B97F4A7C15ull * (thread_idx + 1));
+    std::normal_distribution<double> distance(0.0, config.width);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    std::uniform_int_distribution<uint32_t> volume(1, 10);
+
+    // Instruments of this thread: thread_idx, thread_idx + threads, ... (main keeps instruments >= threads)
+    const uint32_t own_instruments = config.instruments ? config.instruments / config.threads : 0;
+
+    // Each thread owns a disjoint id range. Live orders are pooled per instrument, so a cancel
+    // targets an order of its datagram's instrument; each pool holds its share of the bound.
+    const uint32_t pools = std::max(1u, own_instruments);
+    const size_t pool_bound = std::max<size_t>(1, (1u << 20) / pools);
+    uint32_t id_base = static_cast<uint32_t>(thread_idx) * (1u << 28);
+    uint32_t id_counter = 0;
+    std::vector<std::vector<uint32_t>> live(pools);
+
+    // With id_span, each pool has its own slice of it, and offsets of ids that may still rest are
+    // never reused: those in the pool and those evicted from it, which rest for good. A slice with
+    // no free id belongs to a pool that isn't empty (evictions only happen in full pools).
+    const uint32_t slice = config.id_span ? std::max(1u, config.id_span / pools) : 0;
+    std::vector<bool> resting(static_cast<size_t>(slice) * pools);
+    std::vector<uint32_t> slice_counters(pools, 0);
+    auto reserve_id = [&](uint32_t pool, uint32_t& offset) {
+        uint32_t& counter = slice_counters[pool];
+        for (uint32_t tries = 0; tries < slice; ++tries, ++counter) {
+            uint32_t candidate = pool * slice + counter % slice;
+            if (!resting[candidate]) {
+                counter++;
+                offset = candidate;
+                resting[offset] = true;
+                return true;
+            }
+        }
+        return false;
+    };
+
+    const size_t per_datagram = std::clamp(config.msgs_per_datagram, 1, 16);
+    const size_t per_send = std::max(1, config.datagrams_per_send);
+    std::vector<MarketData> packets(per_datagram * per_send);
+    std::vector<iovec> iovs(per_send);
+    std::vector<mmsghdr> msgs(per_send);
+    std::vector<uint32_t> pool_of(per_send, 0);  // Per datagram of a batch: its instrument's pool
+
+    // Rate controller: one send of per_send datagrams every interval TSC ticks
+    double thread_rate = config.rate / config.threads;
+    double base_interval = tsc_per_ns * 1e9 * (per_datagram * per_send) / thread_rate;
+    double burst_interval = base_interval / std::max(config.burst_factor, 1e-9);
+    uint64_t burst_period = static_cast<uint64_t>(config.burst_period_us * 1000 * tsc_per_ns);
+    uint64_t burst_len = static_cast<uint64_t>(config.burst_us * 1000 * tsc_per_ns);
+
+    uint64_t start_tsc = __rdtsc();
+    double next_tsc = static_cast<double>(start_tsc);
+    uint64_t msg_counter = 0;
+
+    while (!stop.load(std::memory_order_relaxed)) {
+        uint64_t tsc;
+        while ((tsc = __rdtsc()) < next_tsc) {
+            for (int l = 0; l < line_count; ++l) {
+                lines[l].send_due(tsc, false, l, stats);
+            }
+            _mm_pause();
+        }
+        bool in_burst = burst_period > 0 && ((tsc - start_tsc) % burst_period) < burst_len;
+        next_tsc += in_burst ? burst_interval : base_interval;
+
+        uint32_t ts = static_cast<uint32_t>(now_ns() - g_run_start_ns);
+        uint32_t sequence = g_sequence.fetch_add(packets.size(), std::memory_order_relaxed);
+        for (size_t d = 0; d < per_send && own_instruments; ++d) {
+            pool_of[d] = static_cast<uint32_t>(rng() % own_instruments);
+        }
+
+        for (size_t i = 0; i < packets.size(); ++i, ++msg_counter) {
+            MarketData& md = packets[i];
+            md = {};
+            md.timestamp = ts;
+            md.sequence = sequence + i;
+            uint32_t pool = pool_of[i / per_datagram];
+            std::vector<uint32_t>& pool_live = live[pool];
+            md.instrument = own_instruments ? static_cast<uint16_t>(pool * config.threads + thread_idx) : 0;
+
+            if (thread_idx == 0 && config.walk_every && msg_counter % config.walk_every == 0) {
+                g_mid.fetch_add(rng() & 1 ? 1 : -1, std::memory_order_relaxed);
+            }
+
+            uint32_t offset = id_counter;
+            bool cancel = !pool_live.empty() && unit(rng) < config.cancel_ratio;
+            if (!cancel && config.id_span && !reserve_id(pool, offset)) {
+                cancel = true;  // Every id of the slice may still rest: free one (the pool isn't empty then)
+            }
+
+            if (cancel) {
+                size_t k = rng() % pool_live.size();
+                // Full cancel. Instrument flow is for book building, where 'X' only reduces volume
+                md.type = own_instruments ? MsgType::ORDER_DELETE : MsgType::ORDER_CANCEL;
+                md.order_id = pool_live[k];
+                pool_live[k] = pool_live.back();
+                pool_live.pop_back();
+                if (config.id_span) {
+                    resting[md.order_id - id_base] = false;
+                }
+                stats.cancels++;
+                continue;
+            }
+
+            md.type = MsgType::ORDER_ADD;
+            md.order_id = id_base + offset;
+            if (!config.id_span) {
+                id_counter++;
+            }
+            md.side = rng() & 1;
+            md.volume = volume(rng);
+
+            // Bids below the mid, asks above, a few through it
+            int32_t ticks = 1 + static_cast<int32_t>(std::fabs(distance(rng)));
+            int32_t sign = (md.side == 0) ? -1 : 1;
+            if (unit(rng) < config.cross_ratio) {
+                sign = -sign;
+            }
+            md.price = std::max(1, g_mid.load(std::memory_order_relaxed) + sign * ticks);
+
+            // Bound the live pool, the oldest orders are left resting
+            if (pool_live.size() < pool_bound) {
+                pool_live.push_back(md.order_id);
+            } else {
+                pool_live[rng() % pool_live.size()] = md.order_id;
+            }
+            stats.adds++;
+        }
+
+        for (size_t d = 0; d < per_send; ++d) {
+            iovs[d] = {&packets[d * per_datagram], per_datagram * sizeof(MarketData)};
+            msgs[d] = {};
+            msgs[d].msg_hdr.msg_iov = &iovs[d];
+            msgs[d].msg_hdr.msg_iovlen = 1;
+        }
+
+        stats.messages += packets.size();
+        if (!config.port_b) {
+            stats.datagrams += send_all(sources[batches++ % sources.size()], msgs.data(), per_send, stats);
+            continue;
+        }
+
+        // A/B: each line drops some copies, sends the rest now or after a random delay
+        stats.datagrams += per_send;
+        for (int l = 0; l < 2; ++l) {
+            Line& line = lines[l];
+            size_t now = 0;
+            for (size_t d = 0; d < per_send; ++d) {
+                if (unit(rng) < line.drop) {
+                    stats.line_drops[l]++;
+                } else if (line.jitter_tsc == 0) {
+                    std::swap(msgs[now++], msgs[d]);
+                } else {
+                    line.delayed.push_back({tsc + rng() % line.jitter_tsc, static_cast<uint32_t>(per_datagram), {}});
+                    std::copy_n(&packets[d * per_datagram], per_datagram, line.delayed.back().packets);
+                    std::push_heap(line.delayed.begin(), line.delayed.end(), Line::later);
+                }
+            }
+            stats.line_datagrams[l] += send_all(line.sock, msgs.data(), now, stats);
+
+            // Undo the compaction for the other line
+            for (size_t d = 0; d < per_send; ++d) {
+                msgs[d].msg_hdr.msg_iov = &iovs[d];
+            }
+        }
+    }
+
+    for (int l = 0; l < line_count; ++l) {
+        lines[l].send_due(0, true, l, stats);
+        if (lines[l].sock != sock) {
+            close(lines[l].sock);
+        }
+    }
+    for (int source : sources) {
+        close(source);
+    }
+}
+
+// The three hand written packets of the original sender, as a quick functional check.
+int run_smoke(const GeneratorConfig& config) {
+    int sock = connect_socket(config, config.port);
+    if (sock < 0) {
+        return 1;
+    }
 
     std::vector<MarketData> packets(16);
 
@@ -42,9 +402,9 @@ int main() {
     packets[2]  = {MsgType::ORDER_ADD, 3, 3, 1010, 5, 1};
     packets[3]  = {MsgType::ORDER_ADD, 4, 5, 1005, 5, 1};
 
-    if (sendto(sock, packets.data(), 4 * sizeof(MarketData), 0, (sockaddr*)&server_addr, sizeof(server_addr)) < 0) {
-        perror("sendto");
-    } 
+    if (send(sock, packets.data(), 4 * sizeof(MarketData), 0) < 0) {
+        perror("send");
+    }
 
     sleep(1);
 
@@ -54,9 +414,9 @@ int main() {
     packets[2]  = {MsgType::ORDER_ADD, 7, 13, 1010, 5, 0};
     packets[3]  = {MsgType::ORDER_CANCEL, 7, 16, 0, 0, 0};
 
-    if (sendto(sock, packets.data(), 4 * sizeof(MarketData), 0, (sockaddr*)&server_addr, sizeof(server_addr)) < 0) {
-        perror("sendto");
-    } 
+    if (send(sock, packets.data(), 4 * sizeof(MarketData), 0) < 0) {
+        perror("send");
+    }
 
     sleep(1);
 
@@ -65,12 +425,273 @@ int main() {
     packets[1]  = {MsgType::ORDER_ADD, 9, 24, 1010,  0, 1}; // invalid, volume == 0
     packets[2]  = {MsgType::ORDER_ADD, 10, 26, 1000, 5, 1}; // Top of book should be bid 995, ask 0 (no ask orders available)
 
-    if (sendto(sock, packets.data(), 3 * sizeof(MarketData), 0, (sockaddr*)&server_addr, sizeof(server_addr)) < 0) {
-        perror("sendto");
-    } 
+    if (send(sock, packets.data(), 3 * sizeof(MarketData), 0) < 0) {
+        perror("send");
+    }
 
     sleep(1);
 
     close(sock);
     return 0;
-}
\ No newline at end of file
+}
+
+void usage(const char* prog) {
+    std::cerr << "Usage: " << prog << " [options]\n"
+              << "  -a addr        destination address (127.0.0.1)\n"
+              << "  -p port        destination port (50000)\n"
+              << "  -r rate        messages per second, all threads (1000000)\n"
+              << "  -d seconds     duration (5)\n"
+              << "  -t threads     sender threads (1)\n"
+              << "  -C cpu         pin thread i to cpu + i\n"
+              << "  -m n           messages per datagram, 1..16 (16)\n"
+              << "  -k n           datagrams per sendmmsg (32)\n"
+              << "  -c ratio       cancel ratio (0.3)\n"
+              << "  -x ratio       share of adds priced through the mid (0.05)\n"
+              << "  -M price       initial mid (1000)\n"
+              << "  -w ticks       std dev of the distance to mid (5)\n"
+              << "  -W n           move the mid every n messages (1000), 0: fixed mid\n"
+              << "  -i n           order ids per thread before reuse, ids still resting are skipped; 0: never reuse\n"
+              << "  -b p:b:f       bursts: for b us of every p us, send at f times the rate\n"
+              << "  -B port        A/B lines: also send every datagram to port\n"
+              << "  -D a:b         A/B lines: probability of dropping a datagram per line (0:0)\n"
+              << "  -J a:b         A/B lines: maximum random delay of a datagram per line, in us (0:0)\n"
+              << "  -I n           instruments: one per datagram, each sent by one thread, cancels as deletes (0: none)\n"
+              << "  -S n           source sockets per thread, batches rotate over them (1)\n"
+              << "  -L             closed loop: receive in process, report loss and latency\n"
+              << "  -R n[:cpu]     closed loop: n SO_REUSEPORT receive threads, pinned from cpu\n"
+              << "  -s             send the three smoke test packets and exit\n";
+}
+
+int main(int argc, char** argv) {
+    GeneratorConfig config;
+    bool smoke = false;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "a:p:r:d:t:C:m:k:c:x:M:w:W:i:b:B:D:J:I:S:LR:sh")) != -1) {
+        switch (opt) {
+            case 'a': config.addr = optarg; break;
+            case 'p': config.port = atoi(optarg); break;
+            case 'r': config.rate = atof(optarg); break;
+            case 'd': config.duration = atof(optarg); break;
+            case 't': config.threads = std::max(1, atoi(optarg)); break;
+            case 'C': config.first_cpu = atoi(optarg); break;
+            case 'm': config.msgs_per_datagram = atoi(optarg); break;
+            case 'k': config.datagrams_per_send = atoi(optarg); break;
+            case 'c': config.cancel_ratio = atof(optarg); break;
+            case 'x': config.cross_ratio = atof(optarg); break;
+            case 'M': config.mid = atoi(optarg); break;
+            case 'w': config.width = atof(optarg); break;
+            case 'W': config.walk_every = strtoul(optarg, nullptr, 10); break;
+            case 'i': config.id_span = strtoul(optarg, nullptr, 10); break;
+            case 'b':
+                if (sscanf(optarg, "%u:%u:%lf", &config.burst_period_us, &config.burst_us, &config.burst_factor) != 3) {
+                    usage(argv[0]);
+                    return 1;
+                }
+                break;
+            case 'B': config.port_b = atoi(optarg); break;
+            case 'D':
+                if (sscanf(optarg, "%lf:%lf", &config.drop[0], &config.drop[1]) != 2) {
+                    usage(argv[0]);
+                    return 1;
+                }
+                break;
+            case 'J':
+                if (sscanf(optarg, "%u:%u", &config.jitter_us[0], &config.jitter_us[1]) != 2) {
+                    usage(argv[0]);
+                    return 1;
+                }
+                break;
+            case 'I': config.instruments = std::min(strtoul(optarg, nullptr, 10), 65536ul); break;
+            case 'S': config.sources = std::max(1, atoi(optarg)); break;
+            case 'L': config.closed_loop = true; break;
+            case 'R':
+                if (sscanf(optarg, "%d:%d", &config.receivers, &config.receiver_cpu) < 1) {
+                    usage(argv[0]);
+                    return 1;
+                }
+                break;
+            case 's': smoke = true; break;
+            default: usage(argv[0]); return 1;
+        }
+    }
+
+    if (smoke) {
+        return run_smoke(config);
+    }
+
+    // Each thread owns at least one instrument
+    if (config.instruments && config.instruments < static_cast<uint32_t>(config.threads)) {
+        std::cerr << "Instruments raised to " << config.threads << ", one per sender thread" << std::endl;
+        config.instruments = config.threads;
+    }
+
+    g_mid.store(config.mid);
+    double tsc_per_ns = calibrate_tsc();
+    g_run_start_ns = now_ns();
+
+    // Closed loop: receive in process and time every message, counted per receive thread
+    struct alignas(64) ReceiverCounts {
+        uint64_t latency_hist[64] = {};  // Bucket b: latency in [2^b, 2^(b+1)) ns
+        uint64_t out_of_order = 0;       // Entries behind the last sequence of their instrument
+        uint64_t misrouted = 0;          // Entries of an instrument first seen by another thread
+    };
+    // Per instrument, written by the thread that receives it
+    struct alignas(64) InstrumentCheck {
+        std::atomic<uint32_t> last_sequence{0};
+        std::atomic<int> receiver{-1};
+    };
+    std::unique_ptr<FeedHandler> feed;
+    std::vector<ReceiverCounts> counts(std::max(config.receivers, 1));
+    std::unique_ptr<InstrumentCheck[]> checks(new InstrumentCheck[config.instruments]);
+    if (config.closed_loop) {
+        feed = std::make_unique<FeedHandler>();
+        feed->set_verbose(false);
+        feed->register_callback([&counts, &checks, &config](const MarketData& md) {
+            int receiver = std::max(FeedHandler::current_receiver(), 0);
+            ReceiverCounts& c = counts[receiver];
+            uint32_t now = static_cast<uint32_t>(now_ns() - g_run_start_ns);
+            uint32_t latency = now - md.timestamp;
+            c.latency_hist[latency ? 63 - __builtin_clzll(latency) : 0]++;
+
+            if (md.instrument < config.instruments) {
+                InstrumentCheck& check = checks[md.instrument];
+                if (md.sequence <= check.last_sequence.load(std::memory_order_relaxed)) {
+                    c.out_of_order++;
+                }
+                check.last_sequence.store(md.sequence, std::memory_order_relaxed);
+                int owner = check.receiver.load(std::memory_order_relaxed);
+                if (owner < 0) {
+                    check.receiver.store(receiver, std::memory_order_relaxed);
+                } else if (owner != receiver) {
+                    c.misrouted++;
+                }
+            }
+        });
+        if (config.port_b) {
+            feed->set_line_b(config.addr, config.port_b);
+        }
+        if (config.receivers > 0) {
+            feed->set_receivers(config.receivers, config.receiver_cpu);
+        }
+        feed->start(config.addr, config.port);
+        if (!feed->is_running()) {
+            return 1;
+        }
+    }
+
+    std::atomic<bool> stop{false};
+    std::vector<GeneratorStats> stats(config.threads);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < config.threads; ++t) {
+        threads.emplace_back(generator_thread, std::cref(config), t, tsc_per_ns, std::ref(stop), std::ref(stats[t]));
+    }
+
+    std::this_thread::sleep_for(std::chrono::duration<double>(config.duration));
+    stop.store(true, std::memory_order_relaxed);
+    for (auto& t : threads) {
+        t.join();
+    }
+    uint64_t elapsed = now_ns() - g_run_start_ns;
+
+    GeneratorStats total;
+    for (const auto& s : stats) {
+        total.messages += s.messages;
+        total.adds += s.adds;
+        total.cancels += s.cancels;
+        total.datagrams += s.datagrams;
+        total.send_errors += s.send_errors;
+        for (int l = 0; l < 2; ++l) {
+            total.line_datagrams[l] += s.line_datagrams[l];
+            total.line_drops[l] += s.line_drops[l];
+        }
+    }
+
+    std::cout << "[Generator] Messages: " << total.messages
+              << ", Adds: " << total.adds
+              << ", Cancels: " << total.cancels
+              << ", Datagrams: " << total.datagrams
+              << ", Send errors: " << total.send_errors
+              << ", Rate: " << (1e9 * total.messages / elapsed) << " msgs/sec"
+              << std::endl;
+    if (config.port_b) {
+        for (int l = 0; l < 2; ++l) {
+            std::cout << "[Generator] Line " << "AB"[l] << " datagrams: " << total.line_datagrams[l]
+                      << ", Dropped: " << total.line_drops[l] << std::endl;
+        }
+    }
+
+    if (feed) {
+        // Let the receiver drain its socket
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        feed->stop();
+
+        const FeedStats& fs = feed->stats();
+        uint64_t sent = total.messages;
+        uint64_t got = fs.updates_processed;
+        std::cout << "[ClosedLoop] Sent: " << sent
+                  << ", Received: " << got
+                  << ", Packets: " << fs.packets_received << "/"
+                  << (config.port_b ? total.line_datagrams[0] + total.line_datagrams[1] : total.datagrams)
+                  << ", Loss: " << (sent ? 100.0 * (sent - std::min(sent, got)) / sent : 0) << "%"
+                  << std::endl;
+        for (int l = 0; l < 2 && feed->arbitrated(); ++l) {
+            const LineStats& ls = feed->line_stats(l);
+            std::cout << "[ClosedLoop] Line " << "AB"[l] << " wins: " << ls.wins
+                      << ", Duplicates: " << ls.duplicates
+                      << ", Stale: " << ls.stale
+                      << ", Avg lead: " << (ls.leads ? ls.lead_ns / ls.leads : 0) << " ns"
+                      << ", Max lead: " << ls.max_lead_ns << " ns"
+                      << std::endl;
+        }
+
+        // Receive throughput over the send window, drain included in the count only
+        std::cout << "[ClosedLoop] Throughput: " << (1e9 * got / elapsed) << " msgs/sec" << std::endl;
+        if (feed->receivers() > 0) {
+            for (int r = 0; r < feed->receivers(); ++r) {
+                const FeedStats& rs = feed->receiver_stats(r);
+                std::cout << "[ClosedLoop] Receiver " << r << " packets: " << rs.packets_received
+                          << ", Updates: " << rs.updates_processed << std::endl;
+            }
+            std::cout << "[ClosedLoop] Steered: " << (feed->steered() ? "yes" : "no") << std::endl;
+        }
+
+        ReceiverCounts total_counts;
+        for (const ReceiverCounts& c : counts) {
+            for (size_t b = 0; b < 64; ++b) {
+                total_counts.latency_hist[b] += c.latency_hist[b];
+            }
+            total_counts.out_of_order += c.out_of_order;
+            total_counts.misrouted += c.misrouted;
+        }
+        if (config.instruments) {
+            std::cout << "[ClosedLoop] Instruments: " << config.instruments
+                      << ", Out of order: " << total_counts.out_of_order
+                      << ", Misrouted: " << total_counts.misrouted
+                      << std::endl;
+        }
+
+        // Percentiles from the log2 histogram (upper bucket bound)
+        const uint64_t* latency_hist = total_counts.latency_hist;
+        uint64_t count = 0;
+        for (size_t b = 0; b < 64; ++b) {
+            count += latency_hist[b];
+        }
+        auto percentile = [&](double p) {
+            uint64_t rank = static_cast<uint64_t>(p * count), seen = 0;
+            for (size_t b = 0; b < 64; ++b) {
+                seen += latency_hist[b];
+                if (seen > rank) {
+                    return 2ull << b;
+                }
+            }
+            return 0ull;
+        };
+        std::cout << "[ClosedLoop] Latency (ns, upper bound) p50: " << percentile(0.5)
+                  << ", p99: " << percentile(0.99)
+                  << ", p99.9: " << percentile(0.999)
+                  << std::endl;
+    }
+
+    return 0;
+}
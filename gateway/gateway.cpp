@@ -0,0 +1,714 @@
+#include "gateway.h"
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <iostream>
+#include <arpa/inet.h>
+#include <immintrin.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static constexpr uint32_t LISTENER = UINT32_MAX;
+
+static void pin_thread(int cpu, const char* name) {
+    if (cpu < 0) {
+        return;
+    }
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    CPU_SET(cpu, &cpuset);
+    int err = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+    if (err != 0) {
+        std::cerr << "Failed to bind " << name << " thread to CPU core " << cpu << ": " << strerror(err) << std::endl;
+    }
+}
+
+// Expected length of a request type, 0 if the type is not a request.
+static uint16_t request_length(GwMsgType type) {
+    switch (type) {
+        case GwMsgType::NEW_ORDER: return sizeof(NewOrderMsg);
+        case GwMsgType::CANCEL:    return sizeof(CancelMsg);
+        case GwMsgType::MODIFY:    return sizeof(ModifyMsg);
+        default:                   return 0;
+    }
+}
+
+OrderGateway::OrderGateway(const GatewayConfig& config)
+    : _config(config),
+      _sessions(std::make_unique<Session[]>(MAX_SESSIONS)),
+      _generation(std::make_unique<uint16_t[]>(MAX_SESSIONS)),
+      _next_sequence(std::make_unique<uint32_t[]>(MAX_SESSIONS)) {
+    // Lowest slots first, so order ids stay small in light use
+    for (size_t i = MAX_SESSIONS; i > 0; --i) {
+        _free_sessions.push_back(static_cast<uint16_t>(i - 1));
+    }
+    _ready.reserve(MAX_SESSIONS);
+    _dirty.reserve(MAX_SESSIONS);
+    _pending_disconnects.reserve(MAX_SESSIONS);
+}
+
+OrderGateway::~OrderGateway() {
+    stop();
+}
+
+bool OrderGateway::start() {
+    if (_config.standby) {
+        if (!_replication.open(_config.standby)) {
+            std::cerr << "No replication log " << _config.standby << std::endl;
+            return false;
+        }
+        _running.store(true, std::memory_order_release);
+        _matching = std::thread(&OrderGateway::matching_loop, this);
+        return true;
+    }
+
+    if ((_config.replicate && !_replication.create(_config.replicate)) || !open_listener()) {
+        return false;
+    }
+    _running.store(true, std::memory_order_release);
+    _matching = std::thread(&OrderGateway::matching_loop, this);
+    _network = std::thread(&OrderGateway::network_loop, this);
+    return true;
+}
+
+bool OrderGateway::serve() {
+    if (!promoted() || _network.joinable() || !open_listener()) {
+        return false;
+    }
+
+    // The matching thread published _next_sequence before _promoted: slots the primary used keep their orders
+    _free_sessions.erase(std::remove_if(_free_sessions.begin(), _free_sessions.end(),
+        [this](uint16_t idx) { return _next_sequence[idx] != 0; }), _free_sessions.end());
+    _network = std::thread(&OrderGateway::network_loop, this);
+    return true;
+}
+
+bool OrderGateway::open_listener() {
+    _listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if (_listen_fd < 0) {
+        perror("socket");
+        return false;
+    }
+
+    int opt = 1;
+    setsockopt(_listen_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+
+    sockaddr_in saddr{};
+    saddr.sin_family = AF_INET;
+    saddr.sin_port = htons(_config.port);
+    inet_pton(AF_INET, _config.addr, &saddr.sin_addr);
+    if (bind(_listen_fd, (sockaddr*)&saddr, sizeof(saddr)) < 0 || listen(_listen_fd, SOMAXCONN) < 0) {
+        perror("bind/listen");
+        close(_listen_fd);
+        _listen_fd = -1;
+        return false;
+    }
+
+    _epoll_fd = epoll_create1(0);
+    epoll_event ev{};
+    ev.events = EPOLLIN | EPOLLET;
+    ev.data.u32 = LISTENER;
+    if (_epoll_fd < 0 || epoll_ctl(_epoll_fd, EPOLL_CTL_ADD, _listen_fd, &ev) < 0) {
+        perror("epoll");
+        close(_listen_fd);
+        _listen_fd = -1;
+        return false;
+    }
+    return true;
+}
+
+void OrderGateway::stop() {
+    if (!_running.exchange(false, std::memory_order_acq_rel)) {
+        return;
+    }
+    if (_network.joinable()) {
+        _network.join();
+    }
+    if (_matching.joinable()) {
+        _matching.join();
+    }
+
+    for (size_t i = 0; i < MAX_SESSIONS; ++i) {
+        if (_sessions[i].fd >= 0) {
+            close(_sessions[i].fd);
+            _sessions[i].fd = -1;
+        }
+    }
+    if (_epoll_fd >= 0) {
+        close(_epoll_fd);
+    }
+    if (_listen_fd >= 0) {
+        close(_listen_fd);
+    }
+    _epoll_fd = _listen_fd = -1;
+}
+
+// ---------------------------------------------------------------- Network thread
+
+void OrderGateway::network_loop() {
+    pin_thread(_config.network_cpu, "network");
+
+    epoll_event events[64];
+    while (_running.load(std::memory_order_acquire)) {
+        // Busy poll: the loop also drains responses, so it never blocks
+        int n = epoll_wait(_epoll_fd, events, 64, 0);
+        for (int i = 0; i < n; ++i) {
+            if (events[i].data.u32 == LISTENER) {
+                accept_sessions();
+                continue;
+            }
+
+            uint16_t idx = static_cast<uint16_t>(events[i].data.u32);
+            Session& session = _sessions[idx];
+            if (session.fd < 0) {
+                continue;
+            }
+            if ((events[i].events & EPOLLOUT) && session.backlog_size > 0) {
+                write_session(idx);
+            }
+            if ((events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) && !session.ready) {
+                session.ready = true;
+                _ready.push_back(idx);
+            }
+        }
+
+        // Serve readable sessions, keep those held back by a full queue for the next iteration
+        size_t kept = 0;
+        for (uint16_t idx : _ready) {
+            if (serve_session(idx)) {
+                _ready[kept++] = idx;
+            } else {
+                _sessions[idx].ready = false;
+            }
+        }
+        _ready.resize(kept);
+
+        // Closed sessions whose disconnect didn't fit in the queue
+        size_t pending = 0;
+        for (auto [idx, generation] : _pending_disconnects) {
+            if (!send_disconnect(idx, generation)) {
+                _pending_disconnects[pending++] = {idx, generation};
+            }
+        }
+        _pending_disconnects.resize(pending);
+
+        flush_responses();
+    }
+}
+
+void OrderGateway::accept_sessions() {
+    // Edge triggered: accept until the backlog is empty
+    while (true) {
+        int fd = accept4(_listen_fd, nullptr, nullptr, SOCK_NONBLOCK);
+        if (fd < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                perror("accept");
+            }
+            return;
+        }
+        if (_free_sessions.empty()) {
+            close(fd);
+            continue;
+        }
+
+        uint16_t idx = _free_sessions.back();
+        Session& session = _sessions[idx];
+        if (!session.recv.mapped() && !session.recv.init(RECV_BUFFER)) {
+            close(fd);
+            continue;
+        }
+        if (!session.backlog) {
+            session.backlog = std::make_unique<char[]>(SEND_BACKLOG);
+        }
+        _free_sessions.pop_back();
+
+        int opt = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+
+        session.fd = fd;
+        session.recv.clear();
+        session.backlog_size = 0;
+        session.iov_count = 0;
+
+        epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        ev.data.u32 = idx;
+        epoll_ctl(_epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+        _stats.sessions.fetch_add(1, std::memory_order_relaxed);
+
+        // Bytes may have arrived before registration, with no edge left to report them
+        if (!session.ready) {
+            session.ready = true;
+            _ready.push_back(idx);
+        }
+    }
+}
+
+bool OrderGateway::serve_session(uint16_t idx) {
+    Session& session = _sessions[idx];
+    if (session.fd < 0) {
+        return false;
+    }
+
+    // Edge triggered: read until EAGAIN, unless the queue to the matching thread is full
+    while (true) {
+        ParseResult parsed = parse_requests(idx);
+        if (parsed == ParseResult::ERROR) {
+            close_session(idx);
+            return false;
+        }
+        if (parsed == ParseResult::BLOCKED) {
+            return true;
+        }
+
+        ssize_t received = read(session.fd, session.recv.space(), session.recv.free_space());
+        if (received > 0) {
+            session.recv.produced(received);
+            continue;
+        }
+        if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return false;
+        }
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+        close_session(idx);
+        return false;
+    }
+}
+
+OrderGateway::ParseResult OrderGateway::parse_requests(uint16_t idx) {
+    Session& session = _sessions[idx];
+    size_t parsed = 0;
+
+    // The buffer is mirrored: every complete message is contiguous at data()
+    while (session.recv.size() >= sizeof(MsgHeader)) {
+        const MsgHeader* header = reinterpret_cast<const MsgHeader*>(session.recv.data());
+        if (header->length < sizeof(MsgHeader) || header->length > MAX_REQUEST) {
+            return ParseResult::ERROR;  // Can't frame the rest of the stream
+        }
+        if (session.recv.size() < header->length) {
+            break;
+        }
+
+        Command* command = _inbound.claim();
+        if (!command) {
+            _stats.requests.fetch_add(parsed, std::memory_order_relaxed);
+            return ParseResult::BLOCKED;
+        }
+        command->session = idx;
+        command->generation = session.generation;
+        command->disconnect = 0;
+        memcpy(command->message, header, header->length);
+        _inbound.publish();
+
+        session.recv.consumed(header->length);
+        parsed++;
+    }
+
+    _stats.requests.fetch_add(parsed, std::memory_order_relaxed);
+    return session.recv.free_space() > 0 ? ParseResult::DRAINED : ParseResult::BLOCKED;
+}
+
+void OrderGateway::close_session(uint16_t idx) {
+    Session& session = _sessions[idx];
+    close(session.fd);  // Also leaves the epoll set
+    session.fd = -1;
+    session.recv.clear();
+    session.backlog_size = 0;
+    session.iov_count = 0;
+    uint16_t generation = session.generation++;
+    _stats.disconnects.fetch_add(1, std::memory_order_relaxed);
+
+    // The slot is only reused once the matching thread has been told: requests of the next
+    // session on it must queue behind the disconnect
+    if (!send_disconnect(idx, generation)) {
+        _pending_disconnects.push_back({idx, generation});
+    }
+}
+
+bool OrderGateway::send_disconnect(uint16_t idx, uint16_t generation) {
+    Command* command = _inbound.claim();
+    if (!command) {
+        return false;
+    }
+    command->session = idx;
+    command->generation = generation;
+    command->disconnect = 1;
+    _inbound.publish();
+    _free_sessions.push_back(idx);
+    return true;
+}
+
+void OrderGateway::flush_responses() {
+    size_t available = std::min<size_t>(_outbound.available(), 4096);
+    size_t used = 0;
+
+    // Gather responses per session, pointing into the queue slots
+    for (; used < available; ++used) {
+        Response& response = _outbound.at(used);
+        Session& session = _sessions[response.session];
+        if (session.fd < 0 || response.generation != session.generation) {
+            continue;  // Session gone
+        }
+        if (session.iov_count == MAX_IOV) {
+            break;     // Write what's gathered first, the rest goes next iteration
+        }
+        if (!session.dirty) {
+            session.dirty = true;
+            _dirty.push_back(response.session);
+        }
+        session.iov[session.iov_count++] = {response.message, response.length};
+    }
+
+    uint64_t responses = 0;
+    for (uint16_t idx : _dirty) {
+        responses += _sessions[idx].iov_count;
+        write_session(idx);
+        _sessions[idx].dirty = false;
+    }
+    _dirty.clear();
+
+    // Slots can only be reused once written or copied to a backlog
+    _outbound.release(used);
+    _stats.responses.fetch_add(responses, std::memory_order_relaxed);
+}
+
+void OrderGateway::write_session(uint16_t idx) {
+    Session& session = _sessions[idx];
+    if (session.fd < 0) {
+        session.iov_count = 0;
+        return;
+    }
+
+    // Backlog first, to keep responses in order
+    iovec vec[MAX_IOV + 1];
+    int count = 0;
+    size_t total = 0;
+    if (session.backlog_size > 0) {
+        vec[count++] = {session.backlog.get(), session.backlog_size};
+        total += session.backlog_size;
+    }
+    for (size_t i = 0; i < session.iov_count; ++i) {
+        vec[count++] = session.iov[i];
+        total += session.iov[i].iov_len;
+    }
+    session.iov_count = 0;
+    if (count == 0) {
+        return;
+    }
+
+    ssize_t written = writev(session.fd, vec, count);
+    _stats.writes.fetch_add(1, std::memory_order_relaxed);
+    if (written < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            close_session(idx);
+            return;
+        }
+        written = 0;
+    }
+    if (static_cast<size_t>(written) == total) {
+        session.backlog_size = 0;
+        return;
+    }
+
+    // Keep what the socket didn't take, EPOLLOUT resumes it
+    if (total - written > SEND_BACKLOG) {
+        _stats.slow_sessions.fetch_add(1, std::memory_order_relaxed);
+        close_session(idx);
+        return;
+    }
+    size_t skip = written;
+    size_t kept = 0;
+    for (int i = 0; i < count; ++i) {
+        const char* base = static_cast<const char*>(vec[i].iov_base);
+        size_t len = vec[i].iov_len;
+        if (skip >= len) {
+            skip -= len;
+            continue;
+        }
+        // memmove: the first vector may be the backlog itself
+        memmove(session.backlog.get() + kept, base + skip, len - skip);
+        kept += len - skip;
+        skip = 0;
+    }
+    session.backlog_size = kept;
+}
+
+// ---------------------------------------------------------------- Matching thread
+
+void OrderGateway::matching_loop() {
+    pin_thread(_config.matching_cpu, "matching");
+
+    // Built on this thread, so the book's arena is local to it
+    MatchingEngine engine;
+    uint16_t taker_session = 0;
+
+    if (_config.standby && !follow(engine)) {
+        _running.store(false, std::memory_order_release);
+        return;
+    }
+    if (_config.replicate) {
+        engine.set_replication(&_replication);
+    }
+
+    engine.on_fill = [this, &taker_session](const FillReport& report) {
+        _taker_filled += report.traded_volume;
+
+        auto maker = make_msg<FillMsg>(GwMsgType::FILL);
+        maker.order_id = report.maker_order_id;
+        maker.price = report.traded_price;
+        maker.volume = report.traded_volume;
+        emit(static_cast<uint16_t>((report.maker_order_id >> SESSION_SHIFT) - 1), &maker, sizeof(maker));
+
+        auto taker = maker;
+        taker.order_id = report.taker_order_id;
+        taker.aggressor = 1;
+        emit(taker_session, &taker, sizeof(taker));
+    };
+    engine.on_cancel = [this](const CancelReport& report) {
+        auto canceled = make_msg<CanceledMsg>(GwMsgType::CANCELED);
+        canceled.client_order_id = _client_order_id;
+        canceled.order_id = report.order_id;
+        canceled.volume = report.cancelled_volume;
+        emit(static_cast<uint16_t>((report.order_id >> SESSION_SHIFT) - 1), &canceled, sizeof(canceled));
+    };
+
+    while (_running.load(std::memory_order_acquire)) {
+        size_t available = _inbound.available();
+        if (available == 0) {
+            _mm_pause();
+            continue;
+        }
+        for (size_t i = 0; i < available; ++i) {
+            const Command& command = _inbound.at(i);
+            taker_session = command.session;
+            handle(engine, command);
+        }
+        _inbound.release(available);
+    }
+}
+
+bool OrderGateway::assign_order_id(const OrderBook& book, uint16_t session, uint32_t& next_sequence, uint32_t& order_id) {
+    Order resting;
+    for (uint32_t tries = 0; tries < (1u << SESSION_SHIFT); ++tries) {
+        uint32_t sequence = next_sequence++ & ((1u << SESSION_SHIFT) - 1);
+        order_id = (static_cast<uint32_t>(session) + 1) << SESSION_SHIFT | sequence;
+        if (!book.find(order_id, resting)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void OrderGateway::follow_order_id(uint32_t& next_sequence, uint32_t order_id) {
+    constexpr uint32_t mask = (1u << SESSION_SHIFT) - 1;
+    uint32_t ahead = ((order_id & mask) + 1 - next_sequence) & mask;
+    if (ahead != 0 && ahead < (1u << (SESSION_SHIFT - 1))) {
+        next_sequence += ahead;
+    }
+}
+
+bool OrderGateway::follow(MatchingEngine& engine) {
+    // Gateway state the primary derived from the same inputs: order id sequences, time priority
+    engine.on_ack = [this](const AckReport& ack) {
+        uint16_t session = static_cast<uint16_t>((ack.order_id >> SESSION_SHIFT) - 1);
+        follow_order_id(_next_sequence[session], ack.order_id);
+        _timestamp = std::max(_timestamp, ack.order_timestamp);
+    };
+
+    // Until promoted, and everything published before the command is applied
+    StandbyReplica replica(_replication, engine);
+    while (_running.load(std::memory_order_acquire) && !replica.lapped()) {
+        bool promote = _replication.promotion_requested();
+        if (replica.poll() == 0) {
+            if (promote && replica.applied() == _replication.head()) {
+                break;
+            }
+            _mm_pause();
+        }
+    }
+    engine.on_ack = nullptr;
+
+    std::cout << "[Standby] Applied: " << replica.applied()
+              << ", Hash checks: " << replica.hash_checks()
+              << ", Mismatches: " << replica.hash_mismatches()
+              << ", Lapped: " << (replica.lapped() ? "yes" : "no")
+              << ", Resting orders: " << engine.order_book().get_map().size()
+              << std::endl;
+    if (!_running.load(std::memory_order_acquire)) {
+        return false;
+    }
+    if (!replica.in_sync()) {
+        std::cerr << "Standby out of sync with the primary, not promoted" << std::endl;
+        return false;
+    }
+    _promoted.store(true, std::memory_order_release);
+    return true;
+}
+
+void OrderGateway::handle(MatchingEngine& engine, const Command& command) {
+    uint16_t session = command.session;
+    _generation[session] = command.generation;
+    _client_order_id = 0;
+
+    if (command.disconnect) {
+        // Cancel on disconnect, reports go to a generation the network thread dropped
+        uint32_t owner = session + 1u;
+        engine.mass_cancel(owner, Side::BID, 0, INT32_MAX);
+        engine.mass_cancel(owner, Side::ASK, 0, INT32_MAX);
+        return;
+    }
+
+    const MsgHeader& header = *reinterpret_cast<const MsgHeader*>(command.message);
+    if (header.length != request_length(header.type)) {
+        reject(session, 0, 0, RejectReason::INVALID, 0);
+        return;
+    }
+
+    switch (header.type) {
+        case GwMsgType::NEW_ORDER:
+            handle_new_order(engine, session, *reinterpret_cast<const NewOrderMsg*>(command.message));
+            break;
+        case GwMsgType::CANCEL:
+            handle_cancel(engine, session, *reinterpret_cast<const CancelMsg*>(command.message));
+            break;
+        case GwMsgType::MODIFY:
+            handle_modify(engine, session, *reinterpret_cast<const ModifyMsg*>(command.message));
+            break;
+        default:
+            break;
+    }
+}
+
+void OrderGateway::handle_new_order(MatchingEngine& engine, uint16_t session, const NewOrderMsg& msg) {
+    _client_order_id = msg.client_order_id;
+    if (msg.price <= 0 || msg.volume == 0 || msg.side > 1) {
+        reject(session, msg.client_order_id, 0, RejectReason::INVALID, msg.client_timestamp);
+        return;
+    }
+
+    // After the sequence wraps, ids of orders still resting are skipped
+    uint32_t order_id;
+    if (!assign_order_id(engine.order_book(), session, _next_sequence[session], order_id)) {
+        reject(session, msg.client_order_id, 0, RejectReason::IDS_EXHAUSTED, msg.client_timestamp);
+        return;
+    }
+    Order order = {
+        .id = order_id,
+        .timestamp = ++_timestamp,
+        .price = msg.price,
+        .volume = msg.volume,
+        .side = msg.side == 1 ? Side::ASK : Side::BID,
+        .owner = session + 1u
+    };
+
+    auto ack = make_msg<AckMsg>(GwMsgType::ACK);
+    ack.client_order_id = msg.client_order_id;
+    ack.order_id = order.id;
+    ack.price = order.price;
+    ack.volume = order.volume;
+    ack.side = msg.side;
+    ack.client_timestamp = msg.client_timestamp;
+    emit(session, &ack, sizeof(ack));
+
+    submit(engine, session, order);
+}
+
+void OrderGateway::handle_cancel(MatchingEngine& engine, uint16_t session, const CancelMsg& msg) {
+    _client_order_id = msg.client_order_id;
+    if ((msg.order_id >> SESSION_SHIFT) != session + 1u) {
+        Order resting;
+        bool exists = engine.order_book().find(msg.order_id, resting);
+        reject(session, msg.client_order_id, msg.order_id, exists ? RejectReason::NOT_OWNER : RejectReason::UNKNOWN_ORDER, 0);
+        return;
+    }
+    if (!engine.cancel_order(msg.order_id)) {
+        reject(session, msg.client_order_id, msg.order_id, RejectReason::UNKNOWN_ORDER, 0);
+    }
+}
+
+void OrderGateway::handle_modify(MatchingEngine& engine, uint16_t session, const ModifyMsg& msg) {
+    _client_order_id = msg.client_order_id;
+    OrderBook& book = engine.order_book();
+
+    Order resting;
+    if (!book.find(msg.order_id, resting)) {
+        reject(session, msg.client_order_id, msg.order_id, RejectReason::UNKNOWN_ORDER, 0);
+        return;
+    }
+    if (resting.owner != session + 1u) {
+        reject(session, msg.client_order_id, msg.order_id, RejectReason::NOT_OWNER, 0);
+        return;
+    }
+    if (msg.price <= 0 || msg.volume == 0) {
+        reject(session, msg.client_order_id, msg.order_id, RejectReason::INVALID, 0);
+        return;
+    }
+
+    auto ack = make_msg<AckMsg>(GwMsgType::ACK);
+    ack.client_order_id = msg.client_order_id;
+    ack.order_id = msg.order_id;
+    ack.price = msg.price;
+    ack.volume = msg.volume;
+    ack.side = static_cast<uint8_t>(resting.side);
+
+    // Volume down at the same price keeps time priority
+    if (msg.price == resting.price && msg.volume < resting.volume) {
+        engine.reduce(msg.order_id, resting.volume - msg.volume);
+        emit(session, &ack, sizeof(ack));
+        return;
+    }
+
+    // Cancel and replace under the same id, behind everything at the new price
+    emit(session, &ack, sizeof(ack));
+    resting.timestamp = ++_timestamp;
+    resting.price = msg.price;
+    resting.volume = msg.volume;
+    submit(engine, session, resting, true);
+}
+
+void OrderGateway::submit(MatchingEngine& engine, uint16_t session, const Order& order, bool replace) {
+    _taker_filled = 0;
+    if (replace ? engine.replace(order) : engine.match(order)) {
+        return;
+    }
+
+    // The residual couldn't rest
+    auto canceled = make_msg<CanceledMsg>(GwMsgType::CANCELED);
+    canceled.client_order_id = _client_order_id;
+    canceled.order_id = order.id;
+    canceled.volume = order.volume - _taker_filled;
+    emit(session, &canceled, sizeof(canceled));
+}
+
+void OrderGateway::reject(uint16_t session, uint32_t client_order_id, uint32_t order_id,
+                          RejectReason reason, uint64_t client_timestamp) {
+    auto msg = make_msg<RejectMsg>(GwMsgType::REJECT);
+    msg.client_order_id = client_order_id;
+    msg.order_id = order_id;
+    msg.reason = reason;
+    msg.client_timestamp = client_timestamp;
+    emit(session, &msg, sizeof(msg));
+}
+
+void OrderGateway::emit(uint16_t session, const void* message, uint16_t length) {
+    // Full queue: the network thread is behind, wait for it rather than drop reports
+    Response* response;
+    while (!(response = _outbound.claim())) {
+        if (!_running.load(std::memory_order_relaxed)) {
+            return;
+        }
+        _mm_pause();
+    }
+    response->session = session;
+    response->generation = _generation[session];
+    response->length = length;
+    memcpy(response->message, message, length);
+    _outbound.publish();
+}
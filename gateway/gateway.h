@@ -0,0 +1,158 @@
+#pragma once
+#include "protocol.h"
+#include "spsc_ring.h"
+#include "mirror_buffer.h"
+#include "../order/matching_engine.h"
+#include "../order/replication.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <sys/uio.h>
+
+struct GatewayConfig {
+    const char* addr = "0.0.0.0";
+    int port = 9000;
+    int network_cpu = -1;   // Pin the epoll thread, -1: don't
+    int matching_cpu = -1;  // Pin the matching thread, -1: don't
+    const char* replicate = nullptr;  // Primary: publish every engine input to this shm log
+    const char* standby = nullptr;    // Standby: follow this shm log, serve once promoted
+};
+
+struct alignas(64) GatewayStats {
+    std::atomic<uint64_t> sessions{0};      // Accepted connections
+    std::atomic<uint64_t> disconnects{0};
+    std::atomic<uint64_t> requests{0};      // Messages handed to the matching thread
+    std::atomic<uint64_t> responses{0};     // Messages written to sessions
+    std::atomic<uint64_t> writes{0};        // writev calls
+    std::atomic<uint64_t> slow_sessions{0}; // Closed because their send backlog overflowed
+};
+
+// Order entry over TCP (see protocol.h).
+// A network thread runs an edge triggered epoll loop: each session reads into a mirrored ring buffer,
+// requests are framed and validated in place and copied once into a single producer / single
+// consumer queue to the matching thread, which owns the engine. Responses come back through a
+// second queue; every loop iteration gathers each session's responses straight out of that queue
+// into one writev. Whatever a socket doesn't take goes to a per session backlog.
+class OrderGateway {
+public:
+    static constexpr size_t MAX_SESSIONS = 1024;
+    static constexpr size_t RECV_BUFFER = 64 << 10;
+    static constexpr size_t SEND_BACKLOG = 256 << 10;  // Overflow closes the session
+    static constexpr size_t QUEUE_SLOTS = 1 << 14;
+    static constexpr size_t MAX_IOV = 64;               // Responses per session per writev
+    static constexpr unsigned SESSION_SHIFT = 20;       // Order id: (session + 1) << SESSION_SHIFT | sequence
+
+    explicit OrderGateway(const GatewayConfig& config);
+
+    ~OrderGateway();
+
+    // Listen and start both threads. Return false if the socket can't be set up.
+    // A standby only starts the matching thread, following the primary's log until promoted.
+    bool start();
+
+    // Standby: the promotion command came and every input of the primary was applied.
+    bool promoted() const { return _promoted.load(std::memory_order_acquire); }
+
+    // Standby, once promoted: listen and start the network thread. The book is the primary's.
+    // Session slots owning its resting orders are never reused. Return false if the socket can't be set up.
+    bool serve();
+
+    void stop();
+
+    bool is_running() const { return _running.load(std::memory_order_acquire); }
+
+    const GatewayStats& stats() const { return _stats; }
+
+    // Next order id of session from its sequence counter next_sequence, which wraps to SESSION_SHIFT
+    // bits: ids still resting in book are skipped. Return false if all of them are.
+    static bool assign_order_id(const OrderBook& book, uint16_t session, uint32_t& next_sequence, uint32_t& order_id);
+
+    // Standby: advance next_sequence past order_id, acked by the primary, if it is ahead (modulo the
+    // sequence wrap). Acks of modified orders repeat older ids and leave it as is.
+    static void follow_order_id(uint32_t& next_sequence, uint32_t order_id);
+
+private:
+    static constexpr size_t MAX_REQUEST = 56;
+
+    // Network -> matching
+    struct alignas(64) Command {
+        uint16_t session;
+        uint16_t generation;   // Bumped on every reuse of the session slot
+        uint8_t disconnect;    // 1: session closed, cancel its orders
+        char message[MAX_REQUEST];
+    };
+
+    // Matching -> network, message is written to the socket from here
+    struct alignas(64) Response {
+        uint16_t session;
+        uint16_t generation;
+        uint16_t length;
+        char message[MAX_MSG_LENGTH - 6];
+    };
+
+    struct Session {
+        int fd = -1;
+        uint16_t generation = 0;
+        bool ready = false;          // In the ready list: may have unread or unparsed bytes
+        bool dirty = false;          // Has responses gathered this iteration
+        MirrorBuffer recv;
+        std::unique_ptr<char[]> backlog;
+        size_t backlog_size = 0;
+        iovec iov[MAX_IOV];
+        size_t iov_count = 0;
+    };
+
+    enum class ParseResult { DRAINED, BLOCKED, ERROR };
+
+    bool open_listener();
+
+    // Network thread
+    void network_loop();
+    void accept_sessions();
+    bool serve_session(uint16_t idx);       // Return true if the session must be served again
+    ParseResult parse_requests(uint16_t idx);
+    void close_session(uint16_t idx);
+    bool send_disconnect(uint16_t idx, uint16_t generation);
+    void flush_responses();
+    void write_session(uint16_t idx);
+
+    // Matching thread
+    void matching_loop();
+    bool follow(MatchingEngine& engine);
+    void handle(MatchingEngine& engine, const Command& command);
+    void handle_new_order(MatchingEngine& engine, uint16_t session, const NewOrderMsg& msg);
+    void handle_cancel(MatchingEngine& engine, uint16_t session, const CancelMsg& msg);
+    void handle_modify(MatchingEngine& engine, uint16_t session, const ModifyMsg& msg);
+    void submit(MatchingEngine& engine, uint16_t session, const Order& order, bool replace = false);
+    void reject(uint16_t session, uint32_t client_order_id, uint32_t order_id, RejectReason reason, uint64_t client_timestamp);
+    void emit(uint16_t session, const void* message, uint16_t length);
+
+    GatewayConfig _config;
+    std::atomic<bool> _running{false};
+    std::atomic<bool> _promoted{false};
+    ReplicationLog _replication;
+    int _listen_fd = -1;
+    int _epoll_fd = -1;
+    std::thread _network;
+    std::thread _matching;
+    GatewayStats _stats;
+
+    SpscRing<Command, QUEUE_SLOTS> _inbound;
+    SpscRing<Response, QUEUE_SLOTS> _outbound;
+
+    // Network thread state
+    std::unique_ptr<Session[]> _sessions;
+    std::vector<uint16_t> _free_sessions;
+    std::vector<uint16_t> _ready;
+    std::vector<uint16_t> _dirty;
+    std::vector<std::pair<uint16_t, uint16_t>> _pending_disconnects;  // (session, generation)
+
+    // Matching thread state
+    std::unique_ptr<uint16_t[]> _generation;       // Generation of each session's latest command
+    std::unique_ptr<uint32_t[]> _next_sequence;    // Order id sequence of each session slot, never reset, wraps
+    uint64_t _timestamp = 0;                       // Time priority of incoming orders
+    uint32_t _client_order_id = 0;                 // Of the request being handled
+    uint32_t _taker_filled = 0;                    // Volume filled so far by the incoming order
+};
@@ -0,0 +1,217 @@
+// Load client for the order gateway: each connection keeps a window of new orders in flight and
+// measures order to ACK round trip time from the timestamp echoed in the ACK.
+#include "protocol.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+struct ClientConfig {
+    const char* addr = "127.0.0.1";
+    int port = 9000;
+    int connections = 1;
+    int window = 16;            // New orders in flight per connection
+    double seconds = 5;
+    double cancel_ratio = 0.5;  // Share of acked orders canceled afterwards
+    int32_t mid = 40;           // Prices are drawn around mid
+    int32_t spread = 8;
+    int cpu = -1;               // Pin connection i to cpu + i
+};
+
+struct ClientResult {
+    std::vector<uint64_t> rtt_ns;
+    uint64_t sent = 0, acks = 0, rejects = 0, fills = 0, canceled = 0;
+};
+
+static uint64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void run_connection(const ClientConfig& config, int idx, ClientResult& result) {
+    if (config.cpu >= 0) {
+        cpu_set_t cpuset;
+        CPU_ZERO(&cpuset);
+        CPU_SET(config.cpu + idx, &cpuset);
+        pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+    }
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in saddr{};
+    saddr.sin_family = AF_INET;
+    saddr.sin_port = htons(config.port);
+    inet_pton(AF_INET, config.addr, &saddr.sin_addr);
+    if (connect(fd, (sockaddr*)&saddr, sizeof(saddr)) < 0) {
+        perror("connect");
+        close(fd);
+        return;
+    }
+    int opt = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+
+    std::mt19937 rng(1234 + idx);
+    std::uniform_int_distribution<int32_t> price_dist(config.mid - config.spread, config.mid + config.spread);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+
+    result.rtt_ns.reserve(1 << 22);
+    // Between writes: the cancels of the last read's ACKs, at most a window of them, then a window of new orders
+    std::vector<char> out(config.window * (sizeof(NewOrderMsg) + sizeof(CancelMsg))), in(256 * 1024);
+    size_t in_size = 0, out_size = 0;
+    int in_flight = 0;
+    uint32_t client_order_id = 0;
+    uint64_t deadline = now_ns() + static_cast<uint64_t>(config.seconds * 1e9);
+
+    while (now_ns() < deadline || in_flight > 0) {
+        // Top the window up and send it together with the cancels queued by the last read
+        while (in_flight < config.window && now_ns() < deadline) {
+            auto msg = make_msg<NewOrderMsg>(GwMsgType::NEW_ORDER);
+            msg.client_order_id = ++client_order_id;
+            msg.price = price_dist(rng);
+            msg.volume = 1 + rng() % 10;
+            msg.side = rng() % 2;
+            msg.client_timestamp = now_ns();
+            memcpy(out.data() + out_size, &msg, sizeof(msg));
+            out_size += sizeof(msg);
+            in_flight++;
+            result.sent++;
+        }
+        if (out_size > 0) {
+            if (write(fd, out.data(), out_size) < 0) {
+                perror("write");
+                break;
+            }
+            out_size = 0;
+        }
+
+        ssize_t received = read(fd, in.data() + in_size, in.size() - in_size);
+        if (received <= 0) {
+            break;
+        }
+        in_size += received;
+        uint64_t now = now_ns();
+
+        size_t offset = 0;
+        while (in_size - offset >= sizeof(MsgHeader)) {
+            const MsgHeader* header = reinterpret_cast<const MsgHeader*>(in.data() + offset);
+            if (in_size - offset < header->length) {
+                break;
+            }
+            switch (header->type) {
+                case GwMsgType::ACK: {
+                    const AckMsg* ack = reinterpret_cast<const AckMsg*>(header);
+                    result.rtt_ns.push_back(now - ack->client_timestamp);
+                    result.acks++;
+                    in_flight--;
+                    if (unit(rng) < config.cancel_ratio) {
+                        auto cancel = make_msg<CancelMsg>(GwMsgType::CANCEL);
+                        cancel.order_id = ack->order_id;
+                        memcpy(out.data() + out_size, &cancel, sizeof(cancel));
+                        out_size += sizeof(cancel);
+                    }
+                    break;
+                }
+                case GwMsgType::REJECT: {
+                    const RejectMsg* reject = reinterpret_cast<const RejectMsg*>(header);
+                    result.rejects++;
+                    if (reject->client_timestamp) {
+                        result.rtt_ns.push_back(now - reject->client_timestamp);
+                        in_flight--;
+                    }
+                    break;
+                }
+                case GwMsgType::FILL:     result.fills++; break;
+                case GwMsgType::CANCELED: result.canceled++; break;
+                default: break;
+            }
+            offset += header->length;
+        }
+        memmove(in.data(), in.data() + offset, in_size - offset);
+        in_size -= offset;
+    }
+    close(fd);
+}
+
+void usage(const char* prog) {
+    std::cerr << "Usage: " << prog << " [options]" << std::endl
+              << "  -a addr     gateway address (127.0.0.1)" << std::endl
+              << "  -p port     gateway port (9000)" << std::endl
+              << "  -c n        connections, one thread each (1)" << std::endl
+              << "  -w n        new orders in flight per connection (16)" << std::endl
+              << "  -d seconds  duration (5)" << std::endl
+              << "  -x ratio    share of acked orders canceled (0.5)" << std::endl
+              << "  -M price    mid price (40)" << std::endl
+              << "  -s ticks    prices drawn in mid +- ticks (8)" << std::endl
+              << "  -C cpu      pin connection i to cpu + i" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    ClientConfig config;
+    int opt;
+    while ((opt = getopt(argc, argv, "a:p:c:w:d:x:M:s:C:h")) != -1) {
+        switch (opt) {
+            case 'a': config.addr = optarg; break;
+            case 'p': config.port = atoi(optarg); break;
+            case 'c': config.connections = std::max(1, atoi(optarg)); break;
+            case 'w': config.window = std::max(1, atoi(optarg)); break;
+            case 'd': config.seconds = atof(optarg); break;
+            case 'x': config.cancel_ratio = atof(optarg); break;
+            case 'M': config.mid = atoi(optarg); break;
+            case 's': config.spread = atoi(optarg); break;
+            case 'C': config.cpu = atoi(optarg); break;
+            default: usage(argv[0]); return 1;
+        }
+    }
+
+    config.window = std::min(config.window, 16384);
+
+    std::vector<ClientResult> results(config.connections);
+    std::vector<std::thread> threads;
+    uint64_t start = now_ns();
+    for (int i = 0; i < config.connections; ++i) {
+        threads.emplace_back(run_connection, std::cref(config), i, std::ref(results[i]));
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    double elapsed = (now_ns() - start) / 1e9;
+
+    ClientResult total;
+    for (auto& r : results) {
+        total.rtt_ns.insert(total.rtt_ns.end(), r.rtt_ns.begin(), r.rtt_ns.end());
+        total.sent += r.sent;
+        total.acks += r.acks;
+        total.rejects += r.rejects;
+        total.fills += r.fills;
+        total.canceled += r.canceled;
+    }
+    if (total.rtt_ns.empty()) {
+        std::cerr << "No responses" << std::endl;
+        return 1;
+    }
+
+    std::sort(total.rtt_ns.begin(), total.rtt_ns.end());
+    auto pct = [&](double p) { return total.rtt_ns[static_cast<size_t>(p * (total.rtt_ns.size() - 1))] / 1000.0; };
+    std::cout << "[Client] Orders: " << total.sent
+              << ", Acks: " << total.acks
+              << ", Rejects: " << total.rejects
+              << ", Fills: " << total.fills
+              << ", Canceled: " << total.canceled
+              << ", Throughput: " << total.acks / elapsed << " orders/sec" << std::endl;
+    std::cout << "[Client] Order to ack RTT (us): p50 " << pct(0.5)
+              << ", p90 " << pct(0.9)
+              << ", p99 " << pct(0.99)
+              << ", p99.9 " << pct(0.999)
+              << ", max " << total.rtt_ns.back() / 1000.0 << std::endl;
+    return 0;
+}
@@ -0,0 +1,93 @@
+#include "gateway.h"
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <unistd.h>
+
+std::atomic<bool> signal_received{false};
+
+void signal_handler(int signal) {
+    if (signal == SIGINT || signal == SIGTERM) {
+        signal_received.store(true, std::memory_order_release);
+    }
+}
+
+void usage(const char* prog) {
+    std::cerr << "Usage: " << prog << " [-a addr] [-p port] [-n cpu] [-m cpu] [-r log | -s log] | -P log" << std::endl
+              << "  -a addr   listen address (0.0.0.0)" << std::endl
+              << "  -p port   listen port (9000)" << std::endl
+              << "  -n cpu    pin the network (epoll) thread" << std::endl
+              << "  -m cpu    pin the matching thread" << std::endl
+              << "  -r log    primary: replicate engine inputs to shm log, e.g. /hft_replica" << std::endl
+              << "  -s log    hot standby of the primary writing log, serves once promoted" << std::endl
+              << "  -P log    promotion command: switch order flow to the standby of log, and exit" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    GatewayConfig config;
+    const char* promote = nullptr;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "a:p:n:m:r:s:P:h")) != -1) {
+        switch (opt) {
+            case 'a': config.addr = optarg; break;
+            case 'p': config.port = atoi(optarg); break;
+            case 'n': config.network_cpu = atoi(optarg); break;
+            case 'm': config.matching_cpu = atoi(optarg); break;
+            case 'r': config.replicate = optarg; break;
+            case 's': config.standby = optarg; break;
+            case 'P': promote = optarg; break;
+            default: usage(argv[0]); return 1;
+        }
+    }
+
+    if (promote) {
+        ReplicationLog log;
+        if (!log.open(promote)) {
+            std::cerr << "No replication log " << promote << std::endl;
+            return 1;
+        }
+        log.request_promotion();
+        std::cout << "Promotion requested, published inputs: " << log.head() << ", applied by the standby: " << log.applied() << std::endl;
+        return 0;
+    }
+
+    std::signal(SIGINT, signal_handler);
+    std::signal(SIGTERM, signal_handler);
+
+    OrderGateway gateway(config);
+    if (!gateway.start()) {
+        return 1;
+    }
+    if (config.standby) {
+        std::cout << "Order gateway standing by on " << config.standby << std::endl;
+    } else {
+        std::cout << "Order gateway listening on " << config.addr << ":" << config.port << std::endl;
+    }
+
+    bool serving = !config.standby;
+    while (!signal_received.load(std::memory_order_acquire) && gateway.is_running()) {
+        if (!serving && gateway.promoted()) {
+            if (!gateway.serve()) {
+                break;
+            }
+            serving = true;
+            std::cout << "Promoted: order gateway listening on " << config.addr << ":" << config.port << std::endl;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(serving ? 100 : 1));
+    }
+    gateway.stop();
+
+    const GatewayStats& stats = gateway.stats();
+    std::cout << "[Gateway] Sessions: " << stats.sessions
+              << ", Disconnects: " << stats.disconnects
+              << ", Slow sessions: " << stats.slow_sessions
+              << ", Requests: " << stats.requests
+              << ", Responses: " << stats.responses
+              << ", writev calls: " << stats.writes
+              << std::endl;
+    return 0;
+}
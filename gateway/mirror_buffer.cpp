@@ -0,0 +1,45 @@
+#include "mirror_buffer.h"
+#include <cstdio>
+#include <sys/mman.h>
+#include <unistd.h>
+
+MirrorBuffer::~MirrorBuffer() {
+    if (_data) {
+        munmap(_data, 2 * (_mask + 1));
+    }
+}
+
+bool MirrorBuffer::init(size_t capacity) {
+    int fd = memfd_create("mirror_buffer", MFD_CLOEXEC);
+    if (fd < 0) {
+        perror("memfd_create");
+        return false;
+    }
+    if (ftruncate(fd, capacity) < 0) {
+        perror("ftruncate");
+        close(fd);
+        return false;
+    }
+
+    // Reserve both halves, then map the same pages over each
+    void* base = mmap(nullptr, 2 * capacity, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+        perror("mmap");
+        close(fd);
+        return false;
+    }
+    char* first = static_cast<char*>(base);
+    if (mmap(first, capacity, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED | MAP_POPULATE, fd, 0) == MAP_FAILED ||
+        mmap(first + capacity, capacity, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED | MAP_POPULATE, fd, 0) == MAP_FAILED) {
+        perror("mmap");
+        munmap(base, 2 * capacity);
+        close(fd);
+        return false;
+    }
+    close(fd);
+
+    _data = first;
+    _mask = capacity - 1;
+    _head = _tail = 0;
+    return true;
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Byte ring whose pages are mapped twice, back to back: any span of up to capacity bytes starting
+// in the first mapping is contiguous in memory, so messages that wrap around the end are parsed
+// in place and a single read fills all free space.
+class MirrorBuffer {
+public:
+    MirrorBuffer() = default;
+
+    ~MirrorBuffer();
+
+    MirrorBuffer(const MirrorBuffer&) = delete;
+    MirrorBuffer& operator=(const MirrorBuffer&) = delete;
+
+    // Map capacity bytes (a power of 2 multiple of the page size). Return false on failure.
+    bool init(size_t capacity);
+
+    bool mapped() const { return _data != nullptr; }
+
+    // Unread bytes, starting at data().
+    size_t size() const { return _tail - _head; }
+    const char* data() const { return _data + (_head & _mask); }
+
+    // Free space, starting at space().
+    size_t free_space() const { return _mask + 1 - size(); }
+    char* space() { return _data + (_tail & _mask); }
+
+    void produced(size_t n) { _tail += n; }
+    void consumed(size_t n) { _head += n; }
+
+    void clear() { _head = _tail = 0; }
+
+private:
+    char* _data = nullptr;
+    size_t _mask = 0;
+    uint64_t _head = 0;
+    uint64_t _tail = 0;
+};
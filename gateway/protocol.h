@@ -0,0 +1,114 @@
+#pragma once
+#include <cstdint>
+
+// Order entry protocol, little endian, packed.
+// Every message starts with a MsgHeader whose length covers the whole message, header included,
+// so a reader can frame the stream without knowing every type. Requests carry a client chosen
+// client_order_id and are answered with ACK, REJECT or CANCELED echoing it; FILL messages arrive
+// for both the resting and the incoming order of every trade. Closing the connection cancels
+// every resting order of the session.
+
+enum class GwMsgType : uint8_t {
+    // Client -> gateway
+    NEW_ORDER = 'N',
+    CANCEL    = 'C',
+    MODIFY    = 'M',
+
+    // Gateway -> client
+    ACK       = 'A',
+    FILL      = 'F',
+    CANCELED  = 'X',
+    REJECT    = 'R',
+};
+
+enum class RejectReason : uint8_t {
+    INVALID = 1,     // Malformed message, bad price, volume or side
+    BOOK_FULL,       // The price's tier has no free lane
+    UNKNOWN_ORDER,   // Not resting (filled, canceled or never existed)
+    NOT_OWNER,       // Resting, but entered by another session
+    IDS_EXHAUSTED,   // Every order id of the session is resting
+};
+
+#pragma pack(push, 1)
+
+struct MsgHeader {
+    uint16_t length;
+    GwMsgType type;
+    uint8_t reserved;
+};
+
+struct NewOrderMsg {
+    MsgHeader header;
+    uint32_t client_order_id;
+    int32_t price;
+    uint32_t volume;
+    uint8_t side;               // Bid: 0, Ask: 1
+    uint8_t reserved[3];
+    uint64_t client_timestamp;  // Echoed in the ACK or REJECT, for round trip measurement
+};
+
+struct CancelMsg {
+    MsgHeader header;
+    uint32_t client_order_id;
+    uint32_t order_id;          // As assigned in the ACK
+};
+
+// Same price and lower volume keeps time priority, anything else is cancel and replace
+// under the same order id.
+struct ModifyMsg {
+    MsgHeader header;
+    uint32_t client_order_id;
+    uint32_t order_id;
+    int32_t price;
+    uint32_t volume;
+};
+
+// Accepted, sent before any fill of the order. A residual that can't rest (tier full)
+// is then canceled with a CANCELED message.
+struct AckMsg {
+    MsgHeader header;
+    uint32_t client_order_id;
+    uint32_t order_id;
+    int32_t price;
+    uint32_t volume;
+    uint8_t side;
+    uint8_t reserved[3];
+    uint64_t client_timestamp;
+};
+
+struct FillMsg {
+    MsgHeader header;
+    uint32_t order_id;
+    int32_t price;
+    uint32_t volume;
+    uint8_t aggressor;          // 1 if order_id was the incoming order
+    uint8_t reserved[3];
+};
+
+struct CanceledMsg {
+    MsgHeader header;
+    uint32_t client_order_id;   // 0 when canceled by the gateway
+    uint32_t order_id;
+    uint32_t volume;
+};
+
+struct RejectMsg {
+    MsgHeader header;
+    uint32_t client_order_id;
+    uint32_t order_id;
+    RejectReason reason;
+    uint8_t reserved[3];
+    uint64_t client_timestamp;
+};
+
+#pragma pack(pop)
+
+static constexpr uint16_t MAX_MSG_LENGTH = 64;
+
+template <typename Msg>
+Msg make_msg(GwMsgType type) {
+    Msg msg{};
+    msg.header.length = sizeof(Msg);
+    msg.header.type = type;
+    return msg;
+}
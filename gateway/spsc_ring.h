@@ -0,0 +1,64 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// Bounded single producer / single consumer queue of fixed size slots.
+// Both sides work on slots in place: the producer claims a slot, fills it and publishes it, the
+// consumer reads a batch of published slots where they are and releases them when done. Each side
+// caches the other's index and only rereads it when the cache says the ring is full or empty.
+template <typename T, size_t N>
+class SpscRing {
+    static_assert((N & (N - 1)) == 0, "N must be a power of 2");
+
+public:
+    SpscRing() : _slots(std::make_unique<T[]>(N)) {}
+
+    // Producer: next free slot, nullptr if the ring is full.
+    T* claim() {
+        if (_head - _cached_tail == N) {
+            _cached_tail = _tail.load(std::memory_order_acquire);
+            if (_head - _cached_tail == N) {
+                return nullptr;
+            }
+        }
+        return &_slots[_head & (N - 1)];
+    }
+
+    // Producer: make the claimed slot visible.
+    void publish() {
+        ++_head;
+        _shared_head.store(_head, std::memory_order_release);
+    }
+
+    // Consumer: number of published slots not yet released.
+    size_t available() {
+        if (_cached_head == _consumer_tail) {
+            _cached_head = _shared_head.load(std::memory_order_acquire);
+        }
+        return _cached_head - _consumer_tail;
+    }
+
+    // Consumer: i-th unreleased slot, i < available().
+    T& at(size_t i) { return _slots[(_consumer_tail + i) & (N - 1)]; }
+
+    // Consumer: give the first n slots back to the producer.
+    void release(size_t n) {
+        _consumer_tail += n;
+        _tail.store(_consumer_tail, std::memory_order_release);
+    }
+
+private:
+    std::unique_ptr<T[]> _slots;
+
+    // Producer line
+    alignas(64) uint64_t _head = 0;
+    uint64_t _cached_tail = 0;
+    alignas(64) std::atomic<uint64_t> _shared_head{0};
+
+    // Consumer line
+    alignas(64) uint64_t _consumer_tail = 0;
+    uint64_t _cached_head = 0;
+    alignas(64) std::atomic<uint64_t> _tail{0};
+};
@@ -0,0 +1,70 @@
+#include "gateway.h"
+#include <iostream>
+#include <cassert>
+#include <vector>
+
+static constexpr uint32_t SEQUENCES = 1u << OrderGateway::SESSION_SHIFT;
+
+static uint32_t id_of(uint16_t session, uint32_t sequence) {
+    return (static_cast<uint32_t>(session) + 1) << OrderGateway::SESSION_SHIFT | sequence;
+}
+
+void run_order_id_wrap_test() {
+    MatchingEngine engine;
+    const uint16_t session = 3;
+
+    // 序号回绕前挂着的旧订单：序号 0、1、3
+    for (uint32_t sequence : {0u, 1u, 3u}) {
+        Order order = {id_of(session, sequence), sequence, static_cast<int32_t>(100 + sequence), 5, Side::BID, session + 1u};
+        assert(engine.match(order));
+    }
+
+    // 计数器位于回绕前两个序号处，主机与备机各一份
+    uint32_t primary = 5 * SEQUENCES - 2;
+    uint32_t standby = primary;
+    std::vector<uint32_t> expected = {SEQUENCES - 2, SEQUENCES - 1, 2, 4, 5};
+    for (uint32_t sequence : expected) {
+        uint32_t order_id;
+        assert(OrderGateway::assign_order_id(engine.order_book(), session, primary, order_id));
+        assert(order_id == id_of(session, sequence));  // 跳过仍在簿上的 0、1、3
+
+        // 新订单挂单，不覆盖旧订单的索引
+        Order order = {order_id, 10, 50, 1, Side::BID, session + 1u};
+        assert(engine.match(order));
+
+        // 备机按确认的订单号跟进，与主机计数器同步
+        OrderGateway::follow_order_id(standby, order_id);
+        assert((standby & (SEQUENCES - 1)) == (primary & (SEQUENCES - 1)));
+    }
+
+    // 旧订单仍在原价位，数量未变
+    for (uint32_t sequence : {0u, 1u, 3u}) {
+        Order resting;
+        assert(engine.order_book().find(id_of(session, sequence), resting));
+        assert(resting.price == static_cast<int32_t>(100 + sequence) && resting.volume == 5);
+    }
+    assert(engine.order_book().get_map().size() == 3 + expected.size());
+
+    // 改单的确认重复较旧的订单号，备机计数器不回退
+    uint32_t before = standby;
+    OrderGateway::follow_order_id(standby, id_of(session, 2));
+    OrderGateway::follow_order_id(standby, id_of(session, SEQUENCES - 2));
+    assert(standby == before);
+
+    // 撤掉旧订单后，其序号在下一轮回绕时可以再用
+    assert(engine.cancel_order(id_of(session, 0)));
+    primary = 6 * SEQUENCES;
+    uint32_t order_id;
+    assert(OrderGateway::assign_order_id(engine.order_book(), session, primary, order_id));
+    assert(order_id == id_of(session, 0));
+
+    std::cout << "[PASSED] Order id wrap test.\n";
+}
+
+int main() {
+    run_order_id_wrap_test();
+
+    std::cout << "[TEST PASSED]" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,82 @@
+#include "arena.h"
+#include <cerrno>
+#include <cstring>
+#include <atomic>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// mbind(2) without linking libnuma.
+static constexpr int ARENA_MPOL_PREFERRED = 1;
+
+int current_numa_node() {
+    unsigned cpu = 0, node = 0;
+    if (syscall(SYS_getcpu, &cpu, &node, nullptr) != 0) {
+        return 0;
+    }
+    return static_cast<int>(node);
+}
+
+Arena::Arena(size_t bytes, int numa_node, bool lock) {
+    _size = (bytes + HUGE_PAGE - 1) / HUGE_PAGE * HUGE_PAGE;
+    _numa_node = numa_node < 0 ? current_numa_node() : numa_node;
+
+    // Reserved huge pages first
+    void* addr = mmap(nullptr, _size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (addr != MAP_FAILED) {
+        _hugetlb = true;
+        _base = static_cast<char*>(addr);
+    } else {
+        // Transparent huge pages: map one extra huge page to align the start
+        addr = mmap(nullptr, _size + HUGE_PAGE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (addr == MAP_FAILED) {
+            throw std::bad_alloc();
+        }
+        uintptr_t start = reinterpret_cast<uintptr_t>(addr);
+        uintptr_t aligned = (start + HUGE_PAGE - 1) & ~(HUGE_PAGE - 1);
+        if (aligned > start) {
+            munmap(addr, aligned - start);
+        }
+        munmap(reinterpret_cast<void*>(aligned + _size), start + HUGE_PAGE - aligned);
+        _base = reinterpret_cast<char*>(aligned);
+        madvise(_base, _size, MADV_HUGEPAGE);
+    }
+
+    // Bind before the first touch, so pages are allocated on the node
+    if (_numa_node < 64) {
+        unsigned long nodemask = 1ul << _numa_node;
+        if (syscall(SYS_mbind, _base, _size, ARENA_MPOL_PREFERRED, &nodemask, 64, 0) != 0 && errno != ENOSYS) {
+            std::cerr << "Arena: mbind to node " << _numa_node << " failed: " << strerror(errno) << std::endl;
+        }
+    }
+
+    // Pre-fault every page, then keep it resident
+    for (size_t offset = 0; offset < _size; offset += 4096) {
+        _base[offset] = 0;
+    }
+    if (lock) {
+        // Many arenas may hit the same limit, warn once
+        static std::atomic<bool> warned{false};
+        _locked = mlock(_base, _size) == 0;
+        if (!_locked && !warned.exchange(true)) {
+            std::cerr << "Arena: mlock of " << _size << " bytes failed: " << strerror(errno)
+                      << " (raise RLIMIT_MEMLOCK)" << std::endl;
+        }
+    }
+}
+
+Arena::~Arena() {
+    if (_base) {
+        munmap(_base, _size);
+    }
+}
+
+void* Arena::allocate(size_t bytes, size_t align) {
+    size_t offset = (_used + align - 1) & ~(align - 1);
+    if (offset + bytes > _size) {
+        throw std::bad_alloc();
+    }
+    _used = offset + bytes;
+    return _base + offset;
+}
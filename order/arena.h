@@ -0,0 +1,56 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+// Bump allocator over one pre-faulted, locked mapping.
+// The mapping uses 2MB huge pages (MAP_HUGETLB), falling back to transparent huge pages
+// (madvise) when none are reserved, and is bound to a NUMA node before it is faulted in,
+// so everything carved out of it is local to the thread that owns it.
+// Memory is only released with the arena: allocate everything at warm-up.
+class Arena {
+public:
+    static constexpr size_t HUGE_PAGE = 2 << 20;
+
+    // Map at least bytes. numa_node -1: node of the calling thread.
+    explicit Arena(size_t bytes, int numa_node = -1, bool lock = true);
+
+    ~Arena();
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    // Carve bytes aligned to align (a power of 2). Throw std::bad_alloc when exhausted.
+    void* allocate(size_t bytes, size_t align = 64);
+
+    // Carve and construct count default constructed T.
+    template <typename T>
+    T* create(size_t count = 1) {
+        T* p = static_cast<T*>(allocate(sizeof(T) * count, alignof(T) > 64 ? alignof(T) : 64));
+        for (size_t i = 0; i < count; ++i) {
+            new (p + i) T();
+        }
+        return p;
+    }
+
+    // Rewind to empty, everything carved so far must be dead. Pages stay mapped and locked.
+    void reset() { _used = 0; }
+
+    size_t capacity() const { return _size; }
+    size_t used() const { return _used; }
+
+    bool huge_pages() const { return _hugetlb; }  // Explicit huge pages, else THP was requested
+    bool locked() const { return _locked; }
+    int numa_node() const { return _numa_node; }
+
+private:
+    char* _base = nullptr;
+    size_t _size = 0;
+    size_t _used = 0;
+    bool _hugetlb = false;
+    bool _locked = false;
+    int _numa_node = -1;
+};
+
+// NUMA node of the calling thread.
+int current_numa_node();
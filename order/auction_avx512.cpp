@@ -0,0 +1,132 @@
+#include "auction_avx512.h"
+#include <immintrin.h>
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+
+// Inclusive prefix sum of 8 64-bit lanes: log2(8) adds of the vector shifted up, zero filled.
+static inline __m512i prefix_sum_epi64(__m512i x) {
+    x = _mm512_add_epi64(x, _mm512_maskz_permutexvar_epi64(0xFE, _mm512_setr_epi64(0, 0, 1, 2, 3, 4, 5, 6), x));
+    x = _mm512_add_epi64(x, _mm512_maskz_permutexvar_epi64(0xFC, _mm512_setr_epi64(0, 0, 0, 1, 2, 3, 4, 5), x));
+    x = _mm512_add_epi64(x, _mm512_maskz_permutexvar_epi64(0xF0, _mm512_setr_epi64(0, 0, 0, 0, 0, 1, 2, 3), x));
+    return x;
+}
+
+// Horizontal max or min of 8 unsigned 64-bit lanes.
+static inline uint64_t reduce_epu64(__m512i x, bool max) {
+    alignas(64) uint64_t lanes[8];
+    _mm512_store_si512(lanes, x);
+    return max ? *std::max_element(lanes, lanes + 8) : *std::min_element(lanes, lanes + 8);
+}
+
+AuctionResult AuctionCurves::equilibrium(const OrderBook::PriceLevels& levels, int32_t reference_price) {
+    const OrderBook::SideLevels& bids = levels.bids;
+    const OrderBook::SideLevels& asks = levels.asks;
+    if (bids.size == 0 || asks.size == 0) {
+        return {};
+    }
+    int32_t low = asks.prices[asks.size - 1];
+    int32_t high = bids.prices[bids.size - 1];
+    if (high < low) {
+        return {};
+    }
+
+    // Levels are sorted worst to best: the crossed ones are the best of each side
+    size_t b = bids.size;
+    while (b > 0 && bids.prices[b - 1] >= low) {
+        b--;
+    }
+    size_t a = asks.size;
+    while (a > 0 && asks.prices[a - 1] <= high) {
+        a--;
+    }
+
+    // Merge both into one ascending ladder, padded to whole vectors with empty prices
+    size_t capacity = ((bids.size - b) + (asks.size - a) + 7) & ~size_t(7);
+    if (_prices.size() < capacity) {
+        _prices.resize(capacity);
+        _bids.resize(capacity);
+        _asks.resize(capacity);
+    }
+
+    uint64_t total_bids = 0;
+    size_t n = 0;
+    size_t i = b;               // Ascending bid prices
+    size_t j = asks.size;       // Ascending ask prices, from the best one down
+    while (i < bids.size || j > a) {
+        int32_t bid_price = i < bids.size ? bids.prices[i] : std::numeric_limits<int32_t>::max();
+        int32_t ask_price = j > a ? asks.prices[j - 1] : std::numeric_limits<int32_t>::max();
+        int32_t price = std::min(bid_price, ask_price);
+        _prices[n] = price;
+        _bids[n] = bid_price == price ? bids.volumes[i++] : 0;
+        _asks[n] = ask_price == price ? asks.volumes[--j] : 0;
+        total_bids += _bids[n];
+        n++;
+    }
+    for (size_t k = n; k < capacity; ++k) {
+        _prices[k] = std::numeric_limits<int32_t>::max();
+        _bids[k] = 0;
+        _asks[k] = 0;
+    }
+
+    // Demand at price k: all bids minus those up to k, plus those at k. Supply: asks up to k.
+    // Padding lanes see no demand, so their executable volume is 0.
+    const __m512i total = _mm512_set1_epi64(static_cast<long long>(total_bids));
+    const __m512i last_lane = _mm512_set1_epi64(7);
+    __m512i bid_carry = _mm512_setzero_si512();
+    __m512i ask_carry = _mm512_setzero_si512();
+    __m512i best = _mm512_setzero_si512();
+
+    for (size_t k = 0; k < capacity; k += 8) {
+        __m512i bid_volume = _mm512_loadu_si512(_bids.data() + k);
+        __m512i bid_upto = _mm512_add_epi64(bid_carry, prefix_sum_epi64(bid_volume));
+        __m512i supply = _mm512_add_epi64(ask_carry, prefix_sum_epi64(_mm512_loadu_si512(_asks.data() + k)));
+        bid_carry = _mm512_permutexvar_epi64(last_lane, bid_upto);
+        ask_carry = _mm512_permutexvar_epi64(last_lane, supply);
+
+        __m512i demand = _mm512_add_epi64(_mm512_sub_epi64(total, bid_upto), bid_volume);
+        __m512i executable = _mm512_min_epu64(demand, supply);
+        best = _mm512_max_epu64(best, executable);
+        _mm512_storeu_si512(_bids.data() + k, executable);
+        _mm512_storeu_si512(_asks.data() + k, _mm512_sub_epi64(demand, supply));
+    }
+
+    uint64_t volume = reduce_epu64(best, true);
+    if (volume == 0) {
+        return {};
+    }
+
+    // Smallest absolute surplus among the maximum volume prices
+    const __m512i volume_vec = _mm512_set1_epi64(static_cast<long long>(volume));
+    __m512i min_surplus = _mm512_set1_epi64(std::numeric_limits<int64_t>::max());
+    for (size_t k = 0; k < capacity; k += 8) {
+        __mmask8 candidate = _mm512_cmpeq_epu64_mask(_mm512_loadu_si512(_bids.data() + k), volume_vec);
+        __m512i surplus = _mm512_abs_epi64(_mm512_loadu_si512(_asks.data() + k));
+        min_surplus = _mm512_mask_min_epu64(min_surplus, candidate, min_surplus, surplus);
+    }
+    uint64_t smallest = reduce_epu64(min_surplus, false);
+    const __m512i smallest_vec = _mm512_set1_epi64(static_cast<long long>(smallest));
+
+    // Few prices are left: settle them on market pressure, then on the reference price
+    size_t first = n, last = n, closest = n;
+    bool buy_pressure = true, sell_pressure = true;
+    for (size_t k = 0; k < capacity; k += 8) {
+        __mmask8 candidate = _mm512_cmpeq_epu64_mask(_mm512_loadu_si512(_bids.data() + k), volume_vec);
+        candidate = _mm512_mask_cmpeq_epu64_mask(candidate, _mm512_abs_epi64(_mm512_loadu_si512(_asks.data() + k)), smallest_vec);
+        for (uint32_t lanes = candidate; lanes; lanes &= lanes - 1) {
+            size_t c = k + __builtin_ctz(lanes);
+            int64_t surplus = static_cast<int64_t>(_asks[c]);
+            first = std::min(first, c);
+            last = c;
+            buy_pressure = buy_pressure && surplus > 0;
+            sell_pressure = sell_pressure && surplus < 0;
+            if (closest == n || std::llabs(static_cast<int64_t>(_prices[c]) - reference_price)
+                              < std::llabs(static_cast<int64_t>(_prices[closest]) - reference_price)) {
+                closest = c;
+            }
+        }
+    }
+
+    size_t chosen = buy_pressure ? last : sell_pressure ? first : closest;
+    return {_prices[chosen], volume, static_cast<int64_t>(_asks[chosen])};
+}
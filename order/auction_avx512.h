@@ -0,0 +1,29 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "orderbook.h"
+
+// Outcome of a call auction.
+struct AuctionResult {
+    int32_t  price = 0;    // Equilibrium price, 0 if the book isn't crossed
+    uint64_t volume = 0;   // Volume executable at price
+    int64_t  surplus = 0;  // Bid minus ask volume at price: > 0 buy pressure, < 0 sell pressure
+};
+
+// Cumulative volume curves of a call auction over the crossed part of a book.
+// The limit prices between the best ask and the best bid form an ascending ladder; AVX-512 prefix
+// sums turn the volume at each ladder price into cumulative demand (bids at or above it) and
+// supply (asks at or below it), 8 prices per step. Buffers grow to the largest ladder seen.
+class AuctionCurves {
+public:
+    // Ladder price maximizing executable volume, min(demand, supply). Ties go to the smallest
+    // absolute surplus, then to market pressure (the highest price if every remaining candidate has
+    // buy surplus, the lowest if sell), then to the price closest to reference_price, the lower one
+    // if equidistant.
+    AuctionResult equilibrium(const OrderBook::PriceLevels& levels, int32_t reference_price);
+
+private:
+    std::vector<int32_t>  _prices;   // Ladder, ascending
+    std::vector<uint64_t> _bids;     // Bid volume at each ladder price, then executable volume
+    std::vector<uint64_t> _asks;     // Ask volume at each ladder price, then surplus
+};
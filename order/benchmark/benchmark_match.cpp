@@ -1,10 +1,16 @@
 #include "../order.h"
 #include "../orderbook.h"
 #include "../matching_engine.h"
+#include "../book_builder.h"
+#include "../trade_analytics.h"
+#include "perf_counters.h"
 #include <iostream>
 #include <chrono>
 #include <vector>
 #include <random>
+#include <algorithm>
+#include <cstring>
+#include <sys/resource.h>
 
 using Clock = std::chrono::high_resolution_clock;
 
@@ -75,16 +81,646 @@ void benchmark_top_of_book(int iterations) {
               << std::endl;
 }
 
-int main() {
+void benchmark_depth(int iterations, size_t levels) {
+    DepthLevel bids[OrderBook::MAX_LEVELS], asks[OrderBook::MAX_LEVELS];
+    size_t copied = 0;
+
+    uint64_t start_time = now();
+    for (int i = 0; i < iterations; ++i) {
+        auto [num_bids, num_asks] = engine.order_book().get_depth(levels, bids, asks);
+        copied += num_bids + num_asks;
+    }
+    uint64_t end_time = now();
+
+    std::cout << "[Depth] Levels: " << levels
+              << ", Calls: " << iterations
+              << ", Total time: " << end_time - start_time << " ns"
+              << ", Avg latency: " << (end_time - start_time) / iterations << " ns"
+              << ", Levels copied: " << copied
+              << std::endl;
+}
+
+void benchmark_mass_cancel(int iterations) {
+    MatchingEngine book_engine;
+    uint64_t total_ns = 0;
+    size_t canceled = 0;
+    uint32_t id = 0;
+
+    for (int i = 0; i < iterations; ++i) {
+        // Fill every slot with resting orders of 4 sessions
+        for (size_t tier_idx = 0; tier_idx < OrderBook::MAX_TIERS; ++tier_idx) {
+            int32_t base = static_cast<int32_t>(tier_idx) * OrderBook::TIER_GRANULARITY;
+            for (size_t slot = 0; slot < OrderBook::SLOTS_PER_SIDE; ++slot) {
+                book_engine.order_book().insert(Order{id, id, base, 1, Side::BID, id % 4}); ++id;
+                book_engine.order_book().insert(Order{id, id, base + 1, 1, Side::ASK, id % 4}); ++id;
+            }
+        }
+
+        uint64_t start_time = now();
+        for (uint32_t owner = 0; owner < 4; ++owner) {
+            canceled += book_engine.mass_cancel(owner, Side::BID, 0, INT32_MAX);
+            canceled += book_engine.mass_cancel(owner, Side::ASK, 0, INT32_MAX);
+        }
+        total_ns += now() - start_time;
+    }
+
+    std::cout << "[MassCancel] Orders: " << canceled
+              << ", Total time: " << total_ns << " ns"
+              << ", Avg latency per order: " << total_ns / canceled << " ns"
+              << std::endl;
+}
+
+// Sorted tiers move work from match to insert: insert shifts lanes to keep price-time
+// priority, so a taker only consumes a prefix. Time both sides of that tradeoff.
+void benchmark_insert_vs_match(int rounds) {
+    MatchingEngine book_engine;
+    std::mt19937 rng(7);
+    uint64_t insert_ns = 0, match_ns = 0;
+    size_t inserts = 0, matches = 0;
+    uint32_t id = 0;
+
+    for (int r = 0; r < rounds; ++r) {
+        // Rest asks at random prices in every tier, in random time order
+        uint64_t start_time = now();
+        for (size_t tier_idx = 0; tier_idx < OrderBook::MAX_TIERS; ++tier_idx) {
+            int32_t base = static_cast<int32_t>(tier_idx) * OrderBook::TIER_GRANULARITY;
+            for (size_t slot = 0; slot < OrderBook::SLOTS_PER_SIDE; ++slot) {
+                int32_t price = base + static_cast<int32_t>(rng() % OrderBook::TIER_GRANULARITY);
+                inserts += book_engine.order_book().insert(Order{id, rng() % 1000, price, 1, Side::ASK});
+                ++id;
+            }
+        }
+        insert_ns += now() - start_time;
+
+        // Each taker consumes exactly the best ask
+        size_t resting = OrderBook::MAX_TIERS * OrderBook::SLOTS_PER_SIDE;
+        start_time = now();
+        for (size_t i = 0; i < resting; ++i) {
+            matches += book_engine.match(Order{id, id, INT32_MAX, 1, Side::BID});
+            ++id;
+        }
+        match_ns += now() - start_time;
+    }
+
+    std::cout << "[Insert] Orders: " << inserts
+              << ", Total time: " << insert_ns << " ns"
+              << ", Avg latency: " << insert_ns / inserts << " ns"
+              << std::endl;
+    std::cout << "[MatchPrefix] Orders: " << matches
+              << ", Total time: " << match_ns << " ns"
+              << ", Avg latency: " << match_ns / matches << " ns"
+              << std::endl;
+}
+
+uint64_t minor_faults() {
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_minflt;
+}
+
+// Per-order latency percentiles of a match/cancel churn on a fresh book, with the page faults taken
+// to build the book (warm-up) and while it trades. Book memory is pre-faulted, so the trading run
+// should take none.
+void benchmark_tail_latency(int num_orders) {
+    std::vector<uint64_t> samples(num_orders);
+    std::vector<uint32_t> resting(num_orders);  // Touched up front, so its pages don't count
+    size_t resting_count = 0;
+    std::mt19937 rng(3);
+
+    uint64_t faults = minor_faults();
+    MatchingEngine book_engine;
+    uint64_t warmup_faults = minor_faults() - faults;
+
+    faults = minor_faults();
+    for (int i = 0; i < num_orders; ++i) {
+        Order order{
+            .id = static_cast<uint32_t>(i),
+            .timestamp = static_cast<uint32_t>(i),
+            .price = static_cast<int32_t>(1000 + rng() % 80),
+            .volume = static_cast<uint32_t>(1 + rng() % 10),
+            .side = rng() % 2 ? Side::BID : Side::ASK
+        };
+        bool cancel = resting_count > 0 && rng() % 3 == 0;
+        size_t k = cancel ? rng() % resting_count : 0;
+
+        uint64_t start_time = now();
+        if (cancel) {
+            book_engine.cancel_order(resting[k]);
+        } else {
+            book_engine.match(order);
+        }
+        samples[i] = now() - start_time;
+
+        if (cancel) {
+            resting[k] = resting[--resting_count];
+        } else {
+            resting[resting_count++] = order.id;
+        }
+    }
+    uint64_t run_faults = minor_faults() - faults;
+
+    std::sort(samples.begin(), samples.end());
+    auto pct = [&](double p) { return samples[static_cast<size_t>(p * (num_orders - 1))]; };
+    std::cout << "[TailLatency] Ops: " << num_orders
+              << ", p50: " << pct(0.5) << " ns"
+              << ", p99: " << pct(0.99) << " ns"
+              << ", p99.9: " << pct(0.999) << " ns"
+              << ", max: " << samples.back() << " ns"
+              << ", Warm-up faults: " << warmup_faults
+              << ", Run faults: " << run_faults
+              << std::endl;
+}
+
+// Same order flow three ways: no reporting, a synchronous callback doing downstream work
+// (a drop copy into a vector), and publishing to the report ring for consumers on other cores.
+void benchmark_report_ring(int num_orders) {
+    auto run = [num_orders](MatchingEngine& book_engine) {
+        std::mt19937 rng(42);
+        uint64_t start_time = now();
+        for (int i = 0; i < num_orders; ++i) {
+            book_engine.match(Order{
+                static_cast<uint32_t>(i), static_cast<uint32_t>(i),
+                static_cast<int32_t>(1000 + rng() % 40), static_cast<uint32_t>(1 + rng() % 10),
+                i % 2 ? Side::ASK : Side::BID
+            });
+        }
+        return (now() - start_time) / num_orders;
+    };
+
+    MatchingEngine plain;
+    uint64_t plain_ns = run(plain);
+
+    std::vector<FillReport> drop_copy;
+    MatchingEngine callback;
+    callback.on_fill = [&drop_copy](const FillReport& f) { drop_copy.push_back(f); };
+    uint64_t callback_ns = run(callback);
+
+    Arena arena(sizeof(ExecutionReport) << 16);
+    ReportRing ring(arena, 1 << 16);
+    MatchingEngine published;
+    published.set_report_ring(&ring);
+    uint64_t ring_ns = run(published);
+
+    std::cout << "[ReportRing] Orders: " << num_orders
+              << ", Avg match latency: no reports " << plain_ns << " ns"
+              << ", callback " << callback_ns << " ns"
+              << ", ring " << ring_ns << " ns"
+              << ", Reports published: " << ring.head()
+              << std::endl;
+}
+
+// Full depth third party feed over many instruments applied on one core: adds, partial executions,
+// partial cancels and deletes of resting orders, spread uniformly over the instruments.
+// The stream is generated against a second builder so that every message applies.
+void benchmark_replication(int num_orders) {
+    auto run = [num_orders](MatchingEngine& book_engine) {
+        std::mt19937 rng(42);
+        uint64_t start_time = now();
+        for (int i = 0; i < num_orders; ++i) {
+            book_engine.match(Order{
+                static_cast<uint32_t>(i), static_cast<uint32_t>(i),
+                static_cast<int32_t>(1000 + rng() % 40), static_cast<uint32_t>(1 + rng() % 10),
+                i % 2 ? Side::ASK : Side::BID
+            });
+        }
+        return (now() - start_time) / num_orders;
+    };
+
+    MatchingEngine plain;
+    uint64_t plain_ns = run(plain);
+
+    // Large enough for the whole run: the standby replays it afterwards without being lapped
+    ReplicationLog log;
+    if (!log.create("/hft_benchmark_replication", 1 << 20)) {
+        return;
+    }
+    MatchingEngine primary;
+    primary.set_replication(&log);
+    uint64_t replicated_ns = run(primary);
+
+    ReplicationLog standby_log;
+    standby_log.open("/hft_benchmark_replication");
+    MatchingEngine standby;
+    StandbyReplica replica(standby_log, standby);
+    uint64_t start_time = now();
+    replica.poll();
+    uint64_t replay_ns = (now() - start_time) / replica.applied();
+
+    std::cout << "[Replication] Orders: " << num_orders
+              << ", Avg match latency: plain " << plain_ns << " ns"
+              << ", replicated " << replicated_ns << " ns"
+              << ", Events: " << log.head()
+              << ", Standby replay: " << replay_ns << " ns/event"
+              << ", Hash checks: " << replica.hash_checks()
+              << ", In sync: " << (replica.in_sync() ? "yes" : "no")
+              << std::endl;
+}
+
+// One message of a synthetic order by order feed.
+struct FeedEvent {
+    char type;
+    uint16_t instrument;
+    uint32_t order_id;
+    int32_t price;
+    uint32_t volume;
+    Side side;
+};
+
+// Valid add, execute, partial cancel and delete messages over instruments, as a feed would send them.
+std::vector<FeedEvent> feed_events(size_t instruments, int num_messages) {
+    std::vector<FeedEvent> events;
+    events.reserve(num_messages);
+    BookBuilder model(instruments);
+    std::vector<std::vector<std::pair<uint32_t, uint32_t>>> live(instruments);  // (order id, volume)
+    std::mt19937 rng(17);
+    uint32_t next_id = 1;
+    while (events.size() < static_cast<size_t>(num_messages)) {
+        uint16_t instrument = static_cast<uint16_t>(rng() % instruments);
+        auto& orders = live[instrument];
+        uint32_t action = rng() % 10;
+        if (action < 5 || orders.empty()) {
+            Side side = rng() % 2 ? Side::ASK : Side::BID;
+            FeedEvent e{'A', instrument, next_id++, static_cast<int32_t>(side == Side::BID ? 1 + rng() % 40 : 40 + rng() % 40),
+                          static_cast<uint32_t>(1 + rng() % 100), side};
+            if (model.add(instrument, Order{e.order_id, 0, e.price, e.volume, e.side})) {
+                orders.push_back({e.order_id, e.volume});
+                events.push_back(e);
+            }
+            continue;
+        }
+        size_t k = rng() % orders.size();
+        auto [order_id, volume] = orders[k];
+        char type = action < 7 ? 'E' : action < 8 ? 'X' : 'D';
+        uint32_t traded = type == 'D' ? volume : 1 + rng() % volume;
+        if (type == 'D') {
+            model.remove(instrument, order_id);
+        } else {
+            model.execute(instrument, order_id, traded);
+        }
+        events.push_back({type, instrument, order_id, 0, traded, Side::BID});
+        if (traded == volume) {
+            orders[k] = orders.back();
+            orders.pop_back();
+        } else {
+            orders[k].second -= traded;
+        }
+    }
+    return events;
+}
+
+// Apply one feed message to builder, return false if it was rejected.
+bool apply_feed_event(BookBuilder& builder, const FeedEvent& e) {
+    switch (e.type) {
+        case 'A': return builder.add(e.instrument, Order{e.order_id, 0, e.price, e.volume, e.side});
+        case 'E': return builder.execute(e.instrument, e.order_id, e.volume);
+        case 'X': return builder.cancel(e.instrument, e.order_id, e.volume);
+        default:  return builder.remove(e.instrument, e.order_id);
+    }
+}
+
+void benchmark_book_builder(size_t instruments, int num_messages) {
+    std::vector<FeedEvent> events = feed_events(instruments, num_messages);
+
+    BookBuilder builder(instruments);
+    size_t rejected = 0;
+    uint64_t start_time = now();
+    for (const FeedEvent& e : events) {
+        rejected += !apply_feed_event(builder, e);
+    }
+    uint64_t total_time = now() - start_time;
+
+    // Top of book of every instrument in turn, as published after each packet
+    size_t queries = std::max<size_t>(instruments, 100000);
+    int64_t checksum = 0;
+    uint64_t top_start = now();
+    for (size_t i = 0; i < queries; ++i) {
+        auto [bid, ask] = builder.top_of_book(static_cast<uint16_t>(i % instruments));
+        checksum += bid + ask;
+    }
+    uint64_t top_time = now() - top_start;
+
+    std::cout << "[BookBuilder] Instruments: " << instruments
+              << ", Messages: " << num_messages
+              << ", Rejected: " << rejected
+              << ", Avg latency: " << total_time / num_messages << " ns"
+              << ", Throughput: " << num_messages * 1e9 / total_time << " msgs/sec"
+              << ", Top of book: " << top_time / queries << " ns"
+              << ", Book memory: " << (BookBuilder::arena_bytes(instruments) >> 20) << " MB"
+              << " (checksum " << checksum << ")"
+              << std::endl;
+}
+
+void benchmark_auction(int num_orders) {
+    using Tier = OrderBook::Tier;
+
+    // Half the orders on each side, Tier::LANES per tier. The ask tiers start half way up the
+    // bid tiers, so half of each side is crossed.
+    size_t tiers = std::min<size_t>(num_orders / 2 / Tier::LANES, (OrderBook::MAX_TIERS - 1) * 2 / 3);
+    size_t first_bid_tier = 1, first_ask_tier = 1 + tiers / 2;
+
+    MatchingEngine local;
+    uint64_t fills = 0;
+    local.on_fill = [&fills](const FillReport&) { fills++; };
+
+    // Best price first on each side, so every new order opens the best level
+    std::mt19937 rng(40);
+    std::vector<Order> orders;
+    for (size_t t = 0; t < tiers; ++t) {
+        for (size_t lane = 0; lane < Tier::LANES; ++lane) {
+            orders.push_back({0, 0, static_cast<int32_t>((first_bid_tier + t) * OrderBook::TIER_GRANULARITY + lane % OrderBook::TIER_GRANULARITY),
+                              static_cast<uint32_t>(1 + rng() % 100), Side::BID});
+        }
+    }
+    for (size_t t = tiers; t-- > 0; ) {
+        for (size_t lane = Tier::LANES; lane-- > 0; ) {
+            orders.push_back({0, 0, static_cast<int32_t>((first_ask_tier + t) * OrderBook::TIER_GRANULARITY + lane % OrderBook::TIER_GRANULARITY),
+                              static_cast<uint32_t>(1 + rng() % 100), Side::ASK});
+        }
+    }
+    std::sort(orders.begin(), orders.begin() + orders.size() / 2,
+              [](const Order& a, const Order& b) { return a.price < b.price; });
+    std::sort(orders.begin() + orders.size() / 2, orders.end(),
+              [](const Order& a, const Order& b) { return a.price > b.price; });
+    for (size_t i = 0; i < orders.size(); ++i) {
+        orders[i].id = static_cast<uint32_t>(i + 1);
+        orders[i].timestamp = i;
+    }
+
+    local.set_auction(true);
+    size_t rejected = 0;
+    uint64_t insert_start = now();
+    for (const Order& order : orders) {
+        rejected += !local.match(order);
+    }
+    uint64_t insert_time = now() - insert_start;
+
+    // Equilibrium search alone, the uncross below repeats it. Warm the curves' buffers first.
+    AuctionCurves curves;
+    curves.equilibrium(local.order_book().get_levels(), 0);
+    uint64_t search_start = now();
+    AuctionResult searched = curves.equilibrium(local.order_book().get_levels(), 0);
+    uint64_t search_time = now() - search_start;
+
+    uint64_t uncross_start = now();
+    AuctionResult result = local.uncross();
+    uint64_t uncross_time = now() - uncross_start;
+
+    std::cout << "[Auction] Orders: " << orders.size() - rejected
+              << ", Rejected: " << rejected
+              << ", Avg insert: " << insert_time / std::max<size_t>(orders.size(), 1) << " ns"
+              << ", Price: " << result.price
+              << ", Volume: " << result.volume
+              << ", Fills: " << fills
+              << ", Equilibrium search: " << search_time / 1000 << " us"
+              << ", Uncross: " << uncross_time / 1000 << " us"
+              << (searched.price == result.price ? "" : " (search mismatch)")
+              << std::endl;
+}
+
+void benchmark_expiry(int iterations) {
+    MatchingEngine book_engine;
+    OrderBook& book = book_engine.order_book();
+    const uint64_t tick = uint64_t(1) << ExpiryWheel::TICK_SHIFT;
+    uint64_t clock = 0;
+    uint64_t insert_ns[2] = {0, 0};
+    uint64_t idle_ns = 0, expire_ns = 0;
+    size_t inserted[2] = {0, 0}, idle_calls = 0, expired = 0;
+    uint32_t id = 0;
+
+    // Fill every slot, good till cancelled then good till time, all due within the same 64 ticks
+    auto fill = [&](bool timed) {
+        uint64_t start_time = now();
+        for (size_t tier_idx = 0; tier_idx < OrderBook::MAX_TIERS; ++tier_idx) {
+            int32_t base = static_cast<int32_t>(tier_idx) * OrderBook::TIER_GRANULARITY;
+            for (size_t slot = 0; slot < OrderBook::SLOTS_PER_SIDE; ++slot) {
+                uint64_t expiry = timed ? clock + (1000 + id % 64) * tick : 0;
+                book.insert(Order{id, id, base, 1, Side::BID, 0, expiry}); ++id;
+                book.insert(Order{id, id, base + 1, 1, Side::ASK, 0, expiry}); ++id;
+            }
+        }
+        insert_ns[timed] += now() - start_time;
+        inserted[timed] += OrderBook::MAX_ORDERS;
+    };
+
+    for (int i = 0; i < iterations; ++i) {
+        fill(false);
+        book_engine.mass_cancel(0, Side::BID, 0, INT32_MAX);
+        book_engine.mass_cancel(0, Side::ASK, 0, INT32_MAX);
+        fill(true);
+
+        // The clock ticks along with nothing due
+        uint64_t start_time = now();
+        for (int step = 0; step < 100; ++step) {
+            clock += tick;
+            book_engine.advance_clock(clock);
+        }
+        idle_ns += now() - start_time;
+        idle_calls += 100;
+
+        // Everything falls due in one advance
+        clock += 1100 * tick;
+        start_time = now();
+        expired += book_engine.advance_clock(clock);
+        expire_ns += now() - start_time;
+    }
+
+    std::cout << "[Expiry] Insert GTC: " << insert_ns[0] / inserted[0] << " ns"
+              << ", Insert GTT: " << insert_ns[1] / inserted[1] << " ns"
+              << ", Idle advance: " << idle_ns / idle_calls << " ns"
+              << ", Expired: " << expired
+              << ", Avg latency per expired order: " << expire_ns / expired << " ns"
+              << std::endl;
+}
+
+void benchmark_analytics(size_t instruments, int num_fills) {
+    AnalyticsConfig config;
+    config.intervals[0] = 100000;  // Clock: one unit per fill, 1s, 10s and 1min bars at 100K fills/s
+    config.intervals[1] = 1000000;
+    config.intervals[2] = 6000000;
+    config.vwap_window = 60;
+    TradeAnalytics analytics(instruments, config);
+
+    std::mt19937 rng(23);
+    std::vector<FillReport> fills(num_fills);
+    std::vector<uint32_t> targets(num_fills);
+    for (int i = 0; i < num_fills; ++i) {
+        targets[i] = static_cast<uint32_t>(rng() % instruments);
+        fills[i] = FillReport{static_cast<uint32_t>(i), static_cast<uint32_t>(i),
+                              static_cast<int32_t>(1000 + rng() % 100), static_cast<uint32_t>(1 + rng() % 10)};
+    }
+
+    uint64_t start_time = now();
+    for (int i = 0; i < num_fills; ++i) {
+        analytics.on_fill(targets[i], static_cast<uint64_t>(i), fills[i]);
+    }
+    uint64_t fill_time = now() - start_time;
+
+    // Bar boundaries alone: every instrument's bars, window and volatility
+    constexpr int BOUNDARIES = 1000;
+    start_time = now();
+    for (int b = 1; b <= BOUNDARIES; ++b) {
+        analytics.advance(static_cast<uint64_t>(num_fills) + b * config.intervals[0]);
+    }
+    uint64_t roll_time = (now() - start_time) / BOUNDARIES;
+
+    size_t queries = 1000000;
+    AnalyticsSnapshot snapshot;
+    int64_t checksum = 0;
+    start_time = now();
+    for (size_t i = 0; i < queries; ++i) {
+        analytics.snapshot(static_cast<uint32_t>(i % instruments), snapshot);
+        checksum += snapshot.last_price;
+    }
+    uint64_t snapshot_time = now() - start_time;
+
+    std::cout << "[Analytics] Instruments: " << instruments
+              << ", Fills: " << num_fills
+              << ", Avg update: " << fill_time / num_fills << " ns"
+              << ", Bar close: " << roll_time << " ns (" << roll_time / instruments << " ns/instrument)"
+              << ", Snapshot: " << snapshot_time / queries << " ns"
+              << " (checksum " << checksum << ")"
+              << std::endl;
+}
+
+void benchmark_counters(int rounds) {
+    PerfCounters counters;
+    if (!counters.available()) {
+        std::cout << "[Counters] Hardware counters unavailable: " << counters.reason() << ", latency only" << std::endl;
+    }
+
+    PerfRegion insert("Insert"), cancel("Cancel"), match("Match"), match_replicated("Match replicated");
+    PerfRegion top_scan("TopOfBook tier scan"), top_levels("TopOfBook price levels"), feed("FeedDecode");
+
+    // Round r: a book of every tier full of asks at random prices, then as many takers each
+    // consuming the best ask. The same for both variants of an A/B pair.
+    const size_t resting = OrderBook::MAX_TIERS * OrderBook::SLOTS_PER_SIDE;
+    std::vector<Order> asks(resting), takers(resting);
+    auto make_round = [&](int round) {
+        std::mt19937 rng(round);
+        for (size_t i = 0; i < resting; ++i) {
+            int32_t base = static_cast<int32_t>(i / OrderBook::SLOTS_PER_SIDE) * OrderBook::TIER_GRANULARITY;
+            uint32_t id = static_cast<uint32_t>(i);
+            asks[i] = Order{id, rng() % 1000, base + static_cast<int32_t>(rng() % OrderBook::TIER_GRANULARITY), 1, Side::ASK};
+            takers[i] = Order{id + static_cast<uint32_t>(resting), id, INT32_MAX, 1, Side::BID};
+        }
+    };
+    auto rest = [&](MatchingEngine& book_engine) {
+        for (const Order& order : asks) {
+            book_engine.order_book().insert(order);
+        }
+    };
+    auto take = [&](MatchingEngine& book_engine) {
+        for (const Order& order : takers) {
+            book_engine.match(order);
+        }
+    };
+
+    ReplicationLog log;
+    if (!log.create("/hft_benchmark_counters")) {
+        return;
+    }
+    MatchingEngine plain, replicated;
+    replicated.set_replication(&log);
+
+    for (int round = 0; round < rounds; ++round) {
+        make_round(round);
+        insert.measure(counters, resting, [&]() { rest(plain); });
+        cancel.measure(counters, resting, [&]() {
+            for (const Order& order : asks) {
+                plain.cancel_order(order.id);
+            }
+        });
+    }
+
+    // Kernel A/B: top of book from the tiers vs from the best price levels
+    constexpr size_t QUERIES = 1000;
+    int64_t checksum = 0;
+    make_round(0);
+    rest(plain);
+    const OrderBook& book = plain.order_book();
+    run_ab(rounds, [&](int) {
+        top_scan.measure(counters, QUERIES, [&]() {
+            for (size_t q = 0; q < QUERIES; ++q) {
+                asm volatile("" ::: "memory");  // A fresh query each time, as after a book update
+                auto [bid, ask] = book.get_top_of_book();
+                checksum += bid + ask;
+            }
+        });
+    }, [&](int) {
+        top_levels.measure(counters, QUERIES, [&]() {
+            const OrderBook::PriceLevels& levels = book.get_levels();
+            for (size_t q = 0; q < QUERIES; ++q) {
+                asm volatile("" ::: "memory");
+                checksum += levels.bids.size ? levels.bids.prices[levels.bids.size - 1] : 0;
+                checksum += levels.asks.size ? levels.asks.prices[levels.asks.size - 1] : 0;
+            }
+        });
+    });
+    take(plain);
+
+    // Engine A/B: the same inputs, with every one published to the replication log first
+    run_ab(rounds, [&](int round) {
+        make_round(round);
+        rest(plain);
+        match.measure(counters, resting, [&]() { take(plain); });
+    }, [&](int round) {
+        make_round(round);
+        rest(replicated);
+        match_replicated.measure(counters, resting, [&]() { take(replicated); });
+    });
+
+    // Feed decode: order by order messages of 4096 instruments applied to their books
+    std::vector<FeedEvent> events = feed_events(4096, 1000000);
+    BookBuilder builder(4096);
+    size_t rejected = 0;
+    feed.measure(counters, events.size(), [&]() {
+        for (const FeedEvent& e : events) {
+            rejected += !apply_feed_event(builder, e);
+        }
+    });
+
+    for (const PerfRegion* region : {&insert, &cancel, &match, &match_replicated, &top_scan, &top_levels, &feed}) {
+        region->report();
+    }
+    report_ab(top_scan, top_levels);
+    report_ab(match, match_replicated);
+    std::cout << "[Counters] Rounds: " << rounds << ", Feed rejected: " << rejected
+              << " (checksum " << checksum << ")" << std::endl;
+}
+
+int main(int argc, char** argv) {
     // engine.on_fill = [](const FillReport& f) {};
     // engine.on_ack  = [](const AckReport& a) {};
     // engine.on_cancel = [](const CancelReport& c) {};
 
     constexpr int NUM_ORDERS = 100000;
 
+    // Benchmarks named on the command line only, all of them by default
+    auto selected = [argc, argv](const char* name) {
+        return argc < 2 || std::find_if(argv + 1, argv + argc, [name](const char* arg) { return strcmp(arg, name) == 0; }) != argv + argc;
+    };
+
     std::cout << "====== PERFORMANCE BENCHMARK ======\n";
-    benchmark_matching(NUM_ORDERS);     // Matching performance
-    benchmark_top_of_book(100000);      // Top-of-book query performance
-    benchmark_cancel(NUM_ORDERS);       // Cancel performance
+    if (selected("tail")) benchmark_tail_latency(1000000);        // First, while the heap is cold: percentiles and page faults of a fresh book
+    if (selected("matching")) benchmark_matching(NUM_ORDERS);     // Matching performance
+    if (selected("top")) benchmark_top_of_book(100000);           // Top-of-book query performance
+    if (selected("depth")) benchmark_depth(100000, 10);           // Depth-of-book query performance
+    if (selected("cancel")) benchmark_cancel(NUM_ORDERS);         // Cancel performance
+    if (selected("mass_cancel")) benchmark_mass_cancel(1000);     // Session mass cancel performance
+    if (selected("insert")) benchmark_insert_vs_match(1000);      // Sorted insert vs prefix match latency
+    if (selected("reports")) benchmark_report_ring(NUM_ORDERS);   // Execution report publishing cost
+    if (selected("builder")) {
+        benchmark_book_builder(1, 10 * NUM_ORDERS);     // Passive book building, one hot book
+        benchmark_book_builder(4096, 10 * NUM_ORDERS);  // Passive book building, full feed on one core
+    }
+    if (selected("auction")) benchmark_auction(10 * NUM_ORDERS);  // Call auction uncross, up to the book's capacity
+    if (selected("expiry")) benchmark_expiry(1000);               // Timing wheel: GTT insert, idle clock, batch expiry
+    if (selected("replication")) benchmark_replication(NUM_ORDERS); // Hot standby: cost of publishing inputs, standby replay
+    if (selected("analytics")) {
+        benchmark_analytics(1, 10 * NUM_ORDERS);     // Streaming bars, VWAP, volatility: one hot instrument
+        benchmark_analytics(4096, 10 * NUM_ORDERS);  // Across a full feed's instruments
+    }
+    if (selected("counters")) benchmark_counters(1000);           // Hardware counters per operation, A/B kernel variants
+    std::cout << "[PageFaults] Process minor faults: " << minor_faults() << std::endl;
     return 0;
 }
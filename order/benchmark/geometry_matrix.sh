@@ -0,0 +1,29 @@
+#!/bin/bash
+# Build and run benchmark_match once per book geometry, so the geometry of each
+# instrument class can be picked at compile time (see ORDERBOOK_* macros in orderbook.h).
+#
+# Usage: ./geometry_matrix.sh [extra g++ flags]
+set -e
+cd "$(dirname "$0")"
+
+SOURCES="benchmark_match.cpp ../matching_engine.cpp ../orderbook.cpp ../match_tier_avx512.cpp ../auction_avx512.cpp ../arena.cpp ../book_builder.cpp ../replication.cpp ../trade_analytics.cpp"
+BIN=$(mktemp)
+trap 'rm -f "$BIN"' EXIT
+
+# Tiers x granularity: default narrow book, and a ladder wide enough to spread the
+# benchmark's 1000..2000 prices over separate tiers.
+for lanes in 8 16; do
+    for layout in SPLIT GROUPED; do
+        for ladder in "10 8" "256 8"; do
+            read -r tiers granularity <<< "$ladder"
+            echo "=== lanes=$lanes layout=$layout tiers=$tiers granularity=$granularity ==="
+            g++ -O3 -std=c++2a -march=native "$@" \
+                -DORDERBOOK_TIER_LANES=$lanes \
+                -DORDERBOOK_SIDE_LAYOUT=$layout \
+                -DORDERBOOK_MAX_TIERS=$tiers \
+                -DORDERBOOK_TIER_GRANULARITY=$granularity \
+                $SOURCES -o "$BIN"
+            "$BIN"
+        done
+    done
+done
@@ -0,0 +1,260 @@
+#pragma once
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+
+// Hardware performance counters of the calling thread, read around measured regions of a benchmark
+// through perf_event_open. Events are opened in two counter groups, core (cycles, instructions,
+// branch misses) and memory (L1D, LLC and dTLB misses), so each group is scheduled on the PMU as a
+// whole and its ratios are consistent even when the kernel multiplexes the groups. Counts are scaled
+// by enabled over running time. User space only, so the counters' own syscalls aren't counted.
+// Without a PMU (most VMs) or with a restrictive perf_event_paranoid, available() is false and
+// regions report latency only. Events the PMU doesn't support are left out individually.
+class PerfCounters {
+public:
+    enum Event { CYCLES, INSTRUCTIONS, BRANCH_MISSES, L1D_MISSES, LLC_MISSES, DTLB_MISSES, EVENTS };
+
+    // Event counts of a region, summed over its runs. Events never counted stay invalid.
+    struct Counts {
+        double values[EVENTS] = {};
+        bool valid[EVENTS] = {};
+    };
+
+    PerfCounters() {
+        static constexpr uint64_t L1D_READ_MISS = PERF_COUNT_HW_CACHE_L1D
+            | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        static constexpr uint64_t DTLB_READ_MISS = PERF_COUNT_HW_CACHE_DTLB
+            | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        static constexpr struct {
+            uint32_t type;
+            uint64_t config;
+        } events[EVENTS] = {
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+            {PERF_TYPE_HW_CACHE, L1D_READ_MISS},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},  // Last level cache
+            {PERF_TYPE_HW_CACHE, DTLB_READ_MISS},
+        };
+
+        for (int event = 0; event < EVENTS; ++event) {
+            Group& group = _groups[event < L1D_MISSES ? 0 : 1];
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = events[event].type;
+            attr.config = events[event].config;
+            attr.disabled = group.leader < 0;  // Members follow their leader
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_ID
+                             | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+            int fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, group.leader, PERF_FLAG_FD_CLOEXEC));
+            if (fd < 0) {
+                if (event == CYCLES) {
+                    _error = errno;
+                    return;  // No cycles, no PMU to speak of
+                }
+                continue;
+            }
+            if (group.leader < 0) {
+                group.leader = fd;
+            }
+            _fds[event] = fd;
+            ioctl(fd, PERF_EVENT_IOC_ID, &_ids[event]);
+        }
+    }
+
+    ~PerfCounters() {
+        for (int fd : _fds) {
+            if (fd >= 0) {
+                close(fd);
+            }
+        }
+    }
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    bool available() const { return _groups[0].leader >= 0; }
+
+    // Why the counters are unavailable.
+    const char* reason() const {
+        switch (_error) {
+            case EACCES:
+            case EPERM:      return "not permitted, lower /proc/sys/kernel/perf_event_paranoid";
+            case ENOENT:
+            case ENODEV:
+            case EOPNOTSUPP: return "no hardware PMU (virtual machine?)";
+            case ENOSYS:     return "kernel without perf_event_open";
+            default:         return std::strerror(_error);
+        }
+    }
+
+    // Count from zero.
+    void start() {
+        for (const Group& group : _groups) {
+            if (group.leader >= 0) {
+                ioctl(group.leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+                ioctl(group.leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+            }
+        }
+    }
+
+    // Stop counting and add the counts since start to counts.
+    void stop(Counts& counts) {
+        for (const Group& group : _groups) {
+            if (group.leader >= 0) {
+                ioctl(group.leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+            }
+        }
+        for (const Group& group : _groups) {
+            if (group.leader < 0) {
+                continue;
+            }
+            // { nr, time enabled, time running, { value, id } * nr }
+            uint64_t data[3 + 2 * EVENTS];
+            if (read(group.leader, data, sizeof(data)) < static_cast<ssize_t>(3 * sizeof(uint64_t))) {
+                continue;
+            }
+            uint64_t enabled = data[1], running = data[2];
+            if (running == 0) {
+                continue;  // Never scheduled: the PMU had no room for the group
+            }
+            double scale = static_cast<double>(enabled) / running;
+            for (uint64_t i = 0; i < data[0] && i < EVENTS; ++i) {
+                for (int event = 0; event < EVENTS; ++event) {
+                    if (_fds[event] >= 0 && _ids[event] == data[4 + 2 * i]) {
+                        counts.values[event] += data[3 + 2 * i] * scale;
+                        counts.valid[event] = true;
+                    }
+                }
+            }
+        }
+    }
+
+private:
+    struct Group {
+        int leader = -1;
+    };
+
+    Group _groups[2];
+    int _fds[EVENTS] = {-1, -1, -1, -1, -1, -1};
+    uint64_t _ids[EVENTS] = {};
+    int _error = 0;
+};
+
+// Latency and hardware counters of one benchmark operation, accumulated over every run of it.
+class PerfRegion {
+public:
+    explicit PerfRegion(const char* name) : _name(name) {}
+
+    // Run body, which performs ops operations, inside the counters. Setup belongs outside body.
+    template <typename Body>
+    void measure(PerfCounters& counters, size_t ops, Body&& body) {
+        counters.start();
+        auto start_time = std::chrono::steady_clock::now();
+        body();
+        auto end_time = std::chrono::steady_clock::now();
+        counters.stop(_counts);
+        _ns += std::chrono::duration_cast<std::chrono::nanoseconds>(end_time - start_time).count();
+        _ops += ops;
+    }
+
+    const char* name() const { return _name; }
+
+    double ns_per_op() const { return _ops ? static_cast<double>(_ns) / _ops : 0; }
+
+    // Per operation count of event, negative if it wasn't counted.
+    double per_op(PerfCounters::Event event) const {
+        return _ops && _counts.valid[event] ? _counts.values[event] / _ops : -1;
+    }
+
+    // Instructions per cycle, negative if either wasn't counted.
+    double ipc() const {
+        double cycles = per_op(PerfCounters::CYCLES), instructions = per_op(PerfCounters::INSTRUCTIONS);
+        return cycles > 0 && instructions >= 0 ? instructions / cycles : -1;
+    }
+
+    // [Counters] Name: ops, latency and per operation counts, n/a for those not counted.
+    void report() const {
+        std::ostringstream line;
+        line << std::fixed << std::setprecision(2)
+             << "[Counters] " << _name << ": Ops: " << _ops << ", Avg latency: " << ns_per_op() << " ns";
+        if (std::find(std::begin(_counts.valid), std::end(_counts.valid), true) == std::end(_counts.valid)) {
+            std::cout << line.str() << std::endl;  // Latency only
+            return;
+        }
+        print(line, ", Cycles/op: ", per_op(PerfCounters::CYCLES));
+        print(line, ", IPC: ", ipc());
+        print(line, ", Branch misses/op: ", per_op(PerfCounters::BRANCH_MISSES));
+        print(line, ", L1D misses/op: ", per_op(PerfCounters::L1D_MISSES));
+        print(line, ", LLC misses/op: ", per_op(PerfCounters::LLC_MISSES));
+        print(line, ", dTLB misses/op: ", per_op(PerfCounters::DTLB_MISSES));
+        std::cout << line.str() << std::endl;
+    }
+
+private:
+    static void print(std::ostream& out, const char* label, double value) {
+        out << label;
+        if (value < 0) {
+            out << "n/a";
+        } else {
+            out << value;
+        }
+    }
+
+    const char* _name;
+    uint64_t _ns = 0;
+    uint64_t _ops = 0;
+    PerfCounters::Counts _counts;
+};
+
+// A/B run of two variants of a kernel in one process: rounds alternate which one goes first, so
+// drift (frequency, cache and page state) lands on both. run_a(round) and run_b(round) each call
+// measure on their own region.
+template <typename RunA, typename RunB>
+void run_ab(int rounds, RunA&& run_a, RunB&& run_b) {
+    for (int round = 0; round < rounds; ++round) {
+        if (round % 2 == 0) {
+            run_a(round);
+            run_b(round);
+        } else {
+            run_b(round);
+            run_a(round);
+        }
+    }
+}
+
+// [Counters] A/B line: B relative to A, per measure both have.
+inline void report_ab(const PerfRegion& a, const PerfRegion& b) {
+    std::ostringstream line;
+    line << std::fixed << std::setprecision(1) << std::showpos;
+    auto delta = [&line](const char* label, double x, double y) {
+        if (x > 0 && y >= 0) {
+            line << ", " << label << ": " << 100.0 * (y - x) / x << "%";
+        } else if (x >= 0 && y >= 0) {
+            line << ", " << label << ": " << y - x;
+        }
+    };
+    line << "[Counters] A/B " << b.name() << " vs " << a.name();
+    delta("Latency", a.ns_per_op(), b.ns_per_op());
+    delta("Cycles", a.per_op(PerfCounters::CYCLES), b.per_op(PerfCounters::CYCLES));
+    delta("IPC", a.ipc(), b.ipc());
+    delta("Branch misses", a.per_op(PerfCounters::BRANCH_MISSES), b.per_op(PerfCounters::BRANCH_MISSES));
+    delta("L1D misses", a.per_op(PerfCounters::L1D_MISSES), b.per_op(PerfCounters::L1D_MISSES));
+    delta("LLC misses", a.per_op(PerfCounters::LLC_MISSES), b.per_op(PerfCounters::LLC_MISSES));
+    delta("dTLB misses", a.per_op(PerfCounters::DTLB_MISSES), b.per_op(PerfCounters::DTLB_MISSES));
+    std::cout << line.str() << std::endl;
+}
@@ -0,0 +1,59 @@
+#include "book_builder.h"
+
+BookBuilder::BookBuilder(size_t instruments, Arena* arena)
+    : _own_arena(arena ? nullptr : std::make_unique<Arena>(arena_bytes(instruments))),
+      _arena(arena ? *arena : *_own_arena),
+      _instruments(instruments),
+      _books(static_cast<OrderBook*>(_arena.allocate(sizeof(OrderBook) * instruments, alignof(OrderBook)))) {
+    // Each book's tiers, levels and index follow in the same arena
+    for (size_t i = 0; i < _instruments; ++i) {
+        new (&_books[i]) OrderBook(&_arena);
+    }
+}
+
+BookBuilder::~BookBuilder() {
+    for (size_t i = 0; i < _instruments; ++i) {
+        _books[i].~OrderBook();
+    }
+}
+
+size_t BookBuilder::arena_bytes(size_t instruments) {
+    return (sizeof(OrderBook) * instruments + 64) + OrderBook::arena_bytes() * instruments;
+}
+
+bool BookBuilder::add(uint16_t instrument, Order order) {
+    OrderBook* book = get(instrument);
+    if (!book) {
+        return false;
+    }
+    order.timestamp = ++_sequence;
+    return book->insert(order);
+}
+
+bool BookBuilder::execute(uint16_t instrument, uint32_t order_id, uint32_t volume) {
+    OrderBook* book = get(instrument);
+    return book && volume > 0 && book->reduce(order_id, volume);
+}
+
+bool BookBuilder::cancel(uint16_t instrument, uint32_t order_id, uint32_t volume) {
+    OrderBook* book = get(instrument);
+    return book && volume > 0 && book->reduce(order_id, volume);
+}
+
+bool BookBuilder::remove(uint16_t instrument, uint32_t order_id) {
+    OrderBook* book = get(instrument);
+    uint32_t volume;
+    return book && book->cancel(order_id, volume);
+}
+
+std::pair<int32_t, int32_t> BookBuilder::top_of_book(uint16_t instrument) const {
+    if (instrument >= _instruments) {
+        return {0, 0};
+    }
+    // Best levels sit at the end of each side
+    const OrderBook::PriceLevels& levels = _books[instrument].get_levels();
+    return {
+        levels.bids.size ? levels.bids.prices[levels.bids.size - 1] : 0,
+        levels.asks.size ? levels.asks.prices[levels.asks.size - 1] : 0
+    };
+}
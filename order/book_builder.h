@@ -0,0 +1,58 @@
+#pragma once
+#include "orderbook.h"
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+// Passive L3 book of another venue's market data, one OrderBook per instrument.
+// The venue has already matched: adds are inserted where they rest, executions, cancels and
+// deletes are applied to the order through the order index, and nothing ever crosses.
+// Queue priority follows feed order.
+class BookBuilder {
+public:
+    // Books of instruments [0, instruments) are carved from arena, which must outlive the builder
+    // and hold arena_bytes(instruments). Without one the builder maps a private arena on the
+    // calling thread's NUMA node.
+    explicit BookBuilder(size_t instruments, Arena* arena = nullptr);
+
+    ~BookBuilder();
+
+    BookBuilder(const BookBuilder&) = delete;
+    BookBuilder& operator=(const BookBuilder&) = delete;
+
+    // Arena bytes needed for instruments books.
+    static size_t arena_bytes(size_t instruments);
+
+    size_t instruments() const { return _instruments; }
+
+    // Add a resting order, order.timestamp is replaced by the feed sequence.
+    // Return false if instrument is unknown, the price is outside the book or its tier is full.
+    bool add(uint16_t instrument, Order order);
+
+    // Take volume executed against order_id away from it, removing it once empty.
+    // Return false if the order isn't resting or has less than volume left.
+    bool execute(uint16_t instrument, uint32_t order_id, uint32_t volume);
+
+    // Partial cancel: take volume away from order_id, removing it once empty.
+    // Return false if the order isn't resting or has less than volume left.
+    bool cancel(uint16_t instrument, uint32_t order_id, uint32_t volume);
+
+    // Remove order_id from the book, return false if it isn't resting.
+    bool remove(uint16_t instrument, uint32_t order_id);
+
+    // Best bid and ask of instrument, 0 for an empty side. Read from the price levels: O(1).
+    std::pair<int32_t, int32_t> top_of_book(uint16_t instrument) const;
+
+    // Book of instrument, for depth and L3 queries. instrument must be < instruments().
+    OrderBook& book(uint16_t instrument) { return _books[instrument]; }
+    const OrderBook& book(uint16_t instrument) const { return _books[instrument]; }
+
+private:
+    OrderBook* get(uint16_t instrument) { return instrument < _instruments ? &_books[instrument] : nullptr; }
+
+    std::unique_ptr<Arena> _own_arena;
+    Arena& _arena;
+    size_t _instruments;
+    OrderBook* _books;      // _instruments books, each on its own tiers, levels and index
+    uint64_t _sequence = 0; // Time priority of adds
+};
@@ -0,0 +1,207 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include "arena.h"
+
+#ifndef ORDERBOOK_EXPIRY_TICK_SHIFT
+#define ORDERBOOK_EXPIRY_TICK_SHIFT 20  // Wheel tick: 2^20 clock units, ~1 ms of ns timestamps
+#endif
+
+// Expiry times of resting orders, in a hierarchical timing wheel.
+// LEVELS wheels of SLOTS slots each: level L holds the timers whose tick first differs from the
+// current tick in level L's bits, so a timer is relinked at most once per level on its way down
+// to level 0, where it fires. Slots are intrusive doubly linked lists of nodes carved from an
+// Arena, so schedule and remove are O(1) and allocate nothing. An occupancy bitmap per level lets
+// advance jump straight to the next tick with work, and a cached bound on that tick makes an
+// advance with nothing due a single compare.
+// Timers fire exactly: at the first advance to a time at or past their expiry.
+class ExpiryWheel {
+public:
+    static constexpr unsigned TICK_SHIFT = ORDERBOOK_EXPIRY_TICK_SHIFT;
+    static constexpr unsigned SLOT_BITS = 6;
+    static constexpr size_t SLOTS = size_t(1) << SLOT_BITS;
+    static constexpr size_t LEVELS = 6;  // 2^36 ticks; further expiries wait in the top level
+
+    ExpiryWheel(Arena& arena, size_t max_timers)
+        : _nodes(arena.create<Node>(max_timers + 1)), _heads(arena.create<uint32_t>(LEVELS * SLOTS)) {
+        // Node 0 is the null link, the others start on the free list
+        for (size_t i = 1; i < max_timers; ++i) {
+            _nodes[i].next = static_cast<uint32_t>(i + 1);
+        }
+        _free = max_timers > 0 ? 1 : 0;
+    }
+
+    // Arena bytes needed for max_timers.
+    static size_t arena_bytes(size_t max_timers) {
+        return (sizeof(Node) * (max_timers + 1) + 64) + (sizeof(uint32_t) * LEVELS * SLOTS + 64);
+    }
+
+    // Schedule order_id to fire at expiry, return its timer (never 0), 0 if every timer is taken.
+    uint32_t schedule(uint32_t order_id, uint64_t expiry) {
+        uint32_t n = _free;
+        if (n == 0) {
+            return 0;
+        }
+        _free = _nodes[n].next;
+        _nodes[n].expiry = expiry;
+        _nodes[n].order_id = order_id;
+        link(n);
+        _size++;
+        return n;
+    }
+
+    // Cancel timer before it fires.
+    void remove(uint32_t timer) {
+        unlink(timer);
+        release(timer);
+    }
+
+    // Advance the wheel clock to now and call on_due(order_id) for every timer with expiry at or
+    // before now. Timers are released before their callback runs.
+    template <typename OnDue>
+    void advance(uint64_t now, OnDue&& on_due) {
+        uint64_t target = now >> TICK_SHIFT;
+        if (target < _next) {
+            _tick = std::max(_tick, target);
+            return;
+        }
+
+        while (true) {
+            fire(now, on_due);
+            if (_tick >= target) {
+                break;
+            }
+
+            uint64_t next = next_event();
+            if (next > target) {
+                _tick = target;  // Nothing is linked in between
+                fire(now, on_due);
+                break;
+            }
+
+            // Entering a slot of a higher level: move its timers down, top level first
+            _tick = next;
+            for (size_t level = LEVELS - 1; level > 0; --level) {
+                if ((_tick & ((uint64_t(1) << (level * SLOT_BITS)) - 1)) == 0) {
+                    relink(level * SLOTS + ((_tick >> (level * SLOT_BITS)) & (SLOTS - 1)));
+                }
+            }
+        }
+        _next = _heads[_tick & (SLOTS - 1)] ? _tick : next_event();
+    }
+
+    // Expiry of a pending timer.
+    uint64_t expiry(uint32_t timer) const { return _nodes[timer].expiry; }
+
+    size_t size() const { return _size; }
+
+private:
+    struct Node {
+        uint64_t expiry = 0;
+        uint32_t order_id = 0;
+        uint32_t prev = 0;
+        uint32_t next = 0;
+        uint32_t slot = 0;  // Level * SLOTS + index
+    };
+
+    // Link n into the slot of its tick relative to the current tick.
+    void link(uint32_t n) {
+        uint64_t tick = std::max(_nodes[n].expiry >> TICK_SHIFT, _tick);
+        tick = std::min(tick, _tick + (uint64_t(1) << (LEVELS * SLOT_BITS - 1)));
+        uint64_t diff = tick ^ _tick;
+        size_t level = diff ? std::min<size_t>((63 - __builtin_clzll(diff)) / SLOT_BITS, LEVELS - 1) : 0;
+        uint32_t slot = static_cast<uint32_t>(level * SLOTS + ((tick >> (level * SLOT_BITS)) & (SLOTS - 1)));
+
+        Node& node = _nodes[n];
+        node.slot = slot;
+        node.prev = 0;
+        node.next = _heads[slot];
+        if (node.next) {
+            _nodes[node.next].prev = n;
+        }
+        _heads[slot] = n;
+        _occupied[level] |= uint64_t(1) << (slot & (SLOTS - 1));
+
+        // The wheel next has work when it fires level 0 slots, or enters higher level ones
+        uint64_t shift = level * SLOT_BITS;
+        _next = std::min(_next, (tick >> shift) << shift);
+    }
+
+    void unlink(uint32_t n) {
+        Node& node = _nodes[n];
+        if (node.prev) {
+            _nodes[node.prev].next = node.next;
+        } else {
+            _heads[node.slot] = node.next;
+            if (!node.next) {
+                _occupied[node.slot / SLOTS] &= ~(uint64_t(1) << (node.slot & (SLOTS - 1)));
+            }
+        }
+        if (node.next) {
+            _nodes[node.next].prev = node.prev;
+        }
+    }
+
+    void release(uint32_t n) {
+        _nodes[n].next = _free;
+        _free = n;
+        _size--;
+    }
+
+    // Detach the list of slot, clearing its occupancy bit.
+    uint32_t take(uint32_t slot) {
+        uint32_t head = _heads[slot];
+        _heads[slot] = 0;
+        _occupied[slot / SLOTS] &= ~(uint64_t(1) << (slot & (SLOTS - 1)));
+        return head;
+    }
+
+    // Fire the due timers of the current level 0 slot, relink the others.
+    template <typename OnDue>
+    void fire(uint64_t now, OnDue& on_due) {
+        for (uint32_t n = take(static_cast<uint32_t>(_tick & (SLOTS - 1))), next; n; n = next) {
+            next = _nodes[n].next;
+            if (_nodes[n].expiry <= now) {
+                uint32_t order_id = _nodes[n].order_id;
+                release(n);
+                on_due(order_id);
+            } else {
+                link(n);
+            }
+        }
+    }
+
+    void relink(uint32_t slot) {
+        for (uint32_t n = take(slot), next; n; n = next) {
+            next = _nodes[n].next;
+            link(n);
+        }
+    }
+
+    // First tick after the current one at which an occupied slot is reached, ~0 if none.
+    uint64_t next_event() const {
+        uint64_t next = ~uint64_t(0);
+        for (size_t level = 0; level < LEVELS; ++level) {
+            if (!_occupied[level]) {
+                continue;
+            }
+            // Rotate the slots after the current index down to bit 0, in wheel order
+            unsigned shift = level * SLOT_BITS;
+            unsigned current = (_tick >> shift) & (SLOTS - 1);
+            uint64_t ahead = (_occupied[level] >> ((current + 1) & (SLOTS - 1)))
+                           | (_occupied[level] << ((SLOTS - current - 1) & (SLOTS - 1)));
+            uint64_t distance = __builtin_ctzll(ahead) + 1;
+            next = std::min(next, ((_tick >> shift) + distance) << shift);
+        }
+        return next;
+    }
+
+    Node* _nodes;
+    uint32_t* _heads;                 // LEVELS * SLOTS list heads, 0: empty
+    uint64_t _occupied[LEVELS] = {};  // Bit i of level L: slot i of L is not empty
+    uint64_t _tick = 0;               // Every tick before it was processed
+    uint64_t _next = ~uint64_t(0);    // No timer needs work before this tick
+    uint32_t _free = 0;
+    size_t _size = 0;
+};
@@ -6,21 +6,20 @@
 #include "matching_engine.h"
 
 // Performs AVX-512 vectorized order matching within a single tier.
-// Applies price-time priority to match incoming order against active orders.
-// Returns the updated active mask after matching.
-__mmask16 match_tier_avx512(
-    __m512i& tier_order_ids,
-    __m512i& tier_timestamps,
-    __m512i& tier_prices,
-    __m512i& tier_volumes,
-   
-    OrderBook::order_map_t& order_map,
+// The opposite side's lanes are kept in price-time priority, so incoming consumes a prefix of them.
+// Makers filled in full leave the book, along with their expiry timers.
+// Fills are published to reports (if not null), then passed to on_fill.
+void match_tier_avx512(
+    OrderBook::Tier& tier,
 
-    __mmask16& tier_active_mask,
+    OrderBook::order_map_t& order_map,
+    OrderBook::PriceLevels& levels,
+    ExpiryWheel& expiries,
 
     const Order& incoming,
 
     uint32_t& remaining,
 
-    std::function<void(FillReport&)> on_fill = nullptr
+    ReportRing* reports = nullptr,
+    const std::function<void(const FillReport&)>& on_fill = nullptr
 );
@@ -7,84 +7,206 @@ OrderBook& MatchingEngine::order_book() {
     return _order_book;
 }
 
-bool MatchingEngine::match(const Order& incoming) {
+bool MatchingEngine::match(const Order& order) {
+    replicate(ReplicationType::MATCH, [&order](ReplicationEvent& e) { e.order = order; });
+    bool matched = execute(order);
+    checkpoint();
+    return matched;
+}
+
+bool MatchingEngine::replace(const Order& order) {
+    replicate(ReplicationType::REPLACE, [&order](ReplicationEvent& e) { e.order = order; });
+    uint32_t cancelled_volume = 0;
+    bool matched = _order_book.cancel(order.id, cancelled_volume) && execute(order);
+    checkpoint();
+    return matched;
+}
+
+bool MatchingEngine::reduce(uint32_t order_id, uint32_t reduce_by) {
+    replicate(ReplicationType::REDUCE, [=](ReplicationEvent& e) { e.target = {order_id, reduce_by}; });
+    bool reduced = _order_book.reduce(order_id, reduce_by);
+    checkpoint();
+    return reduced;
+}
+
+void MatchingEngine::set_auction(bool auction) {
+    replicate(ReplicationType::SET_AUCTION, [=](ReplicationEvent& e) { e.auction = auction; });
+    _auction = auction;
+    checkpoint();
+}
+
+void MatchingEngine::checkpoint() {
+    if (_replication && ++_inputs % _hash_interval == 0) {
+        uint64_t hash = _order_book.hash();
+        replicate(ReplicationType::HASH, [hash](ReplicationEvent& e) { e.hash = hash; });
+    }
+}
+
+bool MatchingEngine::execute(const Order& incoming) {
+    if (_auction) {
+        return rest(incoming);
+    }
+
     // Get order volume
     uint32_t remaining = incoming.volume;
 
-    // Match
-    for (size_t tier_idx = 0; tier_idx < OrderBook::MAX_TIERS && remaining > 0; ++tier_idx) {
-        OrderBook::Tier& tier = _order_book.get_tier(tier_idx);
-        OrderBook::order_map_t& order_map = _order_book.get_map();
-
-        __mmask16 new_active_mask = match_tier_avx512(
-            tier.order_ids,
-            tier.timestamps,
-            tier.prices,
-            tier.volumes,
-
-            order_map,
-            
-            tier.active_mask,
-            
+    // Match tiers from the best opposite price towards the incoming price
+    const OrderBook::PriceLevels& levels = _order_book.get_levels();
+    const OrderBook::SideLevels& makers = incoming.side == Side::BID ? levels.asks : levels.bids;
+    bool crosses = makers.size > 0 && (incoming.side == Side::BID
+        ? incoming.price >= makers.prices[makers.size - 1]
+        : incoming.price <= makers.prices[makers.size - 1]);
+
+    size_t first_tier = crosses ? _order_book.get_tier_index(makers.prices[makers.size - 1]) : 0;
+    size_t last_tier = _order_book.get_tier_index(incoming.price);
+    if (last_tier >= OrderBook::MAX_TIERS) {
+        // Below every tier: only reachable by bids, which can't cross anything
+        crosses = crosses && incoming.side == Side::ASK;
+        last_tier = 0;
+    }
+
+    for (size_t tier_idx = first_tier; crosses && remaining > 0; ) {
+        match_tier_avx512(
+            _order_book.get_tier(tier_idx),
+
+            _order_book.get_map(),
+            _order_book.get_levels(),
+            _order_book.get_expiries(),
+
             incoming,
 
             remaining,
-            
+
+            _reports,
             on_fill
         );
 
-        tier.active_mask = new_active_mask;
+        if (tier_idx == last_tier) {
+            break;
+        }
+        tier_idx += incoming.side == Side::BID ? 1 : -1;
     }
 
     // Ack order with remaining volume
     if (remaining > 0) {
         Order residual = incoming;
         residual.volume = remaining;
-        bool insert_order = _order_book.insert(residual);
-        if (!insert_order) {
-            return false;
-        } else {
-            AckReport ack = {
-                .order_id = residual.id,
-                .order_timestamp = residual.timestamp,
-                .order_price = residual.price,
-                .remaining_volume = residual.volume,
-                .order_side = residual.side
-            };
-
-            if (on_ack) {
-                on_ack(ack);
-            }
-        }
+        return rest(residual);
     }
 
     return true;
 }
 
-bool MatchingEngine::cancel_order(uint32_t order_id) {
-    OrderBook::order_map_t& order_map = _order_book.get_map();
-    auto it = order_map.find(order_id);
-
-    if (it == order_map.end()){
+bool MatchingEngine::rest(const Order& order) {
+    if (!_order_book.insert(order)) {
         return false;
     }
 
-    // Erase order item in order map
-    order_map.erase(it);
+    AckReport ack = {
+        .order_id = order.id,
+        .order_timestamp = order.timestamp,
+        .order_price = order.price,
+        .remaining_volume = order.volume,
+        .order_side = order.side
+    };
 
-    // Remove mask entry in tier for this order
-    auto [tier_idx, slot_idx] = it->second;
+    if (_reports) {
+        _reports->publish(ack);
+    }
+    if (on_ack) {
+        on_ack(ack);
+    }
+    return true;
+}
 
-    OrderBook::Tier& tier = _order_book.get_tier(tier_idx);
+AuctionResult MatchingEngine::uncross(int32_t reference_price) {
+    replicate(ReplicationType::UNCROSS, [=](ReplicationEvent& e) { e.reference_price = reference_price; });
+    _auction = false;
 
-    tier.active_mask &= ~(1 << slot_idx);
+    AuctionResult result = _curves.equilibrium(_order_book.get_levels(), reference_price);
+    if (result.volume == 0) {
+        checkpoint();
+        return result;
+    }
 
-    if (on_cancel) {
-        CancelReport c = {
-            .order_id = order_id,
-            .cancelled_volume = reinterpret_cast<uint32_t*>(&tier.volumes)[slot_idx]
+    _order_book.uncross(result.price, result.volume, [this, &result](uint32_t bid_id, uint32_t ask_id, uint32_t volume) {
+        FillReport fill = {
+            .taker_order_id = bid_id,
+            .maker_order_id = ask_id,
+            .traded_price = result.price,
+            .traded_volume = volume
         };
+        if (_reports) {
+            _reports->publish(fill);
+        }
+        if (on_fill) {
+            on_fill(fill);
+        }
+    });
+    checkpoint();
+    return result;
+}
+
+bool MatchingEngine::cancel_order(uint32_t order_id) {
+    replicate(ReplicationType::CANCEL, [=](ReplicationEvent& e) { e.target = {order_id, 0}; });
+    uint32_t cancelled_volume = 0;
+    bool cancelled = _order_book.cancel(order_id, cancelled_volume);
+    checkpoint();
+    if (!cancelled) {
+        return false;
+    }
+
+    CancelReport c = {
+        .order_id = order_id,
+        .cancelled_volume = cancelled_volume
+    };
+    if (_reports) {
+        _reports->publish(c);
+    }
+    if (on_cancel) {
         on_cancel(c);
     }
     return true;
 }
+
+size_t MatchingEngine::advance_clock(uint64_t now) {
+    replicate(ReplicationType::ADVANCE_CLOCK, [=](ReplicationEvent& e) { e.now = now; });
+    size_t expired = !on_cancel && !_reports
+        ? _order_book.expire(now)
+        : _order_book.expire(now, [this](uint32_t order_id, uint32_t expired_volume) {
+            CancelReport c = {
+                .order_id = order_id,
+                .cancelled_volume = expired_volume
+            };
+            if (_reports) {
+                _reports->publish(c);
+            }
+            if (on_cancel) {
+                on_cancel(c);
+            }
+        });
+    checkpoint();
+    return expired;
+}
+
+size_t MatchingEngine::mass_cancel(uint32_t owner, Side side, int32_t min_price, int32_t max_price) {
+    replicate(ReplicationType::MASS_CANCEL, [=](ReplicationEvent& e) { e.range = {owner, side, min_price, max_price}; });
+    size_t cancelled = !on_cancel && !_reports
+        ? _order_book.mass_cancel(owner, side, min_price, max_price)
+        : _order_book.mass_cancel(owner, side, min_price, max_price,
+            [this](uint32_t order_id, uint32_t cancelled_volume) {
+                CancelReport c = {
+                    .order_id = order_id,
+                    .cancelled_volume = cancelled_volume
+                };
+                if (_reports) {
+                    _reports->publish(c);
+                }
+                if (on_cancel) {
+                    on_cancel(c);
+                }
+            }
+        );
+    checkpoint();
+    return cancelled;
+}
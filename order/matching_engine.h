@@ -1,32 +1,17 @@
 // matching_engine.h
 #pragma once
 #include "orderbook.h"
+#include "reports.h"
+#include "report_ring.h"
+#include "auction_avx512.h"
+#include "replication.h"
 #include <functional>
 #include <immintrin.h>
 
-struct FillReport {
-    uint32_t taker_order_id;
-    uint32_t maker_order_id;
-    int32_t  traded_price;
-    uint32_t traded_volume; // min of taker volume and maker volume
-};
-
-struct AckReport {
-    uint32_t order_id;
-    uint64_t order_timestamp;
-    int32_t  order_price;
-    uint32_t remaining_volume; // <= order volume
-    Side     order_side;
-};
-
-struct CancelReport {
-    uint32_t order_id;
-    uint32_t cancelled_volume;
-};
-
 class MatchingEngine {
     public:
-        MatchingEngine() = default;
+        // Book storage is carved from arena (see OrderBook), a private one if null.
+        explicit MatchingEngine(Arena* arena = nullptr) : _order_book(arena) {}
 
         // Return order book.
         OrderBook& order_book();
@@ -34,17 +19,83 @@ class MatchingEngine {
         // Match an order, if success (matched in full or partial), call on_fill,
         // if failure (can't match) or partially filled, call on_ack and ack the order.
         // If above is successful, return true, o/w return false.
+        // In an auction the order is only inserted and acked, even if it crosses.
         bool match(const Order& order);
 
+        // Modify: take resting order.id out of the book without a report and match order in its
+        // place, under the same id and behind everything at its price. Return as match, false also
+        // if order.id isn't resting.
+        bool replace(const Order& order);
+
+        // Reduce the volume of resting order_id by reduce_by without a report, keeping its time
+        // priority (see OrderBook::reduce).
+        bool reduce(uint32_t order_id, uint32_t reduce_by);
+
+        // Start (or abandon) a call auction: orders collect without matching until uncross.
+        void set_auction(bool auction);
+
+        bool in_auction() const { return _auction; }
+
+        // End the auction: trade the crossed part of the book at the single equilibrium price
+        // (see AuctionCurves::equilibrium), bids and asks each in price-time priority.
+        // Fills are reported at that price with the bid as taker_order_id and the ask as maker_order_id.
+        // Return the equilibrium, volume 0 if the book wasn't crossed.
+        AuctionResult uncross(int32_t reference_price = 0);
+
         // Cancel an order, if order exists and gets canceled, return true,
         // else return false (order doesn't exist or is already filled).
         bool cancel_order(uint32_t order_id);
 
+        // Cancel all orders of owner on side with price in [min_price, max_price],
+        // call on_cancel for each of them. Return the number of canceled orders.
+        size_t mass_cancel(uint32_t owner, Side side, int32_t min_price, int32_t max_price);
+
+        // Advance the engine clock to now: every resting order with expiry at or before now leaves
+        // the book, reported with a cancel report. Costs nothing when no order is due.
+        // Return the number of expired orders.
+        size_t advance_clock(uint64_t now);
+
+        // Publish every fill, ack and cancel report to ring (nullptr: off), before the callbacks run.
+        // Downstream work belongs on the ring's consumers, callbacks add to match latency.
+        void set_report_ring(ReportRing* ring) { _reports = ring; }
+
+        // Publish every input to log (nullptr: off) before it runs, and a hash of the book after
+        // every hash_interval inputs, for a StandbyReplica to follow in lockstep.
+        void set_replication(ReplicationLog* log, uint64_t hash_interval = 4096) {
+            _replication = log;
+            _hash_interval = hash_interval;
+        }
+
         // Optional external callbacks
         std::function<void(const FillReport&)> on_fill = nullptr;
         std::function<void(const AckReport&)> on_ack = nullptr;
         std::function<void(const CancelReport&)> on_cancel = nullptr;
 
     private:
+        // match without replication.
+        bool execute(const Order& order);
+
+        // Insert order into the book and ack it, return false if the book can't take it.
+        bool rest(const Order& order);
+
+        // Publish an input of type to the replication log, fill sets its fields.
+        template <typename Fill>
+        void replicate(ReplicationType type, Fill&& fill) {
+            if (_replication) {
+                ReplicationEvent& event = _replication->begin_event(type);
+                fill(event);
+                _replication->end_event(event);
+            }
+        }
+
+        // After an input ran: publish the book hash every _hash_interval inputs.
+        void checkpoint();
+
         OrderBook _order_book;
+        ReportRing* _reports = nullptr;
+        bool _auction = false;
+        AuctionCurves _curves;
+        ReplicationLog* _replication = nullptr;
+        uint64_t _hash_interval = 0;
+        uint64_t _inputs = 0;  // Replicated so far
 };
@@ -7,8 +7,10 @@ enum class Side : uint8_t {
 
 struct Order {
     uint32_t id;
-    uint32_t timestamp;
+    uint64_t timestamp;
     int32_t price;
     uint32_t volume;
     Side side;
+    uint32_t owner = 0; // Session / participant that owns the order
+    uint64_t expiry = 0; // Good till time: leaves the book once the engine clock reaches it, 0: never
 };
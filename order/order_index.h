@@ -0,0 +1,99 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "arena.h"
+
+// order_id -> (tier index, side, expiry timer) for every resting order of a book.
+// Open addressing with linear probing over a table carved from an Arena, sized once for the
+// book capacity: no rehash, no per-order node, nothing allocated after construction.
+// Erase shifts the following entries back instead of leaving tombstones, so probes stay short
+// under heavy churn.
+class OrderIndex {
+public:
+    struct Entry {
+        uint32_t order_id;
+        uint32_t tier : 30;
+        uint32_t side : 1;
+        uint32_t used : 1;
+        uint32_t timer;     // ExpiryWheel timer, 0: good till cancelled
+    };
+
+    // Slots for max_orders: a power of 2, at least twice max_orders.
+    static size_t slots_for(size_t max_orders) {
+        size_t slots = 16;
+        while (slots < 2 * max_orders) {
+            slots <<= 1;
+        }
+        return slots;
+    }
+
+    OrderIndex(Arena& arena, size_t max_orders) {
+        size_t slots = slots_for(max_orders);
+        _mask = slots - 1;
+        _shift = 32 - __builtin_ctzll(slots);
+        _entries = arena.create<Entry>(slots);
+    }
+
+    // Return the entry of order_id, nullptr if it isn't resting.
+    const Entry* find(uint32_t order_id) const {
+        for (size_t i = home(order_id); _entries[i].used; i = (i + 1) & _mask) {
+            if (_entries[i].order_id == order_id) {
+                return &_entries[i];
+            }
+        }
+        return nullptr;
+    }
+
+    // Map order_id to (tier, side, timer), replacing any previous mapping.
+    void assign(uint32_t order_id, size_t tier, size_t side, uint32_t timer = 0) {
+        size_t i = home(order_id);
+        while (_entries[i].used && _entries[i].order_id != order_id) {
+            i = (i + 1) & _mask;
+        }
+        _size += _entries[i].used ? 0 : 1;
+        _entries[i] = {order_id, static_cast<uint32_t>(tier), static_cast<uint32_t>(side), 1, timer};
+    }
+
+    // Remove order_id, storing its expiry timer into timer (if not null).
+    // Return false if it isn't resting.
+    bool erase(uint32_t order_id, uint32_t* timer = nullptr) {
+        size_t hole = home(order_id);
+        while (_entries[hole].order_id != order_id) {
+            if (!_entries[hole].used) {
+                return false;
+            }
+            hole = (hole + 1) & _mask;
+        }
+        if (!_entries[hole].used) {
+            return false;
+        }
+        if (timer) {
+            *timer = _entries[hole].timer;
+        }
+
+        // Pull back every following entry of the cluster whose home isn't between hole and itself
+        for (size_t i = (hole + 1) & _mask; _entries[i].used; i = (i + 1) & _mask) {
+            size_t distance = (i - home(_entries[i].order_id)) & _mask;
+            if (distance >= ((i - hole) & _mask)) {
+                _entries[hole] = _entries[i];
+                hole = i;
+            }
+        }
+        _entries[hole].used = 0;
+        _size--;
+        return true;
+    }
+
+    size_t size() const { return _size; }
+
+private:
+    // Fibonacci hashing: sequential ids spread over the whole table.
+    size_t home(uint32_t order_id) const {
+        return (order_id * 0x9E3779B1u) >> _shift;
+    }
+
+    Entry* _entries = nullptr;
+    size_t _mask = 0;
+    unsigned _shift = 0;
+    size_t _size = 0;
+};
@@ -3,6 +3,22 @@
 #include <cstring>
 #include <iostream>
 #include <bitset>
+#include <algorithm>
+
+OrderBook::OrderBook(Arena* arena)
+    : _own_arena(arena ? nullptr : std::make_unique<Arena>(arena_bytes())),
+      _arena(arena ? *arena : *_own_arena),
+      _tiers(_arena.create<Tier>(MAX_TIERS)),
+      _levels(_arena.create<PriceLevels>()),
+      _order_map(_arena, MAX_ORDERS),
+      _expiries(_arena, MAX_ORDERS) {}
+
+size_t OrderBook::arena_bytes() {
+    // Each block padded for its 64 byte alignment
+    size_t index_bytes = sizeof(OrderIndex::Entry) * OrderIndex::slots_for(MAX_ORDERS);
+    return (sizeof(Tier) * MAX_TIERS + 64) + (sizeof(PriceLevels) + 64) + (index_bytes + 64)
+         + ExpiryWheel::arena_bytes(MAX_ORDERS);
+}
 
 OrderBook::Tier& OrderBook::get_tier(size_t tier_idx) {
     return _tiers[tier_idx];
@@ -12,12 +28,103 @@ OrderBook::order_map_t& OrderBook::get_map() {
     return _order_map;
 }
 
+ExpiryWheel& OrderBook::get_expiries() {
+    return _expiries;
+}
+
+void OrderBook::forget(uint32_t order_id) {
+    uint32_t timer = 0;
+    if (_order_map.erase(order_id, &timer) && timer) {
+        _expiries.remove(timer);
+    }
+}
+
+OrderBook::PriceLevels& OrderBook::get_levels() {
+    return *_levels;
+}
+
+const OrderBook::PriceLevels& OrderBook::get_levels() const {
+    return *_levels;
+}
+
+// Count the levels strictly better than price, 16 levels at a time from the best end.
+static size_t count_better_levels(const OrderBook::SideLevels& levels, Side side, int32_t price) {
+    __m512i target = _mm512_set1_epi32(price);
+    size_t better = 0;
+    size_t end = levels.size;
+
+    while (end > 0) {
+        size_t start = end > 16 ? end - 16 : 0;
+        __mmask16 valid = static_cast<__mmask16>((1u << (end - start)) - 1);
+        __m512i block = _mm512_maskz_loadu_epi32(valid, levels.prices + start);
+
+        __mmask16 better_mask = (side == Side::BID)
+            ? _mm512_mask_cmpgt_epi32_mask(valid, block, target)
+            : _mm512_mask_cmplt_epi32_mask(valid, block, target);
+        better += __builtin_popcount(better_mask);
+
+        // Levels are sorted, so the first block with a level not better than price ends the scan
+        if (better_mask != valid) {
+            break;
+        }
+        end = start;
+    }
+    return better;
+}
+
+void OrderBook::PriceLevels::add_order(Side side, int32_t price, uint32_t volume) {
+    SideLevels& levels = side == Side::BID ? bids : asks;
+    size_t idx = levels.size - count_better_levels(levels, side, price);
+
+    if (idx > 0 && levels.prices[idx - 1] == price) {
+        levels.volumes[idx - 1] += volume;
+        levels.counts[idx - 1] += 1;
+        return;
+    }
+
+    if (levels.size == MAX_LEVELS) {
+        return;
+    }
+
+    // Open a new level at idx
+    size_t tail = levels.size - idx;
+    std::memmove(levels.prices + idx + 1, levels.prices + idx, tail * sizeof(int32_t));
+    std::memmove(levels.volumes + idx + 1, levels.volumes + idx, tail * sizeof(uint32_t));
+    std::memmove(levels.counts + idx + 1, levels.counts + idx, tail * sizeof(uint32_t));
+    levels.prices[idx] = price;
+    levels.volumes[idx] = volume;
+    levels.counts[idx] = 1;
+    levels.size++;
+}
+
+void OrderBook::PriceLevels::remove_volume(Side side, int32_t price, uint32_t volume, bool order_removed) {
+    SideLevels& levels = side == Side::BID ? bids : asks;
+    size_t better = count_better_levels(levels, side, price);
+    if (better == levels.size || levels.prices[levels.size - better - 1] != price) {
+        return;
+    }
+    size_t idx = levels.size - better - 1;
+
+    levels.volumes[idx] -= volume;
+    levels.counts[idx] -= order_removed ? 1 : 0;
+    if (levels.counts[idx] > 0) {
+        return;
+    }
+
+    // Close the empty level
+    size_t tail = levels.size - idx - 1;
+    std::memmove(levels.prices + idx, levels.prices + idx + 1, tail * sizeof(int32_t));
+    std::memmove(levels.volumes + idx, levels.volumes + idx + 1, tail * sizeof(uint32_t));
+    std::memmove(levels.counts + idx, levels.counts + idx + 1, tail * sizeof(uint32_t));
+    levels.size--;
+}
+
 size_t OrderBook::get_tier_index(int32_t price) const  {
     int32_t tier = price / TIER_GRANULARITY;
     if (tier < 0) {
         return -1;
     }
-    if (tier >= MAX_TIERS) {
+    if (static_cast<size_t>(tier) >= MAX_TIERS) {
         return MAX_TIERS - 1;
     }
     return static_cast<size_t>(tier);
@@ -25,104 +132,386 @@ size_t OrderBook::get_tier_index(int32_t price) const  {
 
 bool OrderBook::insert(const Order& order) {
     size_t tier_idx = get_tier_index(order.price);
-    if (tier_idx < 0) {
+    if (tier_idx >= MAX_TIERS) {
         return false;
     }
-    
-    auto& tier = _tiers[tier_idx];
 
-    size_t start = order.side == Side::BID? 0 : 1;
-    for (size_t i = start; i < 16; i+=2) {
+    Tier& tier = _tiers[tier_idx];
+    if (tier.count(order.side) == Tier::LANES) {
+        return false;
+    }
 
-        // Check if slot is empty
-        if (!((tier.active_mask >> i) & 1)) {
-            // Insert order
-            reinterpret_cast<uint32_t*>(&tier.order_ids)[i]     = order.id;
-            reinterpret_cast<uint32_t*>(&tier.timestamps)[i]    = order.timestamp;
-            reinterpret_cast<int32_t*>(&tier.prices)[i]         = order.price;
-            reinterpret_cast<uint32_t*>(&tier.volumes)[i]       = order.volume;
+    // Shift worse orders up to keep the side in price-time priority
+    size_t lane = tier.priority_lane(order);
+    tier.open_lane(order.side, lane);
 
-            // Set active bit
-            tier.active_mask |= (1 << i);
+    // Insert order
+    TierHot<Tier::LANES>& hot = tier.hot(order.side);
+    TierCold<Tier::LANES>& cold = tier.cold(order.side);
+    hot.prices[lane]      = order.price;
+    hot.volumes[lane]     = order.volume;
+    cold.order_ids[lane]  = order.id;
+    cold.owners[lane]     = order.owner;
+    cold.timestamps[lane] = order.timestamp;
 
-            _order_map[order.id] = {tier_idx, i};
-            return true;
-        }
+    // A reused id replaces its old mapping: release the old expiry timer with it
+    const OrderIndex::Entry* previous = _order_map.find(order.id);
+    if (previous && previous->timer) {
+        _expiries.remove(previous->timer);
     }
-    return false;
+    uint32_t timer = order.expiry ? _expiries.schedule(order.id, order.expiry) : 0;
+    _order_map.assign(order.id, tier_idx, static_cast<size_t>(order.side), timer);
+    _levels->add_order(order.side, order.price, order.volume);
+    return true;
 }
 
 bool OrderBook::cancel(uint32_t order_id, uint32_t& canceled_volume) {
-    auto it = _order_map.find(order_id);
-    if (it == _order_map.end()) {
+    const OrderIndex::Entry* entry = _order_map.find(order_id);
+    if (!entry) {
         return false;
     }
 
-    auto [tier_idx, slot_idx] = it->second;
-    Tier& tier = _tiers[tier_idx];
+    Side side = static_cast<Side>(entry->side);
+    Tier& tier = _tiers[entry->tier];
+    int lane = tier.find_lane(side, order_id);
+    TierHot<Tier::LANES>& hot = tier.hot(side);
 
-    uint32_t* volume_ptr = reinterpret_cast<uint32_t*>(&tier.volumes);
-    canceled_volume = volume_ptr[slot_idx];
+    canceled_volume = hot.volumes[lane];
+    _levels->remove_volume(side, hot.prices[lane], canceled_volume, true);
 
-    // Clear slot in active_mask
-    tier.active_mask &= ~(1 << slot_idx);
+    // Close the gap left by the lane
+    tier.compact(side, tier.active_mask(side) & ~(1u << lane));
 
     // Delete item in order_map
-    _order_map.erase(it);
+    forget(order_id);
 
     return true;
 }
 
+size_t OrderBook::mass_cancel(
+    uint32_t owner, Side side, int32_t min_price, int32_t max_price,
+    const std::function<void(uint32_t, uint32_t)>& on_cancelled
+) {
+    using traits = Tier::traits;
+
+    if (max_price < min_price || max_price < 0) {
+        return 0;
+    }
+
+    // Only sweep tiers overlapping the price range
+    size_t first_tier = get_tier_index(std::max(min_price, 0));
+    size_t last_tier = get_tier_index(max_price);
+
+    Tier::vec_t owner_vec = traits::set1(static_cast<int32_t>(owner));
+    Tier::vec_t min_vec = traits::set1(min_price);
+    Tier::vec_t max_vec = traits::set1(max_price);
+    size_t canceled = 0;
+
+    for (size_t tier_idx = first_tier; tier_idx <= last_tier; ++tier_idx) {
+        Tier& tier = _tiers[tier_idx];
+        TierHot<Tier::LANES>& hot = tier.hot(side);
+        const TierCold<Tier::LANES>& cold = tier.cold(side);
+
+        Tier::vec_t prices = tier.prices(side);
+        Tier::vec_t volumes = tier.volumes(side);
+
+        Tier::mask_t hit = traits::test(volumes);
+        hit = traits::cmpge(hit, prices, min_vec);
+        hit = traits::cmple(hit, prices, max_vec);
+        hit = traits::cmpeq(hit, traits::load(cold.owners), owner_vec);
+        if (!hit) {
+            continue;
+        }
+
+        for (uint32_t lanes = hit; lanes; lanes &= lanes - 1) {
+            int i = __builtin_ctz(lanes);
+            forget(cold.order_ids[i]);
+            _levels->remove_volume(side, hot.prices[i], hot.volumes[i], true);
+            if (on_cancelled) {
+                on_cancelled(cold.order_ids[i], hot.volumes[i]);
+            }
+        }
+
+        // Drop every hit lane at once
+        tier.compact(side, tier.active_mask(side) & ~hit);
+        canceled += __builtin_popcount(hit);
+    }
+    return canceled;
+}
+
+size_t OrderBook::expire(uint64_t now, const std::function<void(uint32_t, uint32_t)>& on_expired) {
+    // (tier index, side) of the tiers with cleared lanes, compacted when full and at the end
+    static constexpr size_t MAX_TOUCHED = 64;
+    uint32_t touched[MAX_TOUCHED];
+    size_t touched_count = 0;
+    size_t expired = 0;
+
+    auto compact_touched = [&] {
+        for (size_t t = 0; t < touched_count; ++t) {
+            Side side = static_cast<Side>(touched[t] & 1);
+            Tier& tier = _tiers[touched[t] >> 1];
+            tier.compact(side, tier.active_mask(side));
+        }
+        touched_count = 0;
+    };
+
+    _expiries.advance(now, [&](uint32_t order_id) {
+        // Nothing to expire if the id no longer rests where its index says
+        const OrderIndex::Entry* entry = _order_map.find(order_id);
+        if (!entry) {
+            return;
+        }
+        Side side = static_cast<Side>(entry->side);
+        size_t tier_idx = entry->tier;
+        Tier& tier = _tiers[tier_idx];
+        int lane = tier.find_lane(side, order_id);
+        if (lane < 0) {
+            return;
+        }
+        TierHot<Tier::LANES>& hot = tier.hot(side);
+
+        // A tier whose active lanes are still a prefix has no cleared lane yet. Clearing its last
+        // lane keeps it a prefix and may list it twice, compacting it again is harmless.
+        uint32_t active = tier.active_mask(side);
+        if ((active & (active + 1)) == 0) {
+            if (touched_count == MAX_TOUCHED) {
+                compact_touched();
+            }
+            touched[touched_count++] = static_cast<uint32_t>(tier_idx << 1 | entry->side);
+        }
+
+        // A zero volume lane is inactive: the tier can wait for its compaction
+        uint32_t volume = hot.volumes[lane];
+        _levels->remove_volume(side, hot.prices[lane], volume, true);
+        hot.volumes[lane] = 0;
+        _order_map.erase(order_id);  // The wheel already released the timer
+        expired++;
+
+        if (on_expired) {
+            on_expired(order_id, volume);
+        }
+    });
+
+    compact_touched();
+    return expired;
+}
+
+bool OrderBook::find(uint32_t order_id, Order& order) const {
+    const OrderIndex::Entry* entry = _order_map.find(order_id);
+    if (!entry) {
+        return false;
+    }
+
+    Side side = static_cast<Side>(entry->side);
+    const Tier& tier = _tiers[entry->tier];
+    int lane = tier.find_lane(side, order_id);
+    order = {
+        .id = order_id,
+        .timestamp = tier.cold(side).timestamps[lane],
+        .price = tier.hot(side).prices[lane],
+        .volume = tier.hot(side).volumes[lane],
+        .side = side,
+        .owner = tier.cold(side).owners[lane],
+        .expiry = entry->timer ? _expiries.expiry(entry->timer) : 0
+    };
+    return true;
+}
+
+bool OrderBook::queue_position(uint32_t order_id, uint32_t& orders_ahead, uint32_t& volume_ahead) const {
+    using traits = Tier::traits;
+
+    const OrderIndex::Entry* entry = _order_map.find(order_id);
+    if (!entry) {
+        return false;
+    }
+
+    Side side = static_cast<Side>(entry->side);
+    const Tier& tier = _tiers[entry->tier];
+    int lane = tier.find_lane(side, order_id);
+    const TierHot<Tier::LANES>& hot = tier.hot(side);
+
+    // A price lives in a single tier, and its orders sit in timestamp order in front of this one
+    Tier::mask_t same_price = traits::cmpeq(tier.active_mask(side), tier.prices(side), traits::set1(hot.prices[lane]));
+    Tier::mask_t ahead = same_price & static_cast<Tier::mask_t>((1u << lane) - 1);
+
+    orders_ahead = __builtin_popcount(ahead);
+    volume_ahead = 0;
+    for (uint32_t lanes = ahead; lanes; lanes &= lanes - 1) {
+        volume_ahead += hot.volumes[__builtin_ctz(lanes)];
+    }
+    return true;
+}
+
 bool OrderBook::reduce(uint32_t order_id, uint32_t reduce_by) {
-    auto it = _order_map.find(order_id);
-    if (it == _order_map.end()) {
+    const OrderIndex::Entry* entry = _order_map.find(order_id);
+    if (!entry) {
         return false;
     }
 
-    auto [tier_idx, slot_idx] = it->second;
-    Tier& tier = _tiers[tier_idx];
+    Side side = static_cast<Side>(entry->side);
+    Tier& tier = _tiers[entry->tier];
+    int lane = tier.find_lane(side, order_id);
+    TierHot<Tier::LANES>& hot = tier.hot(side);
 
-    uint32_t* volume_ptr = reinterpret_cast<uint32_t*>(&tier.volumes);
-    if (volume_ptr[slot_idx] < reduce_by) {
+    if (hot.volumes[lane] < reduce_by) {
         return false;
     }
 
     // Reduce
-    volume_ptr[slot_idx] -= reduce_by;
-    if (volume_ptr[slot_idx] == 0) {
+    hot.volumes[lane] -= reduce_by;
+    _levels->remove_volume(side, hot.prices[lane], reduce_by, hot.volumes[lane] == 0);
+    if (hot.volumes[lane] == 0) {
         // All is taken, delete order
-        tier.active_mask &= ~(1 << slot_idx);
-        _order_map.erase(it);
+        tier.compact(side, tier.active_mask(side));
+        forget(order_id);
     }
     return true;
 }
 
+uint64_t OrderBook::uncross(
+    int32_t price, uint64_t volume, const std::function<void(uint32_t, uint32_t, uint32_t)>& on_fill
+) {
+    if (_levels->bids.size == 0 || _levels->asks.size == 0) {
+        return 0;
+    }
+
+    // Walks one side in price-time priority: tiers from the best price towards price, lanes in order
+    struct Cursor {
+        Side side;
+        size_t first_tier;
+        size_t tier;
+        size_t lane;
+        uint32_t taken;  // Volume filled so far of the order at lane
+    };
+    size_t best_bid_tier = get_tier_index(_levels->bids.prices[_levels->bids.size - 1]);
+    size_t best_ask_tier = get_tier_index(_levels->asks.prices[_levels->asks.size - 1]);
+    Cursor cursors[2] = {
+        {Side::BID, best_bid_tier, best_bid_tier, 0, 0},
+        {Side::ASK, best_ask_tier, best_ask_tier, 0, 0},
+    };
+    size_t limit_tier = get_tier_index(price);
+
+    // Move c onto an order that can trade at price, false if there is none left
+    auto settle = [&](Cursor& c) {
+        while (true) {
+            const Tier& tier = _tiers[c.tier];
+            if (c.lane < tier.count(c.side)) {
+                int32_t lane_price = tier.hot(c.side).prices[c.lane];
+                return c.side == Side::BID ? lane_price >= price : lane_price <= price;
+            }
+            if (c.tier == limit_tier) {
+                return false;
+            }
+            c.tier = c.side == Side::BID ? c.tier - 1 : c.tier + 1;
+            c.lane = 0;
+        }
+    };
+
+    // Pair both sides, the book is left untouched until every fill is known
+    Cursor& bid = cursors[0];
+    Cursor& ask = cursors[1];
+    uint64_t traded_total = 0;
+    while (traded_total < volume && settle(bid) && settle(ask)) {
+        uint32_t bid_volume = _tiers[bid.tier].hot(Side::BID).volumes[bid.lane];
+        uint32_t ask_volume = _tiers[ask.tier].hot(Side::ASK).volumes[ask.lane];
+        uint32_t traded = static_cast<uint32_t>(std::min<uint64_t>(
+            std::min(bid_volume - bid.taken, ask_volume - ask.taken), volume - traded_total));
+
+        if (on_fill) {
+            on_fill(_tiers[bid.tier].cold(Side::BID).order_ids[bid.lane],
+                    _tiers[ask.tier].cold(Side::ASK).order_ids[ask.lane], traded);
+        }
+        traded_total += traded;
+
+        for (Cursor* c : {&bid, &ask}) {
+            c->taken += traded;
+            if (c->taken == _tiers[c->tier].hot(c->side).volumes[c->lane]) {
+                c->lane++;
+                c->taken = 0;
+            }
+        }
+    }
+
+    // Every tier the cursor left is filled in full, the one it stopped in up to its lane
+    for (const Cursor& c : cursors) {
+        for (size_t tier_idx = c.first_tier; ; tier_idx = c.side == Side::BID ? tier_idx - 1 : tier_idx + 1) {
+            Tier& tier = _tiers[tier_idx];
+            TierHot<Tier::LANES>& hot = tier.hot(c.side);
+            const TierCold<Tier::LANES>& cold = tier.cold(c.side);
+            Tier::mask_t active = tier.active_mask(c.side);
+            Tier::mask_t filled = tier_idx == c.tier ? active & static_cast<Tier::mask_t>((1u << c.lane) - 1) : active;
+
+            for (uint32_t lanes = filled; lanes; lanes &= lanes - 1) {
+                int i = __builtin_ctz(lanes);
+                forget(cold.order_ids[i]);
+                _levels->remove_volume(c.side, hot.prices[i], hot.volumes[i], true);
+            }
+            if (tier_idx == c.tier && c.taken > 0) {
+                hot.volumes[c.lane] -= c.taken;
+                _levels->remove_volume(c.side, hot.prices[c.lane], c.taken, false);
+            }
+            if (filled) {
+                tier.compact(c.side, active & ~filled);
+            }
+            if (tier_idx == c.tier) {
+                break;
+            }
+        }
+    }
+    return traded_total;
+}
+
+uint64_t OrderBook::hash() const {
+    // FNV-1a over 64 bit words, lanes in priority order, both sides of every non empty tier
+    uint64_t h = 0xCBF29CE484222325ull;
+    auto mix = [&h](uint64_t word) {
+        h = (h ^ word) * 0x100000001B3ull;
+    };
+
+    for (size_t tier_idx = 0; tier_idx < MAX_TIERS; ++tier_idx) {
+        const Tier& tier = _tiers[tier_idx];
+        for (Side side : {Side::BID, Side::ASK}) {
+            size_t count = tier.count(side);
+            if (count == 0) {
+                continue;
+            }
+            const TierHot<Tier::LANES>& hot = tier.hot(side);
+            const TierCold<Tier::LANES>& cold = tier.cold(side);
+            mix(tier_idx << 1 | static_cast<size_t>(side));
+            for (size_t i = 0; i < count; ++i) {
+                mix(uint64_t(cold.order_ids[i]) << 32 | cold.owners[i]);
+                mix(cold.timestamps[i]);
+                mix(uint64_t(static_cast<uint32_t>(hot.prices[i])) << 32 | hot.volumes[i]);
+            }
+        }
+    }
+    return h;
+}
+
 std::pair<int32_t, int32_t> OrderBook::get_top_of_book() const {
-    __m512i max_bid = _mm512_set1_epi32(std::numeric_limits<int32_t>::min());
-    __m512i min_ask = _mm512_set1_epi32(std::numeric_limits<int32_t>::max());
+    using traits = Tier::traits;
 
-    for (const auto& tier : _tiers) {
-        // Load tier price and active mask
-        __m512i prices = tier.prices;
-        __mmask16 mask = tier.active_mask;
+    Tier::vec_t max_bid = traits::set1(std::numeric_limits<int32_t>::min());
+    Tier::vec_t min_ask = traits::set1(std::numeric_limits<int32_t>::max());
 
-        // Get active bid mask (even positions)
-        __mmask16 bid_mask = mask & 0x5555;
-        max_bid = _mm512_mask_max_epi32(max_bid, bid_mask, max_bid, prices);
+    // Only the hot block of each side is touched
+    for (size_t tier_idx = 0; tier_idx < MAX_TIERS; ++tier_idx) {
+        const Tier& tier = _tiers[tier_idx];
+        Tier::vec_t bid_volumes = tier.volumes(Side::BID);
+        max_bid = traits::mask_max(max_bid, traits::test(bid_volumes), max_bid, tier.prices(Side::BID));
 
-        // Get active ask mask (odd positions)
-        __mmask16 ask_mask = mask & 0xAAAA;
-        min_ask = _mm512_mask_min_epi32(min_ask, ask_mask, min_ask, prices);
+        Tier::vec_t ask_volumes = tier.volumes(Side::ASK);
+        min_ask = traits::mask_min(min_ask, traits::test(ask_volumes), min_ask, tier.prices(Side::ASK));
     }
 
-    alignas(64) int32_t bid_arr[16], ask_arr[16];
-    _mm512_store_epi32(bid_arr, max_bid);
-    _mm512_store_epi32(ask_arr, min_ask);
+    alignas(64) int32_t bid_arr[Tier::LANES], ask_arr[Tier::LANES];
+    traits::store(bid_arr, max_bid);
+    traits::store(ask_arr, min_ask);
 
     int32_t best_bid = std::numeric_limits<int32_t>::min();
     int32_t best_ask = std::numeric_limits<int32_t>::max();
 
-    for (int i = 0; i < 16; ++i) {
+    for (size_t i = 0; i < Tier::LANES; ++i) {
         best_bid = std::max(best_bid, bid_arr[i]);
         best_ask = std::min(best_ask, ask_arr[i]);
     }
@@ -132,3 +521,20 @@ std::pair<int32_t, int32_t> OrderBook::get_top_of_book() const {
         best_ask == std::numeric_limits<int32_t>::max()? 0 : best_ask
     };
 }
+
+std::pair<size_t, size_t> OrderBook::get_depth(size_t n, DepthLevel* bids, DepthLevel* asks) const {
+    size_t bid_count = std::min(n, _levels->bids.size);
+    size_t ask_count = std::min(n, _levels->asks.size);
+
+    // Best levels sit at the end of each side
+    for (size_t i = 0; i < bid_count; ++i) {
+        size_t idx = _levels->bids.size - 1 - i;
+        bids[i] = {_levels->bids.prices[idx], _levels->bids.volumes[idx], _levels->bids.counts[idx]};
+    }
+    for (size_t i = 0; i < ask_count; ++i) {
+        size_t idx = _levels->asks.size - 1 - i;
+        asks[i] = {_levels->asks.prices[idx], _levels->asks.volumes[idx], _levels->asks.counts[idx]};
+    }
+
+    return {bid_count, ask_count};
+}
@@ -1,38 +1,90 @@
 #pragma once
 #include <immintrin.h>
 #include <atomic>
-#include <unordered_map>
 #include <cstdint>
-#include <array>
+#include <memory>
 #include <utility>
+#include <functional>
 #include "order.h"
+#include "tier.h"
+#include "arena.h"
+#include "order_index.h"
+#include "expiry_wheel.h"
+
+// Book geometry, chosen per instrument class at compile time (see benchmark/geometry_matrix.sh).
+#ifndef ORDERBOOK_TIER_LANES
+#define ORDERBOOK_TIER_LANES 8          // Slots per side in a tier: 8 or 16
+#endif
+#ifndef ORDERBOOK_SIDE_LAYOUT
+#define ORDERBOOK_SIDE_LAYOUT SPLIT     // SideLayout of the tier blocks: SPLIT or GROUPED
+#endif
+#ifndef ORDERBOOK_MAX_TIERS
+#define ORDERBOOK_MAX_TIERS 10
+#endif
+#ifndef ORDERBOOK_TIER_GRANULARITY
+#define ORDERBOOK_TIER_GRANULARITY 8    // Price ticks covered by one tier
+#endif
+
+// Aggregate of all resting orders at one price.
+struct DepthLevel {
+    int32_t  price;
+    uint32_t volume;      // Sum of remaining volume at this price.
+    uint32_t order_count; // Number of resting orders at this price.
+};
 
 class OrderBook {
 public:
-    using order_map_t = std::unordered_map<uint32_t, std::pair<size_t, size_t>>;
-
-    // 16 orders per tier (8 bid on even positions + 8 ask on odd positions)
-    static constexpr size_t MAX_TIERS = 10;
-    static constexpr int32_t TIER_GRANULARITY = 8; // Each tier covers 8 bids and 8 asks
-
-    // bid stays in even positions [0,2,4,6,8,10,12,14],
-    // ask stays in odd positions [1,3,5,7,9,11,13,15].
-    struct Tier {
-        __m512i order_ids   = _mm512_setzero_si512();
-        __m512i timestamps  = _mm512_setzero_si512();
-        __m512i prices      = _mm512_setzero_si512();
-        __m512i volumes     = _mm512_setzero_si512();
-        __mmask16 active_mask = 0;
+    using order_map_t = OrderIndex;
+
+    // Bids and asks of a tier live in separate blocks of SLOTS_PER_SIDE lanes each,
+    // each block kept in price-time priority.
+    using Tier = BasicTier<ORDERBOOK_TIER_LANES, SideLayout::ORDERBOOK_SIDE_LAYOUT>;
+
+    static constexpr size_t MAX_TIERS = ORDERBOOK_MAX_TIERS;
+    static constexpr int32_t TIER_GRANULARITY = ORDERBOOK_TIER_GRANULARITY;
+    static constexpr size_t SLOTS_PER_SIDE = Tier::LANES;
+    static constexpr size_t MAX_LEVELS = MAX_TIERS * SLOTS_PER_SIDE; // Worst case: every order at its own price
+    static constexpr size_t MAX_ORDERS = MAX_TIERS * SLOTS_PER_SIDE * 2;
+
+    // Per-price aggregates of one side, kept in SoA arrays sorted from worst to best price,
+    // so the best level is at size - 1 and churn near the touch only shifts a few entries.
+    struct alignas(64) SideLevels {
+        alignas(64) int32_t  prices[MAX_LEVELS];
+        alignas(64) uint32_t volumes[MAX_LEVELS];
+        alignas(64) uint32_t counts[MAX_LEVELS];
+        size_t size = 0;
     };
 
-    OrderBook() = default;
+    // Per-price aggregates of both sides, updated incrementally on insert, reduce, cancel and fill.
+    struct PriceLevels {
+        SideLevels bids;
+        SideLevels asks;
+
+        // Add a new resting order of volume at price.
+        void add_order(Side side, int32_t price, uint32_t volume);
+
+        // Take volume away from the level at price, if order_removed, the order has left the book.
+        // Empty levels are erased.
+        void remove_volume(Side side, int32_t price, uint32_t volume, bool order_removed);
+    };
+
+    // Tiers, levels, order index and expiry wheel are carved from arena, which must outlive the book.
+    // Without one the book maps a private arena on the calling thread's NUMA node.
+    explicit OrderBook(Arena* arena = nullptr);
+
+    OrderBook(const OrderBook&) = delete;
+    OrderBook& operator=(const OrderBook&) = delete;
+
+    // Arena bytes needed by one book.
+    static size_t arena_bytes();
 
     // Get tier index of the order by its price, 
     // If price is invalid, return -1;
     // Else return a number between 0 and MAX_TIERS.
     size_t get_tier_index(int32_t price) const;
 
-    // Insert a new order into the orderbook.
+    // Insert a new order into the orderbook, at its price-time priority lane of its tier,
+    // scheduling its expiry if it has one.
     // Return true if the order is inserted, and false if either input price is invalid or book is full.
     bool insert(const Order& order);
 
@@ -40,21 +92,68 @@ public:
     // Else return false (order doesn't exist).
     bool cancel(uint32_t order_id, uint32_t& canceled_volume);
 
+    // Cancel every order of owner on side with price in [min_price, max_price],
+    // call on_cancelled(order_id, cancelled_volume) for each of them.
+    // Return the number of canceled orders.
+    size_t mass_cancel(
+        uint32_t owner, Side side, int32_t min_price, int32_t max_price,
+        const std::function<void(uint32_t, uint32_t)>& on_cancelled = nullptr
+    );
+
+    // Remove every resting order with expiry at or before now, call on_expired(order_id, volume)
+    // for each of them. Expired lanes are cleared one by one and each tier they left is compacted
+    // once, after the wheel is done. Return the number of expired orders.
+    size_t expire(uint64_t now, const std::function<void(uint32_t, uint32_t)>& on_expired = nullptr);
+
+    // Copy resting order order_id into order, return false if it isn't resting.
+    bool find(uint32_t order_id, Order& order) const;
+
+    // Queue position of resting order order_id: number and volume of the orders at its price
+    // ahead of it in time priority. Return false if it isn't resting.
+    bool queue_position(uint32_t order_id, uint32_t& orders_ahead, uint32_t& volume_ahead) const;
+
+    // Call auction: trade up to volume between bids priced at or above price and asks at or below it,
+    // each side consumed in price-time priority, calling on_fill(bid_id, ask_id, volume) per pair.
+    // Filled orders leave the book afterwards, one compaction per tier. Return the volume traded.
+    uint64_t uncross(int32_t price, uint64_t volume, const std::function<void(uint32_t, uint32_t, uint32_t)>& on_fill);
+
     // Reduce the volume of an order by reduce_by, return true if reduction is successful,
     // return false other wise (order doesn't exist or current volume is less than reduce_by).
     bool reduce(uint32_t order_id, uint32_t reduce_by);
 
+    // Hash of every resting order (id, owner, timestamp, price, volume) in book order: two books
+    // fed the same inputs hash the same. Scans every tier, meant for periodic checks.
+    uint64_t hash() const;
+
     // Get the current highest bid and lowest ask. 
     // Return [highest_bid, lowest_ask].
     std::pair<int32_t, int32_t> get_top_of_book() const;
 
+    // Copy up to n best price levels of each side into bids and asks (each must hold n entries),
+    // best price first. Return [number of bid levels, number of ask levels] copied.
+    std::pair<size_t, size_t> get_depth(size_t n, DepthLevel* bids, DepthLevel* asks) const;
+
     // Get tier of order book using tier index.
     Tier& get_tier(size_t tier_idx);
 
     // Get order map.
     order_map_t& get_map();
 
+    // Get expiry timers of the resting orders.
+    ExpiryWheel& get_expiries();
+
+    // Get per-price aggregates.
+    PriceLevels& get_levels();
+    const PriceLevels& get_levels() const;
+
 private:
-    std::array<Tier, MAX_TIERS> _tiers;
-    order_map_t _order_map; // order_id -> (tier index, slot index)
+    // Drop order_id from the order index and its timer from the expiry wheel.
+    void forget(uint32_t order_id);
+
+    std::unique_ptr<Arena> _own_arena;
+    Arena& _arena;
+    Tier* _tiers;           // MAX_TIERS tiers
+    PriceLevels* _levels;
+    order_map_t _order_map; // order_id -> (tier index, side, timer), lanes move as the tier is kept sorted
+    ExpiryWheel _expiries;  // Good till time orders
 };
@@ -0,0 +1,162 @@
+#include "replication.h"
+#include "matching_engine.h"
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// Events start on the cache line after the header.
+static constexpr size_t EVENTS_OFFSET = (sizeof(ReplicationHeader) + 63) & ~size_t(63);
+
+ReplicationLog::~ReplicationLog() {
+    if (_header) {
+        munmap(_header, _bytes);
+    }
+    if (_owner) {
+        shm_unlink(_name);
+    }
+}
+
+bool ReplicationLog::create(const char* name, size_t capacity) {
+    if (capacity == 0 || (capacity & (capacity - 1)) != 0) {
+        std::fprintf(stderr, "ReplicationLog: capacity must be a power of 2\n");
+        return false;
+    }
+
+    // A stale log of a previous run is replaced, so a standby never follows a mix of both
+    shm_unlink(name);
+    int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) {
+        perror("shm_open");
+        return false;
+    }
+    size_t bytes = EVENTS_OFFSET + capacity * sizeof(ReplicationEvent);
+    if (ftruncate(fd, bytes) < 0) {
+        perror("ftruncate");
+        close(fd);
+        shm_unlink(name);
+        return false;
+    }
+
+    // Faulted in now, not on the primary's match path
+    void* addr = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        perror("mmap");
+        shm_unlink(name);
+        return false;
+    }
+
+    // The object is zero filled, only the header needs writing. Magic last: standbys check it.
+    _header = static_cast<ReplicationHeader*>(addr);
+    _events = reinterpret_cast<ReplicationEvent*>(static_cast<char*>(addr) + EVENTS_OFFSET);
+    _mask = capacity - 1;
+    _bytes = bytes;
+    _header->version = ReplicationHeader::VERSION;
+    _header->capacity = static_cast<uint32_t>(capacity);
+    std::atomic_thread_fence(std::memory_order_release);
+    _header->magic = ReplicationHeader::MAGIC;
+
+    strncpy(_name, name, sizeof(_name) - 1);
+    _owner = true;
+    return true;
+}
+
+bool ReplicationLog::open(const char* name) {
+    int fd = shm_open(name, O_RDWR, 0);
+    if (fd < 0) {
+        return false;
+    }
+
+    // Header first, for the ring size
+    void* addr = mmap(nullptr, EVENTS_OFFSET, PROT_READ, MAP_SHARED, fd, 0);
+    if (addr == MAP_FAILED) {
+        close(fd);
+        return false;
+    }
+    const ReplicationHeader* header = static_cast<const ReplicationHeader*>(addr);
+    bool valid = header->magic == ReplicationHeader::MAGIC && header->version == ReplicationHeader::VERSION;
+    size_t capacity = header->capacity;
+    munmap(addr, EVENTS_OFFSET);
+    if (!valid) {
+        close(fd);
+        return false;
+    }
+
+    size_t bytes = EVENTS_OFFSET + capacity * sizeof(ReplicationEvent);
+    addr = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        return false;
+    }
+    _header = static_cast<ReplicationHeader*>(addr);
+    _events = reinterpret_cast<ReplicationEvent*>(static_cast<char*>(addr) + EVENTS_OFFSET);
+    _mask = capacity - 1;
+    _bytes = bytes;
+    return true;
+}
+
+size_t StandbyReplica::poll() {
+    size_t count = 0;
+    while (!_lapped) {
+        const ReplicationEvent& entry = _log._events[_applied & _log._mask];
+        uint64_t sequence = entry.sequence.load(std::memory_order_acquire);
+        if (sequence != _applied + 1) {
+            // Not published yet, or being written; further ahead, the primary lapped us
+            _lapped = _log.head() > _applied + _log._mask;
+            break;
+        }
+
+        // Copy out, then check the primary didn't overwrite it meanwhile
+        ReplicationEvent event;
+        event.type = entry.type;
+        std::memcpy(&event.order, &entry.order, sizeof(event.order));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (entry.sequence.load(std::memory_order_relaxed) != sequence) {
+            _lapped = true;
+            break;
+        }
+
+        apply(event);
+        _applied++;
+        count++;
+    }
+    if (count > 0) {
+        _log._header->applied.store(_applied, std::memory_order_release);
+    }
+    return count;
+}
+
+void StandbyReplica::apply(const ReplicationEvent& event) {
+    switch (event.type) {
+        case ReplicationType::MATCH:
+            _engine.match(event.order);
+            break;
+        case ReplicationType::REPLACE:
+            _engine.replace(event.order);
+            break;
+        case ReplicationType::CANCEL:
+            _engine.cancel_order(event.target.order_id);
+            break;
+        case ReplicationType::REDUCE:
+            _engine.reduce(event.target.order_id, event.target.volume);
+            break;
+        case ReplicationType::MASS_CANCEL:
+            _engine.mass_cancel(event.range.owner, event.range.side, event.range.min_price, event.range.max_price);
+            break;
+        case ReplicationType::ADVANCE_CLOCK:
+            _engine.advance_clock(event.now);
+            break;
+        case ReplicationType::SET_AUCTION:
+            _engine.set_auction(event.auction != 0);
+            break;
+        case ReplicationType::UNCROSS:
+            _engine.uncross(event.reference_price);
+            break;
+        case ReplicationType::HASH:
+            _hash_checks++;
+            _hash_mismatches += _engine.order_book().hash() != event.hash;
+            break;
+    }
+}
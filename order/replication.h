@@ -0,0 +1,154 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "order.h"
+
+class MatchingEngine;
+
+enum class ReplicationType : uint32_t {
+    MATCH,          // order
+    REPLACE,        // order
+    CANCEL,         // target.order_id
+    REDUCE,         // target.order_id, target.volume
+    MASS_CANCEL,    // range
+    ADVANCE_CLOCK,  // now
+    SET_AUCTION,    // auction
+    UNCROSS,        // reference_price
+    HASH,           // hash
+};
+
+// One engine input per cache line, in the shared memory ring of a ReplicationLog.
+struct alignas(64) ReplicationEvent {
+    std::atomic<uint64_t> sequence;  // Position + 1 once written, 0 while being overwritten
+    ReplicationType type;
+    union {
+        Order order;
+        struct {
+            uint32_t order_id;
+            uint32_t volume;
+        } target;
+        struct {
+            uint32_t owner;
+            Side side;
+            int32_t min_price;
+            int32_t max_price;
+        } range;
+        uint64_t now;
+        uint8_t auction;
+        int32_t reference_price;
+        uint64_t hash;  // OrderBook::hash once every earlier event is applied
+    };
+
+    ReplicationEvent() : sequence(0), type(ReplicationType::HASH), hash(0) {}
+};
+
+// Shared memory header of a ReplicationLog, followed by the event ring.
+struct ReplicationHeader {
+    static constexpr uint64_t MAGIC = 0x31474F4C4C504552ull;  // "REPLLOG1"
+    static constexpr uint32_t VERSION = 1;
+
+    uint64_t magic;
+    uint32_t version;
+    uint32_t capacity;                         // Events in the ring, a power of 2
+    alignas(64) std::atomic<uint64_t> head;    // Events published by the primary
+    alignas(64) std::atomic<uint64_t> applied; // Events applied by the standby
+    std::atomic<uint32_t> promote;             // Set by the promotion command
+};
+
+// Inputs of a primary MatchingEngine, in order, in a POSIX shared memory ring for a standby
+// process running its own engine in lockstep (see StandbyReplica).
+// The primary publishes and moves on, it never waits: a standby that falls a whole ring behind
+// finds out from the event sequence numbers and can no longer be promoted.
+class ReplicationLog {
+public:
+    static constexpr size_t DEFAULT_CAPACITY = 1 << 18;  // 16MB of events
+
+    ReplicationLog() = default;
+
+    ~ReplicationLog();
+
+    ReplicationLog(const ReplicationLog&) = delete;
+    ReplicationLog& operator=(const ReplicationLog&) = delete;
+
+    // Primary: create the log name (replacing a stale one) with capacity events (a power of 2).
+    // The log is unlinked when this object goes away. Return false on failure.
+    bool create(const char* name, size_t capacity = DEFAULT_CAPACITY);
+
+    // Standby or promotion command: map the existing log name. Return false if there is none.
+    bool open(const char* name);
+
+    // Primary: claim the next event and fill it, then end_event publishes it.
+    ReplicationEvent& begin_event(ReplicationType type) {
+        ReplicationEvent& event = _events[_position & _mask];
+        // Invalidate first: a standby reading the previous lap sees the change
+        event.sequence.store(0, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        event.type = type;
+        return event;
+    }
+
+    void end_event(ReplicationEvent& event) {
+        ++_position;
+        event.sequence.store(_position, std::memory_order_release);
+        _header->head.store(_position, std::memory_order_release);
+    }
+
+    // Events published so far.
+    uint64_t head() const { return _header->head.load(std::memory_order_acquire); }
+
+    // Events the standby applied so far.
+    uint64_t applied() const { return _header->applied.load(std::memory_order_acquire); }
+
+    size_t capacity() const { return _mask + 1; }
+
+    // Promotion command: ask the standby to take over once it applied everything published.
+    void request_promotion() { _header->promote.store(1, std::memory_order_release); }
+
+    bool promotion_requested() const { return _header->promote.load(std::memory_order_acquire) != 0; }
+
+private:
+    friend class StandbyReplica;
+
+    ReplicationHeader* _header = nullptr;
+    ReplicationEvent* _events = nullptr;
+    size_t _mask = 0;
+    size_t _bytes = 0;
+    uint64_t _position = 0;  // Primary local copy of head
+    char _name[64] = {};
+    bool _owner = false;
+};
+
+// Standby side of a ReplicationLog: applies the primary's inputs to engine, in the same order,
+// so both books stay identical, and checks that against the primary's periodic book hashes.
+// Used from a single thread. The standby engine's callbacks see the same reports as the primary's.
+class StandbyReplica {
+public:
+    StandbyReplica(ReplicationLog& log, MatchingEngine& engine) : _log(log), _engine(engine) {}
+
+    // Apply every event published so far, return the number applied.
+    size_t poll();
+
+    // Events applied so far.
+    uint64_t applied() const { return _applied; }
+
+    uint64_t hash_checks() const { return _hash_checks; }
+
+    uint64_t hash_mismatches() const { return _hash_mismatches; }
+
+    // Lapped by the primary: events were lost, nothing is applied anymore.
+    bool lapped() const { return _lapped; }
+
+    // Safe to promote: nothing lost and every hash matched.
+    bool in_sync() const { return !_lapped && _hash_mismatches == 0; }
+
+private:
+    void apply(const ReplicationEvent& event);
+
+    ReplicationLog& _log;
+    MatchingEngine& _engine;
+    uint64_t _applied = 0;
+    uint64_t _hash_checks = 0;
+    uint64_t _hash_mismatches = 0;
+    bool _lapped = false;
+};
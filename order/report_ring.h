@@ -0,0 +1,187 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "arena.h"
+#include "reports.h"
+
+enum class ReportType : uint32_t {
+    FILL,
+    ACK,
+    CANCEL
+};
+
+// One report per cache line: consumers reading entry n don't contend with the engine writing n + 1.
+struct alignas(64) ExecutionReport {
+    std::atomic<uint64_t> sequence;  // Position + 1 once written, 0 while being overwritten
+    ReportType type;
+    union {
+        FillReport fill;
+        AckReport ack;
+        CancelReport cancel;
+    };
+};
+
+// Single producer, multi consumer broadcast ring of execution reports.
+// The engine publishes and moves on, it never waits for a consumer: a consumer that falls a whole
+// ring behind is lapped, and finds out from the entry sequence numbers. Consumers read entries in
+// place and track their own cursor, published so slow ones can be spotted before they are lapped.
+class ReportRing {
+public:
+    static constexpr size_t MAX_CONSUMERS = 16;
+
+    // capacity: a power of 2.
+    ReportRing(Arena& arena, size_t capacity)
+        : _entries(arena.create<ExecutionReport>(capacity)), _mask(capacity - 1) {}
+
+    void publish(const FillReport& fill) {
+        ExecutionReport& entry = begin_entry(ReportType::FILL);
+        entry.fill = fill;
+        end_entry(entry);
+    }
+
+    void publish(const AckReport& ack) {
+        ExecutionReport& entry = begin_entry(ReportType::ACK);
+        entry.ack = ack;
+        end_entry(entry);
+    }
+
+    void publish(const CancelReport& cancel) {
+        ExecutionReport& entry = begin_entry(ReportType::CANCEL);
+        entry.cancel = cancel;
+        end_entry(entry);
+    }
+
+    // Reports published so far.
+    uint64_t head() const { return _head.load(std::memory_order_acquire); }
+
+    size_t capacity() const { return _mask + 1; }
+
+    // Claim a consumer cursor starting at the current head, -1 if all are taken.
+    int add_consumer() {
+        for (size_t i = 0; i < MAX_CONSUMERS; ++i) {
+            bool expected = false;
+            if (_consumers[i].active.compare_exchange_strong(expected, true, std::memory_order_acq_rel)) {
+                _consumers[i].cursor.store(head(), std::memory_order_release);
+                return static_cast<int>(i);
+            }
+        }
+        return -1;
+    }
+
+    void remove_consumer(int id) {
+        _consumers[id].active.store(false, std::memory_order_release);
+    }
+
+    // Reports published but not yet consumed by consumer id.
+    uint64_t lag(int id) const {
+        return head() - _consumers[id].cursor.load(std::memory_order_acquire);
+    }
+
+    // Bit i set if consumer i is more than threshold reports behind. Meant for a monitor thread,
+    // the engine never scans cursors.
+    uint32_t slow_consumers(uint64_t threshold) const {
+        uint32_t slow = 0;
+        for (size_t i = 0; i < MAX_CONSUMERS; ++i) {
+            if (_consumers[i].active.load(std::memory_order_acquire) && lag(static_cast<int>(i)) > threshold) {
+                slow |= 1u << i;
+            }
+        }
+        return slow;
+    }
+
+private:
+    friend class ReportReader;
+
+    struct alignas(64) Consumer {
+        std::atomic<uint64_t> cursor{0};
+        std::atomic<bool> active{false};
+    };
+
+    ExecutionReport& begin_entry(ReportType type) {
+        ExecutionReport& entry = _entries[_position & _mask];
+        // Invalidate first: a consumer reading the previous lap sees the change
+        entry.sequence.store(0, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        entry.type = type;
+        return entry;
+    }
+
+    void end_entry(ExecutionReport& entry) {
+        ++_position;
+        entry.sequence.store(_position, std::memory_order_release);
+        _head.store(_position, std::memory_order_release);
+    }
+
+    ExecutionReport* _entries;
+    size_t _mask;
+    uint64_t _position = 0;  // Producer local copy of head
+    alignas(64) std::atomic<uint64_t> _head{0};
+    Consumer _consumers[MAX_CONSUMERS];
+};
+
+// One consumer of a ReportRing, used from a single thread.
+class ReportReader {
+public:
+    explicit ReportReader(ReportRing& ring) : _ring(ring), _id(ring.add_consumer()) {
+        _cursor = _id >= 0 ? ring._consumers[_id].cursor.load(std::memory_order_relaxed) : 0;
+    }
+
+    ~ReportReader() {
+        if (_id >= 0) {
+            _ring.remove_consumer(_id);
+        }
+    }
+
+    ReportReader(const ReportReader&) = delete;
+    ReportReader& operator=(const ReportReader&) = delete;
+
+    // False if the ring had no free consumer slot.
+    bool attached() const { return _id >= 0; }
+
+    // Next report, read in place, nullptr if none is published yet. If the reader was lapped,
+    // skip to the oldest report still in the ring and count the ones missed in lost().
+    const ExecutionReport* next() {
+        const ExecutionReport& entry = _ring._entries[_cursor & _ring._mask];
+        uint64_t sequence = entry.sequence.load(std::memory_order_acquire);
+        if (sequence == _cursor + 1) {
+            return &entry;
+        }
+
+        uint64_t head = _ring.head();
+        if (head <= _cursor + _ring._mask) {
+            return nullptr;  // Not published yet, or being written
+        }
+
+        // Lapped: resync one entry ahead of the producer's next overwrite
+        uint64_t oldest = head - _ring._mask;
+        _lost += oldest - _cursor;
+        _cursor = oldest;
+        return next();
+    }
+
+    // Done with the report returned by next(). Return false if the producer overwrote it
+    // meanwhile: whatever was read from it must be discarded.
+    bool release() {
+        const ExecutionReport& entry = _ring._entries[_cursor & _ring._mask];
+        std::atomic_thread_fence(std::memory_order_acquire);
+        bool intact = entry.sequence.load(std::memory_order_relaxed) == _cursor + 1;
+        if (!intact) {
+            _lost++;
+        }
+        _cursor++;
+        _ring._consumers[_id].cursor.store(_cursor, std::memory_order_release);
+        return intact;
+    }
+
+    // Reports overwritten before this reader got to them.
+    uint64_t lost() const { return _lost; }
+
+    uint64_t cursor() const { return _cursor; }
+
+private:
+    ReportRing& _ring;
+    int _id;
+    uint64_t _cursor;
+    uint64_t _lost = 0;
+};
@@ -0,0 +1,23 @@
+#pragma once
+#include <cstdint>
+#include "order.h"
+
+struct FillReport {
+    uint32_t taker_order_id;
+    uint32_t maker_order_id;
+    int32_t  traded_price;
+    uint32_t traded_volume; // min of taker volume and maker volume
+};
+
+struct AckReport {
+    uint32_t order_id;
+    uint64_t order_timestamp;
+    int32_t  order_price;
+    uint32_t remaining_volume; // <= order volume
+    Side     order_side;
+};
+
+struct CancelReport {
+    uint32_t order_id;
+    uint32_t cancelled_volume;
+};
@@ -1,12 +1,45 @@
 #include "order.h"
 #include "orderbook.h"
 #include "matching_engine.h"
+#include "book_builder.h"
+#include "trade_analytics.h"
 #include <iostream>
 #include <cassert>
 #include <vector>
+#include <algorithm>
+#include <map>
+#include <random>
+#include <new>
+#include <cstdlib>
+#include <thread>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <sched.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
 MatchingEngine engine;
 
+// 统计堆分配次数，用于检查预热后撮合路径不再分配内存
+static size_t heap_allocations = 0;
+
+void* operator new(size_t size) {
+    heap_allocations++;
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+
 // struct Order {
 //     Order(uint32_t id, uint32_t ts, int32_t pr, uint32_t vol, Side sd)
 //         : id(id), timestamp(ts), price(pr), volume(vol), side(sd) {}
@@ -75,6 +108,1007 @@ void run_time_priority_test() {
     std::cout << "[PASSED] Time priority test.\n";
 }
 
+// 从所有tier的活跃槽位暴力重建某一侧的价位聚合
+std::map<int32_t, std::pair<uint32_t, uint32_t>> rebuild_levels(OrderBook& book, Side side) {
+    std::map<int32_t, std::pair<uint32_t, uint32_t>> levels;
+    for (size_t t = 0; t < OrderBook::MAX_TIERS; ++t) {
+        OrderBook::Tier& tier = book.get_tier(t);
+        for (size_t i = 0; i < OrderBook::SLOTS_PER_SIDE; ++i) {
+            if ((tier.active_mask(side) >> i) & 1) {
+                auto& level = levels[tier.hot(side).prices[i]];
+                level.first += tier.hot(side).volumes[i];
+                level.second += 1;
+            }
+        }
+    }
+    return levels;
+}
+
+void run_depth_test() {
+    MatchingEngine local;
+    assert(local.match(Order{1, 1, 1000, 5, Side::BID}));
+    assert(local.match(Order{2, 2, 1000, 3, Side::BID}));
+    assert(local.match(Order{3, 3, 998, 2, Side::BID}));
+    assert(local.match(Order{4, 4, 1010, 4, Side::ASK}));
+    assert(local.match(Order{5, 5, 1012, 1, Side::ASK}));
+
+    DepthLevel bids[10], asks[10];
+    auto [nb, na] = local.order_book().get_depth(10, bids, asks);
+    assert(nb == 2 && na == 2);
+    assert(bids[0].price == 1000 && bids[0].volume == 8 && bids[0].order_count == 2);
+    assert(bids[1].price == 998 && bids[1].volume == 2 && bids[1].order_count == 1);
+    assert(asks[0].price == 1010 && asks[0].volume == 4 && asks[0].order_count == 1);
+    assert(asks[1].price == 1012 && asks[1].volume == 1 && asks[1].order_count == 1);
+
+    // 卖单吃掉订单1全部和订单2的一部分
+    assert(local.match(Order{6, 6, 1000, 6, Side::ASK}));
+    std::tie(nb, na) = local.order_book().get_depth(10, bids, asks);
+    assert(nb == 2 && bids[0].price == 1000 && bids[0].volume == 2 && bids[0].order_count == 1);
+
+    // 撤单与减量
+    assert(local.cancel_order(3));
+    assert(local.order_book().reduce(4, 1));
+    std::tie(nb, na) = local.order_book().get_depth(1, bids, asks);
+    assert(nb == 1 && na == 1);
+    assert(bids[0].price == 1000 && asks[0].price == 1010 && asks[0].volume == 3);
+
+    // 大量撤单扰动后，聚合结果必须与暴力重建一致
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> price_dist(960, 1040);
+    std::uniform_int_distribution<int> volume_dist(1, 10);
+    std::vector<uint32_t> live;
+    for (uint32_t id = 100; id < 20000; ++id) {
+        if (!live.empty() && rng() % 2 == 0) {
+            size_t k = rng() % live.size();
+            local.cancel_order(live[k]);
+            live[k] = live.back();
+            live.pop_back();
+        }
+        Side side = rng() % 2 ? Side::BID : Side::ASK;
+        if (local.match(Order{id, id, price_dist(rng), static_cast<uint32_t>(volume_dist(rng)), side})) {
+            live.push_back(id);
+        }
+    }
+
+    DepthLevel all_bids[OrderBook::MAX_LEVELS], all_asks[OrderBook::MAX_LEVELS];
+    std::tie(nb, na) = local.order_book().get_depth(OrderBook::MAX_LEVELS, all_bids, all_asks);
+    auto expect_bids = rebuild_levels(local.order_book(), Side::BID);
+    auto expect_asks = rebuild_levels(local.order_book(), Side::ASK);
+    assert(nb == expect_bids.size() && na == expect_asks.size());
+
+    size_t i = 0;
+    for (auto it = expect_bids.rbegin(); it != expect_bids.rend(); ++it, ++i) {
+        assert(all_bids[i].price == it->first);
+        assert(all_bids[i].volume == it->second.first && all_bids[i].order_count == it->second.second);
+    }
+    i = 0;
+    for (auto it = expect_asks.begin(); it != expect_asks.end(); ++it, ++i) {
+        assert(all_asks[i].price == it->first);
+        assert(all_asks[i].volume == it->second.first && all_asks[i].order_count == it->second.second);
+    }
+
+    std::cout << "[PASSED] Depth of book test.\n";
+}
+
+void run_mass_cancel_test() {
+    MatchingEngine local;
+    std::vector<CancelReport> cancels;
+    local.on_cancel = [&](const CancelReport& report) {
+        cancels.push_back(report);
+    };
+
+    // 会话1和会话2各自挂单
+    assert(local.match(Order{1, 1, 990, 5, Side::BID, 1}));
+    assert(local.match(Order{2, 2, 995, 6, Side::BID, 1}));
+    assert(local.match(Order{3, 3, 1000, 7, Side::BID, 2}));
+    assert(local.match(Order{4, 4, 960, 8, Side::BID, 1}));
+    assert(local.match(Order{5, 5, 1010, 9, Side::ASK, 1}));
+
+    // 只撤会话1在[990, 1000]内的买单
+    assert(local.mass_cancel(1, Side::BID, 990, 1000) == 2);
+    assert(cancels.size() == 2);
+    uint32_t cancelled_volume = cancels[0].cancelled_volume + cancels[1].cancelled_volume;
+    assert(cancelled_volume == 11);
+
+    assert(!local.cancel_order(1));
+    assert(!local.cancel_order(2));
+
+    DepthLevel bids[10], asks[10];
+    auto [nb, na] = local.order_book().get_depth(10, bids, asks);
+    assert(nb == 2 && bids[0].price == 1000 && bids[1].price == 960);
+    assert(na == 1 && asks[0].price == 1010);
+
+    // 断线：撤掉会话1全部订单
+    assert(local.mass_cancel(1, Side::BID, 0, INT32_MAX) == 1);
+    assert(local.mass_cancel(1, Side::ASK, 0, INT32_MAX) == 1);
+    assert(cancels.size() == 4);
+    assert(local.order_book().get_top_of_book() == std::make_pair(1000, 0));
+
+    std::cout << "[PASSED] Mass cancel test.\n";
+}
+
+// 检查每个tier每一侧的活跃槽位是前缀，并且按价格-时间优先级排列
+void check_priority_invariant(OrderBook& book) {
+    for (size_t t = 0; t < OrderBook::MAX_TIERS; ++t) {
+        OrderBook::Tier& tier = book.get_tier(t);
+        for (Side side : {Side::BID, Side::ASK}) {
+            size_t count = tier.count(side);
+            assert(tier.active_mask(side) == (1u << count) - 1);
+            for (size_t i = 1; i < count; ++i) {
+                int32_t prev = tier.hot(side).prices[i - 1], cur = tier.hot(side).prices[i];
+                assert(side == Side::BID ? prev >= cur : prev <= cur);
+                if (prev == cur) {
+                    assert(tier.cold(side).timestamps[i - 1] <= tier.cold(side).timestamps[i]);
+                }
+            }
+        }
+    }
+}
+
+void run_priority_order_test() {
+    MatchingEngine local;
+    std::vector<FillReport> fills;
+    local.on_fill = [&](const FillReport& report) {
+        fills.push_back(report);
+    };
+
+    // 乱序挂卖单，槽位应按价格-时间排列
+    assert(local.match(Order{1, 1, 1003, 1, Side::ASK}));
+    assert(local.match(Order{2, 2, 1001, 1, Side::ASK}));
+    assert(local.match(Order{3, 3, 1002, 1, Side::ASK}));
+    assert(local.match(Order{4, 4, 1001, 1, Side::ASK}));
+    check_priority_invariant(local.order_book());
+
+    // 撤掉中间的订单后仍然是前缀
+    assert(local.cancel_order(3));
+    check_priority_invariant(local.order_book());
+
+    // 买单按 2 -> 4 -> 1 的顺序成交
+    assert(local.match(Order{5, 5, 1003, 3, Side::BID}));
+    assert(fills.size() == 3);
+    assert(fills[0].maker_order_id == 2 && fills[1].maker_order_id == 4 && fills[2].maker_order_id == 1);
+
+    // 随机订单流与朴素的价格-时间撮合模型对比
+    struct RefOrder { uint32_t id; uint64_t ts; int32_t price; uint32_t volume; };
+    std::vector<RefOrder> ref[2];
+    std::vector<FillReport> expected;
+
+    std::mt19937 rng(11);
+    std::uniform_int_distribution<int> price_dist(990, 1010);
+    std::uniform_int_distribution<int> volume_dist(1, 10);
+    fills.clear();
+
+    for (uint32_t id = 100; id < 20000; ++id) {
+        // 控制挂单数量，保证不会因tier写满而拒单
+        for (auto& orders : ref) {
+            while (orders.size() > OrderBook::SLOTS_PER_SIDE / 2) {
+                size_t k = rng() % orders.size();
+                assert(local.cancel_order(orders[k].id));
+                orders.erase(orders.begin() + k);
+            }
+        }
+
+        Order o{id, id, price_dist(rng), static_cast<uint32_t>(volume_dist(rng)), rng() % 2 ? Side::BID : Side::ASK};
+        auto& makers = ref[o.side == Side::BID ? 1 : 0];
+        std::stable_sort(makers.begin(), makers.end(), [&](const RefOrder& a, const RefOrder& b) {
+            if (a.price != b.price) return o.side == Side::BID ? a.price < b.price : a.price > b.price;
+            return a.ts < b.ts;
+        });
+
+        uint32_t remaining = o.volume;
+        for (auto it = makers.begin(); it != makers.end() && remaining > 0; ) {
+            bool crosses = o.side == Side::BID ? it->price <= o.price : it->price >= o.price;
+            if (!crosses) break;
+            uint32_t traded = std::min(remaining, it->volume);
+            expected.push_back({o.id, it->id, it->price, traded});
+            remaining -= traded;
+            it->volume -= traded;
+            it = it->volume == 0 ? makers.erase(it) : it + 1;
+        }
+        if (remaining > 0) {
+            ref[static_cast<size_t>(o.side)].push_back({o.id, o.timestamp, o.price, remaining});
+        }
+
+        assert(local.match(o));
+        check_priority_invariant(local.order_book());
+    }
+
+    assert(fills.size() == expected.size());
+    for (size_t i = 0; i < fills.size(); ++i) {
+        assert(fills[i].maker_order_id == expected[i].maker_order_id);
+        assert(fills[i].traded_price == expected[i].traded_price);
+        assert(fills[i].traded_volume == expected[i].traded_volume);
+    }
+
+    std::cout << "[PASSED] Price-time priority order test.\n";
+}
+
+void run_no_allocation_test() {
+    Arena arena(OrderBook::arena_bytes());
+    MatchingEngine local(&arena);
+    size_t fills = 0, cancels = 0;
+    local.on_fill = [&](const FillReport&) { fills++; };
+    local.on_cancel = [&](const CancelReport&) { cancels++; };
+
+    std::mt19937 rng(5);
+    std::vector<uint32_t> resting;
+    resting.reserve(200000);
+
+    // 预热之后，撮合、撤单、批量撤单都不应再分配堆内存
+    size_t before = heap_allocations;
+    for (uint32_t id = 1; id < 200000; ++id) {
+        Order o{id, id, static_cast<int32_t>(990 + rng() % 20), static_cast<uint32_t>(1 + rng() % 10), rng() % 2 ? Side::BID : Side::ASK};
+        if (local.match(o)) {
+            resting.push_back(id);
+        }
+        if (rng() % 3 == 0 && !resting.empty()) {
+            size_t k = rng() % resting.size();
+            local.cancel_order(resting[k]);
+            resting[k] = resting.back();
+            resting.pop_back();
+        }
+        if (id % 1000 == 0) {
+            local.mass_cancel(0, Side::BID, 0, 2000);
+        }
+    }
+    assert(heap_allocations == before);
+    assert(fills > 0 && cancels > 0);
+
+    // 索引中的订单都能在tier中找到
+    OrderBook& book = local.order_book();
+    size_t lanes = 0;
+    for (size_t t = 0; t < OrderBook::MAX_TIERS; ++t) {
+        for (Side side : {Side::BID, Side::ASK}) {
+            OrderBook::Tier& tier = book.get_tier(t);
+            for (size_t i = 0; i < tier.count(side); ++i) {
+                const OrderIndex::Entry* entry = book.get_map().find(tier.cold(side).order_ids[i]);
+                assert(entry && entry->tier == t && entry->side == static_cast<uint32_t>(side));
+                lanes++;
+            }
+        }
+    }
+    assert(lanes == book.get_map().size());
+
+    std::cout << "[PASSED] No allocation after warm-up test.\n";
+}
+
+void run_report_ring_test() {
+    Arena arena(1 << 20);
+    ReportRing ring(arena, 64);
+    MatchingEngine local(&arena);
+    local.set_report_ring(&ring);
+
+    // 回调里记录 (类型, 订单号)，与环形缓冲区中的回报逐条对比
+    std::vector<std::pair<ReportType, uint32_t>> expected;
+    local.on_fill = [&](const FillReport& r) { expected.push_back({ReportType::FILL, r.maker_order_id}); };
+    local.on_ack = [&](const AckReport& r) { expected.push_back({ReportType::ACK, r.order_id}); };
+    local.on_cancel = [&](const CancelReport& r) { expected.push_back({ReportType::CANCEL, r.order_id}); };
+
+    auto report_id = [](const ExecutionReport& r) {
+        return r.type == ReportType::FILL ? r.fill.maker_order_id
+             : r.type == ReportType::ACK ? r.ack.order_id : r.cancel.order_id;
+    };
+
+    ReportReader fast(ring), slow(ring);
+    assert(fast.attached() && slow.attached());
+
+    std::mt19937 rng(9);
+    size_t checked = 0;
+    for (uint32_t id = 1; id < 2000; ++id) {
+        local.match(Order{id, id, static_cast<int32_t>(995 + rng() % 10), static_cast<uint32_t>(1 + rng() % 5), rng() % 2 ? Side::BID : Side::ASK});
+        if (rng() % 4 == 0) {
+            local.cancel_order(id - rng() % 10);
+        }
+
+        // 快消费者每步读完，原地读取的内容与回调一致
+        while (const ExecutionReport* r = fast.next()) {
+            assert(r->type == expected[checked].first && report_id(*r) == expected[checked].second);
+            assert(fast.release());
+            checked++;
+        }
+        assert(checked == expected.size());
+        assert(ring.lag(0) == 0);
+    }
+    assert(fast.lost() == 0);
+
+    // 慢消费者从未读取：被检测为慢，读取时发现被套圈，跳到仍在环中的最早回报
+    assert(ring.slow_consumers(ring.capacity() / 2) == 0b10);
+    size_t read = 0;
+    while (const ExecutionReport* r = slow.next()) {
+        size_t k = slow.cursor();
+        assert(r->type == expected[k].first && report_id(*r) == expected[k].second);
+        assert(slow.release());
+        read++;
+    }
+    assert(slow.lost() > 0);
+    assert(slow.lost() + read == expected.size());
+    assert(ring.slow_consumers(0) == 0);
+
+    // 另一线程上的消费者：序号连续，读到的加丢失的等于发布总数
+    ReportRing threaded_ring(arena, 1024);
+    local.set_report_ring(&threaded_ring);
+    local.on_fill = nullptr;
+    local.on_ack = nullptr;
+    local.on_cancel = nullptr;
+
+    std::atomic<bool> done{false};
+    std::atomic<bool> ready{false};
+    uint64_t consumed = 0, lost = 0;
+    std::thread consumer([&] {
+        ReportReader reader(threaded_ring);
+        ready.store(true, std::memory_order_release);
+        uint64_t last = 0;
+        while (true) {
+            bool finished = done.load(std::memory_order_acquire);
+            const ExecutionReport* r = reader.next();
+            if (!r) {
+                if (finished) break;
+                continue;
+            }
+            uint64_t sequence = r->sequence.load(std::memory_order_relaxed);
+            if (reader.release()) {
+                assert(sequence > last);
+                last = sequence;
+                consumed++;
+            }
+        }
+        lost = reader.lost();
+    });
+    while (!ready.load(std::memory_order_acquire)) {
+        std::this_thread::yield();
+    }
+    for (uint32_t id = 10000; id < 200000; ++id) {
+        local.match(Order{id, id, static_cast<int32_t>(995 + rng() % 10), static_cast<uint32_t>(1 + rng() % 5), rng() % 2 ? Side::BID : Side::ASK});
+        if (rng() % 4 == 0) {
+            local.cancel_order(id - rng() % 10);
+        }
+    }
+    done.store(true, std::memory_order_release);
+    consumer.join();
+    assert(consumed + lost == threaded_ring.head());
+
+    std::cout << "[PASSED] Report ring test.\n";
+}
+
+void run_book_builder_test() {
+    Arena arena(BookBuilder::arena_bytes(3));
+    BookBuilder builder(3, &arena);
+
+    // 行情里的委托已由交易所撮合：交叉的买卖单都挂在簿上，不产生成交
+    assert(builder.add(0, Order{1, 0, 50, 10, Side::BID}));
+    assert(builder.add(0, Order{2, 0, 45, 7, Side::ASK}));
+    assert(builder.add(0, Order{3, 0, 50, 4, Side::BID}));
+    assert(builder.top_of_book(0) == std::make_pair(50, 45));
+    assert(builder.top_of_book(0) == builder.book(0).get_top_of_book());
+
+    // 同一订单号在不同品种互不影响
+    assert(builder.add(1, Order{1, 0, 30, 5, Side::ASK}));
+    assert(builder.top_of_book(1) == std::make_pair(0, 30));
+    assert(builder.top_of_book(2) == std::make_pair(0, 0));
+    assert(!builder.add(3, Order{1, 0, 30, 5, Side::ASK}));
+
+    // 成交与部分撤单按订单号减量，量不够时拒绝
+    assert(builder.execute(0, 1, 6));
+    assert(!builder.execute(0, 1, 5));
+    assert(builder.cancel(0, 1, 1));
+    DepthLevel bids[4], asks[4];
+    auto [bid_count, ask_count] = builder.book(0).get_depth(4, bids, asks);
+    assert(bid_count == 1 && ask_count == 1);
+    assert(bids[0].price == 50 && bids[0].volume == 7 && bids[0].order_count == 2);
+
+    // 先到的订单排在前面
+    Order first, second;
+    assert(builder.book(0).find(1, first) && builder.book(0).find(3, second));
+    assert(first.timestamp < second.timestamp);
+
+    // 成交到零即移出；删除整单
+    assert(builder.execute(0, 1, 3));
+    assert(!builder.book(0).find(1, first));
+    assert(!builder.remove(0, 1));
+    assert(builder.remove(0, 2));
+    assert(builder.top_of_book(0) == std::make_pair(50, 0));
+    assert(builder.book(0).get_map().size() == 1);
+    assert(builder.book(1).get_map().size() == 1);
+
+    // 与逐价位重建的结果对比
+    std::mt19937 rng(21);
+    std::map<uint32_t, Order> live[3];
+    live[0][3] = Order{3, 0, 50, 4, Side::BID};
+    live[1][1] = Order{1, 0, 30, 5, Side::ASK};
+    for (uint32_t id = 100; id < 20000; ++id) {
+        uint16_t instrument = rng() % 3;
+        uint32_t action = rng() % 4;
+        auto& orders = live[instrument];
+        if (action < 2 || orders.empty()) {
+            Order o{id, 0, static_cast<int32_t>(1 + rng() % 79), static_cast<uint32_t>(1 + rng() % 9), rng() % 2 ? Side::BID : Side::ASK};
+            if (builder.add(instrument, o)) {
+                orders[id] = o;
+            }
+            continue;
+        }
+        auto it = orders.lower_bound(rng() % id);
+        if (it == orders.end()) {
+            it = orders.begin();
+        }
+        uint32_t volume = 1 + rng() % it->second.volume;
+        bool removed = action == 3 ? builder.remove(instrument, it->first)
+                                   : builder.execute(instrument, it->first, volume);
+        assert(removed);
+        if (action == 3 || volume == it->second.volume) {
+            orders.erase(it);
+        } else {
+            it->second.volume -= volume;
+        }
+    }
+    for (uint16_t instrument = 0; instrument < 3; ++instrument) {
+        std::map<int32_t, uint32_t> expected_bids, expected_asks;
+        for (auto& [id, o] : live[instrument]) {
+            (o.side == Side::BID ? expected_bids : expected_asks)[o.price] += o.volume;
+        }
+        const OrderBook::PriceLevels& levels = builder.book(instrument).get_levels();
+        assert(levels.bids.size == expected_bids.size() && levels.asks.size == expected_asks.size());
+        size_t i = 0;
+        for (auto& [price, volume] : expected_bids) {
+            assert(levels.bids.prices[i] == price && levels.bids.volumes[i] == volume);
+            i++;
+        }
+        i = levels.asks.size;
+        for (auto& [price, volume] : expected_asks) {
+            i--;
+            assert(levels.asks.prices[i] == price && levels.asks.volumes[i] == volume);
+        }
+        assert(builder.book(instrument).get_map().size() == live[instrument].size());
+        assert(builder.top_of_book(instrument) == builder.book(instrument).get_top_of_book());
+    }
+
+    std::cout << "[PASSED] Book builder test.\n";
+}
+
+void run_queue_position_test() {
+    MatchingEngine local;
+    OrderBook& book = local.order_book();
+
+    // 价格 50 上按时间排队：1、2 在前，3 是我们的单，5 在后；51 的买单不算在同价队列里
+    assert(local.match(Order{1, 1, 50, 5, Side::BID}));
+    assert(local.match(Order{2, 2, 50, 3, Side::BID}));
+    assert(local.match(Order{3, 3, 50, 4, Side::BID}));
+    assert(local.match(Order{4, 4, 51, 9, Side::BID}));
+    assert(local.match(Order{5, 5, 50, 2, Side::BID}));
+
+    uint32_t orders_ahead, volume_ahead;
+    assert(book.queue_position(3, orders_ahead, volume_ahead));
+    assert(orders_ahead == 2 && volume_ahead == 8);
+    assert(book.queue_position(1, orders_ahead, volume_ahead));
+    assert(orders_ahead == 0 && volume_ahead == 0);
+
+    // 前面的单撤单、部分成交后排位前移
+    assert(local.cancel_order(1));
+    assert(book.reduce(2, 1));
+    assert(book.queue_position(3, orders_ahead, volume_ahead));
+    assert(orders_ahead == 1 && volume_ahead == 2);
+    assert(book.queue_position(5, orders_ahead, volume_ahead));
+    assert(orders_ahead == 2 && volume_ahead == 6);
+
+    // 卖单吃掉 51 和 50 上的前两笔
+    assert(local.match(Order{6, 6, 50, 12, Side::ASK}));
+    assert(book.queue_position(3, orders_ahead, volume_ahead));
+    assert(orders_ahead == 0 && volume_ahead == 0);
+    assert(!book.queue_position(2, orders_ahead, volume_ahead));
+
+    std::cout << "[PASSED] Queue position test.\n";
+}
+
+void run_auction_test() {
+    MatchingEngine local;
+    OrderBook& book = local.order_book();
+    std::vector<FillReport> fills;
+    size_t acks = 0;
+    local.on_fill = [&fills](const FillReport& r) { fills.push_back(r); };
+    local.on_ack = [&acks](const AckReport&) { acks++; };
+
+    // 集合竞价期间只挂单不撮合，即使价格交叉
+    local.set_auction(true);
+    assert(local.match(Order{1, 1, 50, 10, Side::BID}));
+    assert(local.match(Order{2, 2, 48, 5, Side::BID}));
+    assert(local.match(Order{3, 3, 46, 10, Side::BID}));
+    assert(local.match(Order{4, 4, 44, 8, Side::ASK}));
+    assert(local.match(Order{5, 5, 47, 6, Side::ASK}));
+    assert(local.match(Order{6, 6, 49, 20, Side::ASK}));
+    assert(acks == 6 && fills.empty());
+
+    // 可成交量：47、48 都是 14，剩余量都是买方多 1，按买方压力取高价 48
+    AuctionResult result = local.uncross();
+    assert(!local.in_auction());
+    assert(result.price == 48 && result.volume == 14 && result.surplus == 1);
+
+    // 买卖双方各按价格-时间优先成交，全部以 48 成交
+    assert(fills.size() == 3);
+    assert(fills[0].taker_order_id == 1 && fills[0].maker_order_id == 4 && fills[0].traded_volume == 8);
+    assert(fills[1].taker_order_id == 1 && fills[1].maker_order_id == 5 && fills[1].traded_volume == 2);
+    assert(fills[2].taker_order_id == 2 && fills[2].maker_order_id == 5 && fills[2].traded_volume == 4);
+    for (const FillReport& f : fills) {
+        assert(f.traded_price == 48);
+    }
+
+    // 剩余：买 48x1、46x10，卖 49x20
+    Order o;
+    assert(book.find(2, o) && o.volume == 1);
+    assert(!book.find(1, o) && !book.find(4, o) && !book.find(5, o));
+    DepthLevel bids[4], asks[4];
+    auto [bid_levels, ask_levels] = book.get_depth(4, bids, asks);
+    assert(bid_levels == 2 && ask_levels == 1);
+    assert(bids[0].price == 48 && bids[0].volume == 1 && bids[0].order_count == 1);
+    assert(bids[1].price == 46 && bids[1].volume == 10);
+    assert(asks[0].price == 49 && asks[0].volume == 20);
+
+    // 竞价结束后恢复连续撮合
+    fills.clear();
+    assert(local.match(Order{7, 7, 49, 5, Side::BID}));
+    assert(fills.size() == 1 && fills[0].maker_order_id == 6);
+
+    // 卖方压力取低价；未交叉的订单簿不成交
+    MatchingEngine sell;
+    sell.set_auction(true);
+    assert(sell.match(Order{1, 1, 30, 5, Side::BID}));
+    assert(sell.match(Order{2, 2, 28, 6, Side::ASK}));
+    result = sell.uncross();
+    assert(result.price == 28 && result.volume == 5 && result.surplus == -1);
+    assert(sell.uncross().volume == 0);
+
+    // 随机订单簿：成交量守恒，竞价后不再交叉，且不优于暴力搜索的最大可成交量
+    std::mt19937 rng(40);
+    for (int round = 0; round < 200; ++round) {
+        MatchingEngine random_engine;
+        uint64_t traded = 0;
+        random_engine.on_fill = [&traded](const FillReport& r) { traded += r.traded_volume; };
+        random_engine.set_auction(true);
+        std::vector<Order> orders;
+        for (uint32_t id = 1; id <= 60; ++id) {
+            Order order{id, id, static_cast<int32_t>(20 + rng() % 40), static_cast<uint32_t>(1 + rng() % 20), rng() & 1 ? Side::ASK : Side::BID};
+            if (random_engine.match(order)) {
+                orders.push_back(order);
+            }
+        }
+
+        uint64_t best = 0;
+        for (int32_t price = 20; price < 60; ++price) {
+            uint64_t demand = 0, supply = 0;
+            for (const Order& order : orders) {
+                demand += order.side == Side::BID && order.price >= price ? order.volume : 0;
+                supply += order.side == Side::ASK && order.price <= price ? order.volume : 0;
+            }
+            best = std::max(best, std::min(demand, supply));
+        }
+
+        result = random_engine.uncross();
+        assert(result.volume == best && traded == best);
+        auto [bid, ask] = random_engine.order_book().get_top_of_book();
+        assert(bid == 0 || ask == 0 || bid < ask);
+    }
+
+    std::cout << "[PASSED] Auction test.\n";
+}
+
+void run_expiry_test() {
+    MatchingEngine local;
+    OrderBook& book = local.order_book();
+    std::vector<CancelReport> cancels;
+    local.on_cancel = [&cancels](const CancelReport& r) { cancels.push_back(r); };
+
+    // 到期时间：1、2 同一档位，3 在很远的将来（跨多层时间轮），4 不过期
+    const uint64_t tick = uint64_t(1) << ExpiryWheel::TICK_SHIFT;
+    assert(local.match(Order{1, 1, 50, 5, Side::BID, 0, 10 * tick + 7}));
+    assert(local.match(Order{2, 2, 51, 3, Side::BID, 0, 10 * tick + 3}));
+    assert(local.match(Order{3, 3, 52, 4, Side::BID, 0, (uint64_t(1) << 30) * tick + 1}));
+    assert(local.match(Order{4, 4, 53, 6, Side::BID}));
+    assert(book.get_expiries().size() == 3);
+    Order o;
+    assert(book.find(1, o) && o.expiry == 10 * tick + 7);
+
+    // 时钟未到不处理；到期时间精确到时钟单位，不受 tick 粒度影响
+    assert(local.advance_clock(10 * tick + 2) == 0);
+    assert(local.advance_clock(10 * tick + 3) == 1);
+    assert(cancels.size() == 1 && cancels[0].order_id == 2 && cancels[0].cancelled_volume == 3);
+    assert(local.advance_clock(10 * tick + 7) == 1 && cancels.back().order_id == 1);
+    assert(!book.find(1, o) && !book.find(2, o));
+    assert(book.get_map().size() == 2 && book.get_tier(50 / OrderBook::TIER_GRANULARITY).count(Side::BID) == 2);
+
+    // 挂单被撤单或被吃掉时定时器一并移除
+    assert(local.match(Order{5, 5, 60, 2, Side::ASK, 0, 20 * tick}));
+    assert(local.match(Order{6, 6, 61, 2, Side::ASK, 0, 20 * tick}));
+    assert(local.cancel_order(5));
+    assert(local.match(Order{7, 7, 61, 2, Side::BID}));
+    assert(book.get_expiries().size() == 1);
+    assert(local.advance_clock(30 * tick) == 0);
+
+    // 远期订单在跨越多层后准时到期，深度同步更新
+    assert(local.advance_clock((uint64_t(1) << 30) * tick) == 0);
+    assert(local.advance_clock((uint64_t(1) << 30) * tick + 1) == 1 && cancels.back().order_id == 3);
+    DepthLevel bids[4], asks[4];
+    auto [bid_levels, ask_levels] = book.get_depth(4, bids, asks);
+    assert(bid_levels == 1 && bids[0].price == 53 && ask_levels == 0);
+    assert(book.get_expiries().size() == 0);
+
+    // 同一订单号重新挂入（另一档位）时旧定时器一并释放，不会对新订单到期
+    const uint64_t now = (uint64_t(1) << 30) * tick + 1;
+    assert(book.insert(Order{8, 8, 20, 2, Side::ASK, 0, now + 40 * tick}));
+    assert(book.insert(Order{8, 9, 70, 3, Side::ASK}));
+    assert(book.get_expiries().size() == 0);
+    assert(local.advance_clock(now + 50 * tick) == 0);
+    assert(book.find(8, o) && o.price == 70 && o.volume == 3 && o.expiry == 0);
+    assert(book.insert(Order{8, 10, 30, 1, Side::ASK, 0, now + 60 * tick}));
+    assert(book.get_expiries().size() == 1);
+    assert(local.advance_clock(now + 60 * tick) == 1 && cancels.back().order_id == 8 && cancels.back().cancelled_volume == 1);
+
+    // 随机：到期集合与暴力检查一致，同档位多单一起到期后档位仍保持价格-时间优先
+    std::mt19937 rng(41);
+    for (int round = 0; round < 50; ++round) {
+        MatchingEngine random_engine;
+        OrderBook& random_book = random_engine.order_book();
+        std::vector<uint32_t> expired;
+        random_engine.on_cancel = [&expired](const CancelReport& r) { expired.push_back(r.order_id); };
+
+        uint64_t now = 0;
+        std::vector<Order> resting;
+        uint32_t id = 1;
+        for (int step = 0; step < 400; ++step) {
+            uint32_t action = rng() % 8;
+            if (action < 4 && resting.size() < 60) {
+                uint64_t horizon = uint64_t(1) << (rng() % 48);
+                Order order{id, id, static_cast<int32_t>(rng() % 80), static_cast<uint32_t>(1 + rng() % 9), Side::BID, 0,
+                            rng() % 4 ? now + rng() % horizon : 0};
+                id++;
+                if (random_engine.match(order)) {
+                    resting.push_back(order);
+                }
+            } else if (action < 5 && !resting.empty()) {
+                size_t k = rng() % resting.size();
+                assert(random_engine.cancel_order(resting[k].id));
+                resting.erase(resting.begin() + k);
+            } else {
+                now += uint64_t(1) << (rng() % 44);
+                expired.clear();
+                size_t count = random_engine.advance_clock(now);
+                assert(count == expired.size());
+
+                std::vector<uint32_t> due;
+                for (auto it = resting.begin(); it != resting.end(); ) {
+                    if (it->expiry != 0 && it->expiry <= now) {
+                        due.push_back(it->id);
+                        it = resting.erase(it);
+                    } else {
+                        ++it;
+                    }
+                }
+                std::sort(due.begin(), due.end());
+                std::sort(expired.begin(), expired.end());
+                assert(due == expired);
+            }
+        }
+
+        size_t timed = 0;
+        for (const Order& order : resting) {
+            timed += order.expiry != 0;
+            assert(random_book.find(order.id, o) && o.volume == order.volume);
+        }
+        assert(random_book.get_map().size() == resting.size());
+        assert(random_book.get_expiries().size() == timed);
+        for (size_t t = 0; t < OrderBook::MAX_TIERS; ++t) {
+            const OrderBook::Tier& tier = random_book.get_tier(t);
+            uint32_t active = tier.active_mask(Side::BID);
+            assert((active & (active + 1)) == 0);
+            for (size_t i = 1; i < tier.count(Side::BID); ++i) {
+                assert(tier.hot(Side::BID).prices[i - 1] >= tier.hot(Side::BID).prices[i]);
+            }
+        }
+    }
+
+    std::cout << "[PASSED] Expiry test.\n";
+}
+
+// 随机输入：覆盖所有会被复制的引擎操作
+static void random_inputs(MatchingEngine& engine, std::mt19937& rng, uint32_t& id, int count) {
+    for (int i = 0; i < count; ++i) {
+        uint32_t action = rng() % 16;
+        uint32_t target = id > 1 ? 1 + rng() % (id - 1) : 0;
+        Side side = rng() & 1 ? Side::ASK : Side::BID;
+        if (action < 9) {
+            Order order{id, id, static_cast<int32_t>(30 + rng() % 20), static_cast<uint32_t>(1 + rng() % 9), side, static_cast<uint32_t>(rng() % 4), rng() % 2 ? id + rng() % 200 : 0};
+            engine.match(order);
+            id++;
+        } else if (action < 11) {
+            engine.cancel_order(target);
+        } else if (action < 12) {
+            Order resting;
+            if (engine.order_book().find(target, resting)) {
+                resting.price = static_cast<int32_t>(30 + rng() % 20);
+                resting.timestamp = id++;
+                engine.replace(resting);
+            }
+        } else if (action < 13) {
+            engine.reduce(target, 1);
+        } else if (action < 14) {
+            engine.mass_cancel(rng() % 4, side, 35, 45);
+        } else if (action < 15) {
+            engine.advance_clock(id);
+        } else {
+            engine.set_auction(true);
+            random_inputs(engine, rng, id, 10);
+            engine.uncross(40);
+        }
+    }
+}
+
+void run_replication_test() {
+    char name[64];
+    snprintf(name, sizeof(name), "/hft_test_replication_%d", static_cast<int>(getpid()));
+
+    // 同一进程内：备机按序重放主机的每个输入，周期性校验订单簿哈希
+    {
+        ReplicationLog log;
+        assert(log.create(name, 1 << 12));
+        ReplicationLog standby_log;
+        assert(standby_log.open(name));
+
+        MatchingEngine primary, standby;
+        primary.set_replication(&log, 64);
+        StandbyReplica replica(standby_log, standby);
+        size_t standby_fills = 0, primary_fills = 0;
+        primary.on_fill = [&primary_fills](const FillReport&) { primary_fills++; };
+        standby.on_fill = [&standby_fills](const FillReport&) { standby_fills++; };
+
+        std::mt19937 rng(42);
+        uint32_t id = 1;
+        for (int round = 0; round < 200; ++round) {
+            random_inputs(primary, rng, id, 10);
+            replica.poll();
+            assert(replica.applied() == log.head() && log.applied() == log.head());
+            assert(standby.order_book().hash() == primary.order_book().hash());
+        }
+        assert(replica.hash_checks() > 0 && replica.in_sync());
+        assert(standby_fills == primary_fills && primary_fills > 0);
+
+        // 备机状态被篡改后，下一次哈希校验发现不一致
+        Order resting;
+        uint32_t victim = 1;
+        while (!standby.order_book().find(victim, resting)) {
+            victim++;
+        }
+        uint32_t cancelled = 0;
+        assert(standby.order_book().cancel(victim, cancelled));
+        random_inputs(primary, rng, id, 200);
+        replica.poll();
+        assert(replica.hash_mismatches() > 0 && !replica.in_sync());
+
+        // 备机落后超过一整圈：检测到丢失，不再重放
+        MatchingEngine late;
+        ReplicationLog late_log;
+        assert(late_log.open(name));
+        StandbyReplica lapped(late_log, late);
+        assert(!lapped.lapped());
+        random_inputs(primary, rng, id, 1 << 12);
+        assert(lapped.poll() == 0 && lapped.lapped() && !lapped.in_sync());
+    }
+
+    // 两个进程：子进程作为备机跟随，直到主机发出切换命令并且全部输入都已重放
+    ReplicationLog log;
+    assert(log.create(name, 1 << 16));
+    pid_t pid = fork();
+    assert(pid >= 0);
+    if (pid == 0) {
+        ReplicationLog standby_log;
+        if (!standby_log.open(name)) {
+            _exit(2);
+        }
+        MatchingEngine standby;
+        StandbyReplica replica(standby_log, standby);
+        while (!replica.lapped()) {
+            bool promote = standby_log.promotion_requested();
+            if (replica.poll() == 0) {
+                if (promote && replica.applied() == standby_log.head()) {
+                    break;
+                }
+                sched_yield();
+            }
+        }
+        // 切换后无需重建即可继续撮合
+        bool serving = standby.match(Order{1u << 30, 0, 40, 1, Side::BID});
+        _exit(replica.in_sync() && replica.hash_checks() > 0 && serving ? 0 : 1);
+    }
+
+    MatchingEngine primary;
+    primary.set_replication(&log, 64);
+    std::mt19937 rng(43);
+    uint32_t id = 1;
+    random_inputs(primary, rng, id, 20000);
+    log.request_promotion();
+    int status = 0;
+    assert(waitpid(pid, &status, 0) == pid);
+    assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    assert(log.applied() == log.head());
+
+    std::cout << "[PASSED] Replication test.\n";
+}
+
+void run_analytics_test() {
+    AnalyticsConfig config;
+    config.intervals[0] = 10;
+    config.intervals[1] = 30;
+    config.vwap_window = 2;
+    config.ewma_lambda = 0.5;
+    AnalyticsSnapshot snap;
+
+    // 第一笔成交启动时钟：K 线按周期对齐，从 0 开始
+    {
+        TradeAnalytics analytics(3, config);
+        assert(!analytics.on_trade(3, 5, 100, 1) && !analytics.on_trade(0, 5, 100, 0));
+        assert(analytics.on_trade(0, 5, 100, 2));
+        assert(analytics.on_fill(0, 7, FillReport{1, 2, 104, 1}));
+        assert(analytics.snapshot(0, snap));
+        assert(snap.last_price == 104 && snap.session_volume == 3);
+        assert(snap.bars[0].start == 0 && snap.bars[0].open == 100 && snap.bars[0].high == 104);
+        assert(snap.bars[0].low == 100 && snap.bars[0].close == 104 && snap.bars[0].volume == 3);
+        assert(snap.bars[0].notional == 304 && snap.closed[0].volume == 0 && snap.volatility == 0);
+
+        // 跨过 10：短周期收线，长周期继续累积
+        assert(analytics.on_trade(0, 12, 98, 1));
+        assert(analytics.snapshot(0, snap));
+        assert(snap.closed[0].start == 0 && snap.closed[0].open == 100 && snap.closed[0].close == 104);
+        assert(snap.closed[0].volume == 3 && snap.closed[0].notional == 304);
+        assert(snap.bars[0].start == 10 && snap.bars[0].open == 98 && snap.bars[0].volume == 1);
+        assert(snap.bars[1].open == 100 && snap.bars[1].high == 104 && snap.bars[1].low == 98);
+        assert(snap.bars[1].close == 98 && snap.bars[1].volume == 4);
+        assert(snap.rolling_vwap == 402.0 / 4);
+
+        // 无成交的 K 线按最新价走平；滚动 VWAP 只保留最近 2 根
+        analytics.advance(31);
+        assert(analytics.snapshot(0, snap));
+        assert(snap.closed[0].start == 20 && snap.closed[0].volume == 0);
+        assert(snap.closed[0].open == 98 && snap.closed[0].high == 98 && snap.closed[0].low == 98);
+        assert(snap.closed[1].start == 0 && snap.closed[1].volume == 4 && snap.closed[1].close == 98);
+        assert(snap.bars[1].start == 30 && snap.bars[1].volume == 0 && snap.bars[1].open == 98);
+        assert(snap.rolling_vwap == 0 && snap.session_vwap == 402.0 / 4);
+
+        // 波动率：20 处采样 104 -> 98，30 处收益为 0 只衰减
+        double r = -6.0 / 104;
+        assert(std::fabs(snap.volatility - std::sqrt(0.5 * 0.5 * r * r)) < 1e-12);
+
+        // 其他品种互不影响
+        assert(analytics.snapshot(1, snap) && snap.session_volume == 0 && snap.last_price == 0);
+    }
+
+    // 随机成交：与逐笔暴力计算对比
+    struct Trade {
+        uint32_t instrument;
+        uint64_t time;
+        int32_t price;
+        uint32_t volume;
+    };
+    config.intervals[2] = 60;
+    config.vwap_window = 3;
+    config.ewma_lambda = 0.8;
+    const size_t instruments = 20;  // 跨越两个向量宽度
+    TradeAnalytics analytics(instruments, config);
+    std::vector<Trade> trades;
+    std::mt19937 rng(44);
+    uint64_t now = 1003;
+    uint64_t origin = now;
+    for (int n = 0; n < 3000; ++n) {
+        now += rng() % 8;
+        if (rng() % 10 == 0) {
+            analytics.advance(now);
+        } else {
+            Trade t{static_cast<uint32_t>(rng() % instruments), now, static_cast<int32_t>(900 + rng() % 200),
+                    static_cast<uint32_t>(1 + rng() % 20)};
+            assert(analytics.on_trade(t.instrument, t.time, t.price, t.volume));
+            trades.push_back(t);
+        }
+        if (n % 97 != 0) {
+            continue;
+        }
+        for (uint32_t i = 0; i < instruments; ++i) {
+            assert(analytics.snapshot(i, snap));
+            // 某时刻之前的最新价（该时刻的成交不计）
+            auto last_before = [&](uint64_t time) {
+                int32_t price = 0;
+                for (const Trade& t : trades) {
+                    if (t.instrument == i && t.time < time) {
+                        price = t.price;
+                    }
+                }
+                return price;
+            };
+            auto bar_of = [&](uint64_t start, uint64_t end) {
+                Bar bar;
+                bar.start = start;
+                bar.open = bar.high = bar.low = bar.close = last_before(start);
+                for (const Trade& t : trades) {
+                    if (t.instrument != i || t.time < start || t.time >= end) {
+                        continue;
+                    }
+                    bar.open = bar.volume ? bar.open : t.price;
+                    bar.high = bar.volume ? std::max(bar.high, t.price) : t.price;
+                    bar.low = bar.volume ? std::min(bar.low, t.price) : t.price;
+                    bar.close = t.price;
+                    bar.volume += t.volume;
+                    bar.notional += static_cast<int64_t>(t.price) * t.volume;
+                }
+                return bar;
+            };
+            auto same = [](const Bar& a, const Bar& b) {
+                return a.start == b.start && a.open == b.open && a.high == b.high && a.low == b.low
+                    && a.close == b.close && a.volume == b.volume && a.notional == b.notional;
+            };
+            for (size_t k = 0; k < 3; ++k) {
+                uint64_t length = config.intervals[k];
+                uint64_t start = now / length * length;
+                assert(same(snap.bars[k], bar_of(start, UINT64_MAX)));
+                if (start == origin / length * length) {
+                    assert(same(snap.closed[k], Bar()));  // 尚未收过线
+                } else {
+                    assert(same(snap.closed[k], bar_of(start - length, start)));
+                }
+            }
+
+            uint64_t volume = 0, window_volume = 0;
+            int64_t notional = 0, window_notional = 0;
+            uint64_t window_start = now / 10 * 10 - (config.vwap_window - 1) * 10;
+            for (const Trade& t : trades) {
+                if (t.instrument == i) {
+                    volume += t.volume;
+                    notional += static_cast<int64_t>(t.price) * t.volume;
+                    if (t.time >= window_start) {
+                        window_volume += t.volume;
+                        window_notional += static_cast<int64_t>(t.price) * t.volume;
+                    }
+                }
+            }
+            assert(snap.session_volume == volume && snap.last_price == last_before(UINT64_MAX));
+            assert(snap.session_vwap == (volume ? static_cast<double>(notional) / volume : 0));
+            assert(snap.rolling_vwap == (window_volume ? static_cast<double>(window_notional) / window_volume : 0));
+
+            // 每个短周期边界对上一次采样价计算收益
+            double variance = 0;
+            int32_t sampled = 0;
+            for (uint64_t boundary = origin / 10 * 10 + 10; boundary <= now; boundary += 10) {
+                int32_t price = last_before(boundary);
+                if (sampled != 0) {
+                    double change = static_cast<double>(price - sampled) / sampled;
+                    variance = config.ewma_lambda * variance + (1 - config.ewma_lambda) * change * change;
+                }
+                sampled = price;
+            }
+            assert(std::fabs(snap.volatility - std::sqrt(variance)) < 1e-9);
+        }
+    }
+
+    // 读线程无锁读取快照，写线程持续更新并跨越 K 线边界：快照内部始终一致
+    {
+        TradeAnalytics shared(1, config);
+        std::atomic<bool> done{false};
+        std::thread reader([&]() {
+            AnalyticsSnapshot s;
+            while (!done.load(std::memory_order_acquire)) {
+                assert(shared.snapshot(0, s));
+                assert(s.bars[0].volume <= s.bars[1].volume && s.bars[1].volume <= s.bars[2].volume);
+                assert(s.bars[2].volume <= s.session_volume);
+                assert(s.bars[0].volume == 0 || s.bars[0].close == s.last_price);
+                assert(s.bars[0].low <= s.bars[0].close && s.bars[0].close <= s.bars[0].high);
+            }
+        });
+        for (uint32_t n = 0; n < 200000; ++n) {
+            shared.on_trade(0, n / 4, static_cast<int32_t>(1000 + n % 50), 1 + n % 3);
+            if (n % 1000 == 0) {
+                sched_yield();
+            }
+        }
+        done.store(true, std::memory_order_release);
+        reader.join();
+        assert(shared.snapshot(0, snap) && snap.bars[0].volume <= snap.session_volume);
+    }
+    std::cout << "[PASSED] Trade analytics test.\n";
+}
+
 int main() {
     // 设置全局撮合回调
     // struct FillReport {
@@ -120,6 +1154,17 @@ int main() {
     run_basic_match_test();
     run_partial_fill_test();
     run_time_priority_test();
+    run_depth_test();
+    run_mass_cancel_test();
+    run_priority_order_test();
+    run_no_allocation_test();
+    run_report_ring_test();
+    run_book_builder_test();
+    run_queue_position_test();
+    run_auction_test();
+    run_expiry_test();
+    run_replication_test();
+    run_analytics_test();
 
     std::cout << "[TEST PASSED]" << std::endl;
 
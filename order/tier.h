@@ -0,0 +1,229 @@
+#pragma once
+#include <immintrin.h>
+#include <cstddef>
+#include <cstdint>
+#include "order.h"
+
+// Vector and mask types for Lanes 32-bit lanes of one tier side, with the handful of
+// AVX-512 operations the book needs. 8 lanes use AVX-512VL on ymm, 16 lanes use zmm.
+template <size_t Lanes>
+struct LaneTraits;
+
+template <>
+struct LaneTraits<8> {
+    using vec_t  = __m256i;
+    using mask_t = __mmask8;
+    static constexpr mask_t FULL = 0xFF;
+
+    static vec_t load(const void* p) { return _mm256_load_si256(static_cast<const __m256i*>(p)); }
+    static void store(void* p, vec_t v) { _mm256_store_si256(static_cast<__m256i*>(p), v); }
+    static vec_t set1(int32_t x) { return _mm256_set1_epi32(x); }
+    static vec_t zero() { return _mm256_setzero_si256(); }
+
+    static mask_t test(vec_t v) { return _mm256_test_epi32_mask(v, v); }
+    static mask_t cmpeq(mask_t k, vec_t a, vec_t b) { return _mm256_mask_cmpeq_epi32_mask(k, a, b); }
+    static mask_t cmpgt(mask_t k, vec_t a, vec_t b) { return _mm256_mask_cmpgt_epi32_mask(k, a, b); }
+    static mask_t cmplt(mask_t k, vec_t a, vec_t b) { return _mm256_mask_cmplt_epi32_mask(k, a, b); }
+    static mask_t cmpge(mask_t k, vec_t a, vec_t b) { return _mm256_mask_cmpge_epi32_mask(k, a, b); }
+    static mask_t cmple(mask_t k, vec_t a, vec_t b) { return _mm256_mask_cmple_epi32_mask(k, a, b); }
+
+    static vec_t mask_mov(vec_t src, mask_t k, vec_t a) { return _mm256_mask_mov_epi32(src, k, a); }
+    static vec_t mask_max(vec_t src, mask_t k, vec_t a, vec_t b) { return _mm256_mask_max_epi32(src, k, a, b); }
+    static vec_t mask_min(vec_t src, mask_t k, vec_t a, vec_t b) { return _mm256_mask_min_epi32(src, k, a, b); }
+
+    // Lanes in k take the value of the lane below them.
+    static vec_t shift_up(mask_t k, vec_t a) {
+        return _mm256_mask_permutexvar_epi32(a, k, _mm256_setr_epi32(0, 0, 1, 2, 3, 4, 5, 6), a);
+    }
+    // Pack lanes in k to the front, zero the rest.
+    static vec_t compress(mask_t k, vec_t a) { return _mm256_maskz_compress_epi32(k, a); }
+
+    // Same operations on Lanes 64-bit values.
+    static mask_t cmple_u64(mask_t k, const uint64_t* p, uint64_t x) {
+        return _mm512_mask_cmple_epu64_mask(k, _mm512_load_si512(p), _mm512_set1_epi64(x));
+    }
+    static void shift_up_u64(mask_t k, uint64_t* p) {
+        __m512i v = _mm512_load_si512(p);
+        _mm512_store_si512(p, _mm512_mask_permutexvar_epi64(v, k, _mm512_setr_epi64(0, 0, 1, 2, 3, 4, 5, 6), v));
+    }
+    static void compress_u64(mask_t k, uint64_t* p) {
+        _mm512_store_si512(p, _mm512_maskz_compress_epi64(k, _mm512_load_si512(p)));
+    }
+};
+
+template <>
+struct LaneTraits<16> {
+    using vec_t  = __m512i;
+    using mask_t = __mmask16;
+    static constexpr mask_t FULL = 0xFFFF;
+
+    static vec_t load(const void* p) { return _mm512_load_si512(p); }
+    static void store(void* p, vec_t v) { _mm512_store_si512(p, v); }
+    static vec_t set1(int32_t x) { return _mm512_set1_epi32(x); }
+    static vec_t zero() { return _mm512_setzero_si512(); }
+
+    static mask_t test(vec_t v) { return _mm512_test_epi32_mask(v, v); }
+    static mask_t cmpeq(mask_t k, vec_t a, vec_t b) { return _mm512_mask_cmpeq_epi32_mask(k, a, b); }
+    static mask_t cmpgt(mask_t k, vec_t a, vec_t b) { return _mm512_mask_cmpgt_epi32_mask(k, a, b); }
+    static mask_t cmplt(mask_t k, vec_t a, vec_t b) { return _mm512_mask_cmplt_epi32_mask(k, a, b); }
+    static mask_t cmpge(mask_t k, vec_t a, vec_t b) { return _mm512_mask_cmpge_epi32_mask(k, a, b); }
+    static mask_t cmple(mask_t k, vec_t a, vec_t b) { return _mm512_mask_cmple_epi32_mask(k, a, b); }
+
+    static vec_t mask_mov(vec_t src, mask_t k, vec_t a) { return _mm512_mask_mov_epi32(src, k, a); }
+    static vec_t mask_max(vec_t src, mask_t k, vec_t a, vec_t b) { return _mm512_mask_max_epi32(src, k, a, b); }
+    static vec_t mask_min(vec_t src, mask_t k, vec_t a, vec_t b) { return _mm512_mask_min_epi32(src, k, a, b); }
+
+    // Lanes in k take the value of the lane below them.
+    static vec_t shift_up(mask_t k, vec_t a) {
+        return _mm512_mask_permutexvar_epi32(a, k, _mm512_setr_epi32(0, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14), a);
+    }
+    // Pack lanes in k to the front, zero the rest.
+    static vec_t compress(mask_t k, vec_t a) { return _mm512_maskz_compress_epi32(k, a); }
+
+    // Same operations on Lanes 64-bit values, held in two zmm.
+    static mask_t cmple_u64(mask_t k, const uint64_t* p, uint64_t x) {
+        __m512i value = _mm512_set1_epi64(x);
+        __mmask8 lo = _mm512_mask_cmple_epu64_mask(static_cast<__mmask8>(k), _mm512_load_si512(p), value);
+        __mmask8 hi = _mm512_mask_cmple_epu64_mask(static_cast<__mmask8>(k >> 8), _mm512_load_si512(p + 8), value);
+        return static_cast<mask_t>(lo | (hi << 8));
+    }
+    static void shift_up_u64(mask_t k, uint64_t* p) {
+        __m512i lo = _mm512_load_si512(p);
+        __m512i hi = _mm512_load_si512(p + 8);
+        __m512i idx = _mm512_setr_epi64(7, 8, 9, 10, 11, 12, 13, 14); // Lane 7 of lo, then lanes 0..6 of hi
+        __m512i shifted_hi = _mm512_permutex2var_epi64(lo, idx, hi);
+        _mm512_store_si512(p + 8, _mm512_mask_mov_epi64(hi, static_cast<__mmask8>(k >> 8), shifted_hi));
+        _mm512_store_si512(p, _mm512_mask_permutexvar_epi64(lo, static_cast<__mmask8>(k), _mm512_setr_epi64(0, 0, 1, 2, 3, 4, 5, 6), lo));
+    }
+    static void compress_u64(mask_t k, uint64_t* p) {
+        __m512i lo = _mm512_load_si512(p);
+        __m512i hi = _mm512_load_si512(p + 8);
+        __mmask8 k_lo = static_cast<__mmask8>(k);
+        _mm512_store_si512(p, _mm512_maskz_compress_epi64(k_lo, lo));
+        _mm512_mask_compressstoreu_epi64(p + __builtin_popcount(k_lo), static_cast<__mmask8>(k >> 8), hi);
+    }
+};
+
+// Order of the four blocks inside a tier.
+enum class SideLayout : uint8_t {
+    SPLIT,   // [bid hot][ask hot][bid cold][ask cold]: both touches are adjacent lines
+    GROUPED, // [bid hot][bid cold][ask hot][ask cold]: each side is one contiguous run
+};
+
+// Fields read on every match. A lane is active iff its volume is non zero, so the
+// active mask lives in the same line as prices and volumes (one line at 8 lanes).
+template <size_t Lanes>
+struct alignas(64) TierHot {
+    int32_t  prices[Lanes]  = {};
+    uint32_t volumes[Lanes] = {};
+};
+
+// Fields only read when an order is filled, canceled or reported.
+template <size_t Lanes>
+struct alignas(64) TierCold {
+    uint32_t order_ids[Lanes]  = {};
+    uint32_t owners[Lanes]     = {};
+    uint64_t timestamps[Lanes] = {};
+};
+
+template <size_t Lanes, SideLayout Layout>
+struct TierStorage;
+
+template <size_t Lanes>
+struct TierStorage<Lanes, SideLayout::SPLIT> {
+    TierHot<Lanes>  hot_blocks[2];
+    TierCold<Lanes> cold_blocks[2];
+
+    TierHot<Lanes>& hot(Side side) { return hot_blocks[static_cast<size_t>(side)]; }
+    const TierHot<Lanes>& hot(Side side) const { return hot_blocks[static_cast<size_t>(side)]; }
+    TierCold<Lanes>& cold(Side side) { return cold_blocks[static_cast<size_t>(side)]; }
+    const TierCold<Lanes>& cold(Side side) const { return cold_blocks[static_cast<size_t>(side)]; }
+};
+
+template <size_t Lanes>
+struct TierStorage<Lanes, SideLayout::GROUPED> {
+    struct Block {
+        TierHot<Lanes>  hot;
+        TierCold<Lanes> cold;
+    };
+    Block blocks[2];
+
+    TierHot<Lanes>& hot(Side side) { return blocks[static_cast<size_t>(side)].hot; }
+    const TierHot<Lanes>& hot(Side side) const { return blocks[static_cast<size_t>(side)].hot; }
+    TierCold<Lanes>& cold(Side side) { return blocks[static_cast<size_t>(side)].cold; }
+    const TierCold<Lanes>& cold(Side side) const { return blocks[static_cast<size_t>(side)].cold; }
+};
+
+// One price tier with Lanes slots per side, bids and asks in separate blocks.
+template <size_t Lanes, SideLayout Layout = SideLayout::SPLIT>
+struct BasicTier : TierStorage<Lanes, Layout> {
+    using traits = LaneTraits<Lanes>;
+    using vec_t  = typename traits::vec_t;
+    using mask_t = typename traits::mask_t;
+
+    static constexpr size_t LANES = Lanes;
+    static constexpr SideLayout LAYOUT = Layout;
+
+    vec_t prices(Side side) const { return traits::load(this->hot(side).prices); }
+    vec_t volumes(Side side) const { return traits::load(this->hot(side).volumes); }
+
+    // Active lanes of side. Lanes are kept in price-time priority (lane 0 is the best order),
+    // so the active lanes always form a prefix.
+    mask_t active_mask(Side side) const { return traits::test(volumes(side)); }
+
+    size_t count(Side side) const { return __builtin_popcount(active_mask(side)); }
+
+    // Lane holding order_id on side, -1 if there is none.
+    int find_lane(Side side, uint32_t order_id) const {
+        mask_t hit = traits::cmpeq(
+            active_mask(side), traits::load(this->cold(side).order_ids), traits::set1(static_cast<int32_t>(order_id)));
+        return hit ? __builtin_ctz(hit) : -1;
+    }
+
+    // Lane order belongs to in price-time priority: behind every better price,
+    // and behind every order at the same price that is not newer.
+    size_t priority_lane(const Order& order) const {
+        mask_t active = active_mask(order.side);
+        vec_t book_prices = prices(order.side);
+        vec_t price = traits::set1(order.price);
+
+        mask_t ahead = (order.side == Side::BID)
+            ? traits::cmpgt(active, book_prices, price)
+            : traits::cmplt(active, book_prices, price);
+
+        mask_t same_price = traits::cmpeq(active, book_prices, price);
+        if (same_price) {
+            ahead |= traits::cmple_u64(same_price, this->cold(order.side).timestamps, order.timestamp);
+        }
+        return __builtin_popcount(ahead);
+    }
+
+    // Move lanes [lane, count) of side up by one, so lane can take a new order.
+    // The side must not be full.
+    void open_lane(Side side, size_t lane) {
+        size_t end = count(side);
+        if (lane == end) {
+            return;
+        }
+        mask_t k = static_cast<mask_t>(((1u << (end + 1)) - 1) & ~((1u << (lane + 1)) - 1));
+
+        TierHot<Lanes>& h = this->hot(side);
+        TierCold<Lanes>& c = this->cold(side);
+        traits::store(h.prices, traits::shift_up(k, traits::load(h.prices)));
+        traits::store(h.volumes, traits::shift_up(k, traits::load(h.volumes)));
+        traits::store(c.order_ids, traits::shift_up(k, traits::load(c.order_ids)));
+        traits::store(c.owners, traits::shift_up(k, traits::load(c.owners)));
+        traits::shift_up_u64(k, c.timestamps);
+    }
+
+    // Keep only the lanes of side in keep, packed to the front in their order. Other lanes are freed.
+    void compact(Side side, mask_t keep) {
+        TierHot<Lanes>& h = this->hot(side);
+        TierCold<Lanes>& c = this->cold(side);
+        traits::store(h.prices, traits::compress(keep, traits::load(h.prices)));
+        traits::store(h.volumes, traits::compress(keep, traits::load(h.volumes)));
+        traits::store(c.order_ids, traits::compress(keep, traits::load(c.order_ids)));
+        traits::store(c.owners, traits::compress(keep, traits::load(c.owners)));
+        traits::compress_u64(keep, c.timestamps);
+    }
+};
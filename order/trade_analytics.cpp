@@ -0,0 +1,282 @@
+#include "trade_analytics.h"
+#include <immintrin.h>
+#include <algorithm>
+#include <cmath>
+
+static constexpr size_t VECTOR = 16;  // Instruments per step of 32-bit fields, 64-bit ones take two
+
+static size_t padded(size_t instruments) {
+    return (instruments + VECTOR - 1) & ~(VECTOR - 1);
+}
+
+static size_t interval_count(const AnalyticsConfig& config) {
+    size_t count = 0;
+    while (count < AnalyticsConfig::MAX_INTERVALS && config.intervals[count] != 0) {
+        count++;
+    }
+    return count;
+}
+
+size_t TradeAnalytics::arena_bytes(size_t instruments, const AnalyticsConfig& config) {
+    size_t n = padded(instruments);
+    size_t window = config.vwap_window > 0 ? config.vwap_window : 1;
+    auto array = [](size_t count, size_t size) { return count * size + 64; };
+    return interval_count(config) * 2 * (4 * array(n, 4) + 2 * array(n, 8))  // Bars, in progress and closed
+         + 3 * array(n, 4)                                                  // Last, sampled, sequences
+         + 5 * array(n, 8)                                                  // Session and window sums, variance
+         + 2 * array((window - 1) * n, 8);                                  // Window slots
+}
+
+TradeAnalytics::TradeAnalytics(size_t instruments, const AnalyticsConfig& config, Arena* arena)
+    : _own_arena(arena ? nullptr : std::make_unique<Arena>(arena_bytes(instruments, config))),
+      _arena(arena ? *arena : *_own_arena),
+      _instruments(instruments),
+      _padded(padded(instruments)),
+      _intervals(interval_count(config)),
+      _window(config.vwap_window > 0 ? config.vwap_window : 1),
+      _lambda(config.ewma_lambda) {
+    // Everything starts at zero: no trades, flat bars at price 0
+    auto carve = [this](Bars& bars) {
+        bars.open = _arena.create<int32_t>(_padded);
+        bars.high = _arena.create<int32_t>(_padded);
+        bars.low = _arena.create<int32_t>(_padded);
+        bars.close = _arena.create<int32_t>(_padded);
+        bars.volume = _arena.create<uint64_t>(_padded);
+        bars.notional = _arena.create<int64_t>(_padded);
+    };
+    for (size_t k = 0; k < _intervals; ++k) {
+        _lengths[k] = config.intervals[k];
+        carve(_bars[k]);
+        carve(_closed[k]);
+    }
+    _last = _arena.create<int32_t>(_padded);
+    _sampled = _arena.create<int32_t>(_padded);
+    _sequences = _arena.create<std::atomic<uint32_t>>(_padded);
+    _session_volume = _arena.create<uint64_t>(_padded);
+    _session_notional = _arena.create<int64_t>(_padded);
+    _window_volume = _arena.create<uint64_t>(_padded);
+    _window_notional = _arena.create<int64_t>(_padded);
+    _variance = _arena.create<double>(_padded);
+    _slot_volume = _arena.create<uint64_t>((_window - 1) * _padded);
+    _slot_notional = _arena.create<int64_t>((_window - 1) * _padded);
+}
+
+void TradeAnalytics::advance(uint64_t now) {
+    if (_next_boundary == 0) {
+        // First bars open at the boundary before now
+        for (size_t k = 0; k < _intervals; ++k) {
+            _starts[k] = now / _lengths[k] * _lengths[k];
+        }
+        _next_boundary = _starts[0] + _lengths[0];
+        return;
+    }
+    while (now >= _next_boundary) {
+        roll(_next_boundary);
+        _next_boundary += _lengths[0];
+    }
+}
+
+// Bar following into over time: its prices move into's if it traded, its volume adds up.
+// Bars without trades are flat at the last price, so an empty into takes bar as is.
+static void fold(Bar& into, const Bar& bar) {
+    if (into.volume == 0) {
+        into.open = bar.open;
+        into.high = bar.high;
+        into.low = bar.low;
+        into.close = bar.close;
+    } else if (bar.volume != 0) {
+        into.high = std::max(into.high, bar.high);
+        into.low = std::min(into.low, bar.low);
+        into.close = bar.close;
+    }
+    into.volume += bar.volume;
+    into.notional += bar.notional;
+}
+
+void TradeAnalytics::roll(uint64_t boundary) {
+    uint64_t epoch = _epoch.load(std::memory_order_relaxed);
+    _epoch.store(epoch + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    Bars& base = _bars[0];
+    uint64_t* slot_volume = _slot_volume + _slot * _padded;
+    int64_t* slot_notional = _slot_notional + _slot * _padded;
+    const __m512d lambda = _mm512_set1_pd(_lambda);
+    const __m512d weight = _mm512_set1_pd(1 - _lambda);
+    const __m512i zero = _mm512_setzero_si512();
+
+    for (size_t i = 0; i < _padded; i += VECTOR) {
+        // Instruments whose closing bar traded, from both halves of the 64-bit volumes
+        __m512i volumes[2] = {_mm512_load_si512(base.volume + i), _mm512_load_si512(base.volume + i + 8)};
+        __m512i notionals[2] = {_mm512_load_si512(base.notional + i), _mm512_load_si512(base.notional + i + 8)};
+        __mmask16 traded = _mm512_test_epi64_mask(volumes[0], volumes[0])
+                         | static_cast<__mmask16>(_mm512_test_epi64_mask(volumes[1], volumes[1]) << 8);
+
+        __m512i open = _mm512_load_si512(base.open + i);
+        __m512i high = _mm512_load_si512(base.high + i);
+        __m512i low = _mm512_load_si512(base.low + i);
+        __m512i close = _mm512_load_si512(base.close + i);
+        __m512i last = _mm512_mask_blend_epi32(traded, _mm512_load_si512(_last + i), close);
+        _mm512_store_si512(_last + i, last);
+
+        // Volatility: return of the last price since the previous sample, for instruments that had one
+        __m512i sampled = _mm512_load_si512(_sampled + i);
+        for (size_t half = 0; half < 2; ++half) {
+            __m512d price = _mm512_cvtepi32_pd(half ? _mm512_extracti64x4_epi64(last, 1) : _mm512_castsi512_si256(last));
+            __m512d previous = _mm512_cvtepi32_pd(half ? _mm512_extracti64x4_epi64(sampled, 1) : _mm512_castsi512_si256(sampled));
+            __mmask8 valid = _mm512_cmp_pd_mask(previous, _mm512_setzero_pd(), _CMP_NEQ_OQ);
+            __m512d change = _mm512_maskz_div_pd(valid, _mm512_sub_pd(price, previous), previous);
+            __m512d variance = _mm512_load_pd(_variance + i + 8 * half);
+            __m512d updated = _mm512_fmadd_pd(weight, _mm512_mul_pd(change, change), _mm512_mul_pd(lambda, variance));
+            _mm512_store_pd(_variance + i + 8 * half, _mm512_mask_blend_pd(valid, variance, updated));
+        }
+        _mm512_store_si512(_sampled + i, last);
+
+        for (size_t half = 0; half < 2; ++half) {
+            size_t j = i + 8 * half;
+            _mm512_store_si512(_session_volume + j, _mm512_add_epi64(_mm512_load_si512(_session_volume + j), volumes[half]));
+            _mm512_store_si512(_session_notional + j, _mm512_add_epi64(_mm512_load_si512(_session_notional + j), notionals[half]));
+
+            // Rolling VWAP: the closing bar joins the window, the oldest one leaves it
+            if (_window > 1) {
+                __m512i window_volume = _mm512_add_epi64(_mm512_load_si512(_window_volume + j), volumes[half]);
+                __m512i window_notional = _mm512_add_epi64(_mm512_load_si512(_window_notional + j), notionals[half]);
+                _mm512_store_si512(_window_volume + j, _mm512_sub_epi64(window_volume, _mm512_load_si512(slot_volume + j)));
+                _mm512_store_si512(_window_notional + j, _mm512_sub_epi64(window_notional, _mm512_load_si512(slot_notional + j)));
+                _mm512_store_si512(slot_volume + j, volumes[half]);
+                _mm512_store_si512(slot_notional + j, notionals[half]);
+            }
+        }
+
+        // Longer bars: fold the closing bar in, close those ending here and start them flat
+        for (size_t k = 1; k < _intervals; ++k) {
+            Bars& bar = _bars[k];
+            __m512i bar_volumes[2] = {_mm512_load_si512(bar.volume + i), _mm512_load_si512(bar.volume + i + 8)};
+            __mmask16 empty = ~(_mm512_test_epi64_mask(bar_volumes[0], bar_volumes[0])
+                              | static_cast<__mmask16>(_mm512_test_epi64_mask(bar_volumes[1], bar_volumes[1]) << 8));
+            __m512i bar_open = _mm512_mask_blend_epi32(empty, _mm512_load_si512(bar.open + i), open);
+            __m512i bar_high = _mm512_mask_blend_epi32(empty | traded, _mm512_load_si512(bar.high + i),
+                                                       _mm512_mask_max_epi32(high, traded & ~empty, _mm512_load_si512(bar.high + i), high));
+            __m512i bar_low = _mm512_mask_blend_epi32(empty | traded, _mm512_load_si512(bar.low + i),
+                                                      _mm512_mask_min_epi32(low, traded & ~empty, _mm512_load_si512(bar.low + i), low));
+            __m512i bar_close = _mm512_mask_blend_epi32(empty | traded, _mm512_load_si512(bar.close + i), close);
+            for (size_t half = 0; half < 2; ++half) {
+                bar_volumes[half] = _mm512_add_epi64(bar_volumes[half], volumes[half]);
+            }
+            __m512i bar_notionals[2] = {_mm512_add_epi64(_mm512_load_si512(bar.notional + i), notionals[0]),
+                                        _mm512_add_epi64(_mm512_load_si512(bar.notional + i + 8), notionals[1])};
+
+            Bars& target = boundary % _lengths[k] == 0 ? _closed[k] : bar;
+            _mm512_store_si512(target.open + i, bar_open);
+            _mm512_store_si512(target.high + i, bar_high);
+            _mm512_store_si512(target.low + i, bar_low);
+            _mm512_store_si512(target.close + i, bar_close);
+            for (size_t half = 0; half < 2; ++half) {
+                _mm512_store_si512(target.volume + i + 8 * half, bar_volumes[half]);
+                _mm512_store_si512(target.notional + i + 8 * half, bar_notionals[half]);
+            }
+            if (&target != &bar) {
+                _mm512_store_si512(bar.open + i, last);
+                _mm512_store_si512(bar.high + i, last);
+                _mm512_store_si512(bar.low + i, last);
+                _mm512_store_si512(bar.close + i, last);
+                for (size_t half = 0; half < 2; ++half) {
+                    _mm512_store_si512(bar.volume + i + 8 * half, zero);
+                    _mm512_store_si512(bar.notional + i + 8 * half, zero);
+                }
+            }
+        }
+
+        // The bar of intervals[0] always closes
+        Bars& closed = _closed[0];
+        _mm512_store_si512(closed.open + i, open);
+        _mm512_store_si512(closed.high + i, high);
+        _mm512_store_si512(closed.low + i, low);
+        _mm512_store_si512(closed.close + i, close);
+        _mm512_store_si512(base.open + i, last);
+        _mm512_store_si512(base.high + i, last);
+        _mm512_store_si512(base.low + i, last);
+        _mm512_store_si512(base.close + i, last);
+        for (size_t half = 0; half < 2; ++half) {
+            _mm512_store_si512(closed.volume + i + 8 * half, volumes[half]);
+            _mm512_store_si512(closed.notional + i + 8 * half, notionals[half]);
+            _mm512_store_si512(base.volume + i + 8 * half, zero);
+            _mm512_store_si512(base.notional + i + 8 * half, zero);
+        }
+    }
+
+    if (_window > 1) {
+        _slot = _slot + 1 < _window - 1 ? _slot + 1 : 0;
+    }
+    for (size_t k = 0; k < _intervals; ++k) {
+        if (boundary % _lengths[k] == 0) {
+            _closed_starts[k] = _starts[k];
+            _starts[k] = boundary;
+        }
+    }
+
+    _epoch.store(epoch + 2, std::memory_order_release);
+}
+
+bool TradeAnalytics::snapshot(uint32_t instrument, AnalyticsSnapshot& snapshot) const {
+    if (instrument >= _instruments) {
+        return false;
+    }
+    auto copy = [instrument](const Bars& bars, uint64_t start, Bar& bar) {
+        bar.start = start;
+        bar.open = bars.open[instrument];
+        bar.high = bars.high[instrument];
+        bar.low = bars.low[instrument];
+        bar.close = bars.close[instrument];
+        bar.volume = bars.volume[instrument];
+        bar.notional = bars.notional[instrument];
+    };
+
+    int64_t session_notional, window_notional;
+    uint64_t window_volume;
+    double variance;
+    while (true) {
+        uint64_t epoch = _epoch.load(std::memory_order_acquire);
+        uint32_t sequence = _sequences[instrument].load(std::memory_order_acquire);
+        if ((epoch | sequence) & 1) {
+            _mm_pause();
+            continue;
+        }
+
+        for (size_t k = 0; k < _intervals; ++k) {
+            copy(_bars[k], _starts[k], snapshot.bars[k]);
+            copy(_closed[k], _closed_starts[k], snapshot.closed[k]);
+        }
+        snapshot.last_price = _last[instrument];
+        snapshot.session_volume = _session_volume[instrument];
+        session_notional = _session_notional[instrument];
+        window_volume = _window_volume[instrument];
+        window_notional = _window_notional[instrument];
+        variance = _variance[instrument];
+
+        // Nothing changed while copying
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (_epoch.load(std::memory_order_relaxed) == epoch && _sequences[instrument].load(std::memory_order_relaxed) == sequence) {
+            break;
+        }
+    }
+
+    // Add the bar in progress of intervals[0] to everything it is part of
+    const Bar& current = snapshot.bars[0];
+    for (size_t k = 1; k < _intervals; ++k) {
+        fold(snapshot.bars[k], current);
+    }
+    for (size_t k = _intervals; k < AnalyticsConfig::MAX_INTERVALS; ++k) {
+        snapshot.bars[k] = Bar();
+        snapshot.closed[k] = Bar();
+    }
+    snapshot.last_price = current.volume ? current.close : snapshot.last_price;
+    snapshot.session_volume += current.volume;
+    session_notional += current.notional;
+    window_volume += current.volume;
+    window_notional += current.notional;
+    snapshot.session_vwap = snapshot.session_volume ? static_cast<double>(session_notional) / snapshot.session_volume : 0;
+    snapshot.rolling_vwap = window_volume ? static_cast<double>(window_notional) / window_volume : 0;
+    snapshot.volatility = std::sqrt(variance);
+    return true;
+}
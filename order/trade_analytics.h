@@ -0,0 +1,154 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include "arena.h"
+#include "reports.h"
+
+// Bar lengths and statistics windows of a TradeAnalytics.
+struct AnalyticsConfig {
+    static constexpr size_t MAX_INTERVALS = 4;
+
+    // Bar lengths in clock units, ascending, each a multiple of the first; 0: unused.
+    // Bars are aligned to multiples of their length.
+    uint64_t intervals[MAX_INTERVALS] = {1000000000ull, 60000000000ull, 0, 0};  // 1s and 1min of ns
+    size_t vwap_window = 60;    // Rolling VWAP over the last vwap_window bars of intervals[0], current one included
+    double ewma_lambda = 0.94;  // Variance decay per bar of intervals[0]
+};
+
+// One OHLCV bar. Bars without trades are flat at the last traded price, with no volume.
+struct Bar {
+    uint64_t start = 0;     // Clock time the bar opened
+    int32_t  open = 0;
+    int32_t  high = 0;
+    int32_t  low = 0;
+    int32_t  close = 0;
+    uint64_t volume = 0;
+    int64_t  notional = 0;  // Sum of price * volume, VWAP of the bar: notional / volume
+};
+
+// Consistent copy of one instrument's analytics.
+struct AnalyticsSnapshot {
+    int32_t  last_price = 0;                          // 0 before the first trade
+    Bar      bars[AnalyticsConfig::MAX_INTERVALS];    // In progress, per interval
+    Bar      closed[AnalyticsConfig::MAX_INTERVALS];  // Last completed, per interval
+    uint64_t session_volume = 0;
+    double   session_vwap = 0;                        // 0 without volume
+    double   rolling_vwap = 0;                        // 0 without volume in the window
+    double   volatility = 0;                          // EWMA standard deviation of bar to bar returns
+};
+
+// Streaming trade analytics of many instruments: OHLCV bars at several intervals, session and
+// rolling VWAP, and EWMA volatility, maintained incrementally from fills.
+// State is kept as structure of arrays, one array per field with one entry per instrument, carved
+// from an Arena. A fill only updates its instrument's bar of intervals[0]: the longer bars, the
+// session and the VWAP window are sums of those bars, so each closed one is folded into them when
+// the clock crosses a boundary of intervals[0], for all instruments at once with AVX-512, 16
+// prices or 8 volumes per step, along with sampling returns into the volatility. Readers add the
+// bar in progress.
+// Single writer (the matching thread, or a reader of its report ring), fed in clock order.
+// Any number of reader threads take snapshots lock free: each instrument has a sequence lock,
+// and bar boundaries bump a global one.
+class TradeAnalytics {
+public:
+    // State of instruments [0, instruments) is carved from arena, which must outlive the analytics
+    // and hold arena_bytes(instruments, config). Without one a private arena is mapped on the
+    // calling thread's NUMA node.
+    TradeAnalytics(size_t instruments, const AnalyticsConfig& config = AnalyticsConfig(), Arena* arena = nullptr);
+
+    TradeAnalytics(const TradeAnalytics&) = delete;
+    TradeAnalytics& operator=(const TradeAnalytics&) = delete;
+
+    // Arena bytes needed for instruments.
+    static size_t arena_bytes(size_t instruments, const AnalyticsConfig& config = AnalyticsConfig());
+
+    // Advance the clock to now, closing every bar that ended. Times never go backwards.
+    // Each boundary of intervals[0] crossed is one pass over every instrument.
+    void advance(uint64_t now);
+
+    // Account a trade of instrument at clock time now (advanced to first).
+    // Return false if instrument is unknown or volume is 0.
+    bool on_trade(uint32_t instrument, uint64_t now, int32_t price, uint32_t volume) {
+        if (instrument >= _instruments || volume == 0) {
+            return false;
+        }
+        if (now >= _next_boundary) {
+            advance(now);
+        }
+        update(instrument, price, volume);
+        return true;
+    }
+
+    // Account a fill report of instrument's engine at clock time now.
+    bool on_fill(uint32_t instrument, uint64_t now, const FillReport& fill) {
+        return on_trade(instrument, now, fill.traded_price, fill.traded_volume);
+    }
+
+    // Copy instrument's analytics into snapshot, from any thread. Return false if it is unknown.
+    bool snapshot(uint32_t instrument, AnalyticsSnapshot& snapshot) const;
+
+    size_t instruments() const { return _instruments; }
+
+    size_t intervals() const { return _intervals; }
+
+private:
+    // One interval's bars, a field per array.
+    struct Bars {
+        int32_t* open;
+        int32_t* high;
+        int32_t* low;
+        int32_t* close;
+        uint64_t* volume;
+        int64_t* notional;
+    };
+
+    void update(uint32_t i, int32_t price, uint32_t volume) {
+        uint32_t sequence = _sequences[i].load(std::memory_order_relaxed);
+        _sequences[i].store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        Bars& bar = _bars[0];
+        bool first = bar.volume[i] == 0;
+        bar.open[i] = first ? price : bar.open[i];
+        bar.high[i] = first || price > bar.high[i] ? price : bar.high[i];
+        bar.low[i] = first || price < bar.low[i] ? price : bar.low[i];
+        bar.close[i] = price;
+        bar.volume[i] += volume;
+        bar.notional[i] += static_cast<int64_t>(price) * volume;
+
+        _sequences[i].store(sequence + 2, std::memory_order_release);
+    }
+
+    // Close the bars of intervals[0] ending at boundary, and those of the longer intervals ending there.
+    void roll(uint64_t boundary);
+
+    std::unique_ptr<Arena> _own_arena;
+    Arena& _arena;
+    size_t _instruments;
+    size_t _padded;                     // Instruments rounded up to whole vectors
+    size_t _intervals;                  // Intervals in use
+    uint64_t _lengths[AnalyticsConfig::MAX_INTERVALS];
+    size_t _window;
+    double _lambda;
+
+    // Bars in progress: of intervals[0], then of the longer ones up to the start of that bar
+    Bars _bars[AnalyticsConfig::MAX_INTERVALS];
+    Bars _closed[AnalyticsConfig::MAX_INTERVALS];  // Last completed
+    uint64_t _starts[AnalyticsConfig::MAX_INTERVALS] = {};
+    uint64_t _closed_starts[AnalyticsConfig::MAX_INTERVALS] = {};
+    int32_t* _last;                     // Last price up to the bar in progress of intervals[0]
+    uint64_t* _session_volume;          // Up to the bar in progress of intervals[0], as the sums below
+    int64_t* _session_notional;
+    uint64_t* _window_volume;           // Rolling VWAP sums of the other _window - 1 bars of the window
+    int64_t* _window_notional;
+    uint64_t* _slot_volume;             // Those bars one by one, slot major
+    int64_t* _slot_notional;
+    size_t _slot = 0;                   // Slot of the oldest bar in the window
+    int32_t* _sampled;                  // Last price at the previous volatility sample, 0: none yet
+    double* _variance;
+
+    uint64_t _next_boundary = 0;        // Next bar boundary of intervals[0], 0: clock not started
+    std::atomic<uint32_t>* _sequences;  // Per instrument: odd while a fill is being applied
+    std::atomic<uint64_t> _epoch{0};    // Odd while bars roll
+};